@@ -5,9 +5,16 @@
 #include <cassert>
 #include <cstddef>
 #include <cstdlib>
+#include <cstring>
+#include <vector>
 
 #include "API.h"
 
+#ifdef __linux__
+	#include <signal.h>
+	#include <sys/sendfile.h>
+#endif
+
 namespace AGSSockAPI {
 
 IAGSEngine *engine = nullptr;
@@ -98,6 +105,7 @@ ags_t AGSEnumerateError(int errnum)
 		case ERR(ISCONN):
 		                          return AGSSOCK_INVALID;
 		case ERR(OPNOTSUPP):
+		case ERR(NOPROTOOPT):
 		NOT_WIN(case ERR(PROTO):)
 		case ERR(PROTONOSUPPORT):
 		case ERR(SOCKTNOSUPPORT):
@@ -373,6 +381,429 @@ void Beacon::signal()
 #endif
 }
 
+//==============================================================================
+
+// Mappings have to start at a multiple of the page size (or the allocation
+// granularity on Windows); the offset within the first page is skipped.
+
+MappedFile::MappedFile(const char *path, std::int64_t offset,
+	std::int64_t length)
+	: valid_(false), data_(nullptr), size_(0), view_(nullptr), length_(0)
+{
+	if (offset < 0)
+		return;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || offset > file_size.QuadPart)
+	{
+		CloseHandle(file);
+		return;
+	}
+
+	std::int64_t available = file_size.QuadPart - offset;
+	if (length < 0 || length > available)
+		length = available;
+	if ((std::uint64_t) length > SIZE_MAX)
+	{
+		CloseHandle(file);
+		return;
+	}
+
+	if (length == 0)
+	{
+		CloseHandle(file);
+		valid_ = true;
+		return;
+	}
+
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	std::int64_t start = offset - offset % info.dwAllocationGranularity;
+	length_ = (size_t) (offset - start + length);
+
+	HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL)
+		return;
+
+	view_ = MapViewOfFile(mapping, FILE_MAP_READ, (DWORD) (start >> 32),
+		(DWORD) start, length_);
+	CloseHandle(mapping); // The view keeps the mapping alive
+	if (view_ == NULL)
+		return;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return;
+
+	struct stat info;
+	if (fstat(fd, &info) < 0 || offset > info.st_size)
+	{
+		close(fd);
+		return;
+	}
+
+	std::int64_t available = info.st_size - offset;
+	if (length < 0 || length > available)
+		length = available;
+	if ((std::uint64_t) length > SIZE_MAX)
+	{
+		close(fd);
+		return;
+	}
+
+	if (length == 0)
+	{
+		close(fd);
+		valid_ = true;
+		return;
+	}
+
+	std::int64_t page = sysconf(_SC_PAGESIZE);
+	std::int64_t start = offset - offset % page;
+	length_ = (size_t) (offset - start + length);
+
+	view_ = mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, (off_t) start);
+	close(fd); // The mapping keeps the file open
+	if (view_ == MAP_FAILED)
+	{
+		view_ = nullptr;
+		return;
+	}
+#endif
+
+	data_ = static_cast<const char *> (view_) + (offset - start);
+	size_ = (size_t) length;
+	valid_ = true;
+}
+
+//------------------------------------------------------------------------------
+
+MappedFile::~MappedFile()
+{
+	if (view_ == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(view_);
+#else
+	munmap(view_, length_);
+#endif
+}
+
+//==============================================================================
+
+File::File(const char *path, bool write)
+{
+#ifdef _WIN32
+	if (write)
+		handle_ = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+			FILE_ATTRIBUTE_NORMAL, NULL);
+	else
+		handle_ = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+#else
+	if (write)
+	{
+		unlink(path); // Replaced, not truncated under a mapping
+		fd_ = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	}
+	else
+		fd_ = open(path, O_RDONLY);
+#endif
+#ifdef __linux__
+	pipe_[0] = pipe_[1] = -1;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+File::~File()
+{
+#ifdef __linux__
+	if (pipe_[0] >= 0)
+	{
+		close(pipe_[0]);
+		close(pipe_[1]);
+	}
+#endif
+
+	if (!valid())
+		return;
+
+#ifdef _WIN32
+	CloseHandle(handle_);
+#else
+	close(fd_);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+bool File::valid() const
+{
+#ifdef _WIN32
+	return handle_ != INVALID_HANDLE_VALUE;
+#else
+	return fd_ >= 0;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+std::int64_t File::size() const
+{
+#ifdef _WIN32
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(handle_, &file_size))
+		return -1;
+	return file_size.QuadPart;
+#else
+	struct stat info;
+	if (fstat(fd_, &info) < 0)
+		return -1;
+	return info.st_size;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+long File::read(std::int64_t offset, char *buffer, size_t count)
+{
+	count = MIN(count, (size_t) LONG_MAX);
+
+#ifdef _WIN32
+	OVERLAPPED position = {};
+	position.Offset = (DWORD) offset;
+	position.OffsetHigh = (DWORD) (offset >> 32);
+
+	DWORD ret;
+	if (!ReadFile(handle_, buffer, (DWORD) MIN(count, (size_t) MAXDWORD), &ret,
+		&position))
+		return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+	return (long) ret;
+#else
+	return (long) pread(fd_, buffer, count, (off_t) offset);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+long File::write(std::int64_t offset, const char *buffer, size_t count)
+{
+	count = MIN(count, (size_t) LONG_MAX);
+
+	for (size_t done = 0; done < count;)
+	{
+	#ifdef _WIN32
+		OVERLAPPED position = {};
+		position.Offset = (DWORD) (offset + done);
+		position.OffsetHigh = (DWORD) ((offset + done) >> 32);
+
+		DWORD ret;
+		if (!WriteFile(handle_, buffer + done,
+			(DWORD) MIN(count - done, (size_t) MAXDWORD), &ret, &position))
+			return -1;
+	#else
+		ssize_t ret = pwrite(fd_, buffer + done, count - done,
+			(off_t) (offset + done));
+		if (ret < 0)
+			return -1;
+	#endif
+		done += ret;
+	}
+
+	return (long) count;
+}
+
+//------------------------------------------------------------------------------
+// Note: elsewhere the data passes through a buffer on the stack. Whatever the
+// socket does not accept is read again next time, which beats keeping it.
+
+long File::send(SOCKET sock, std::int64_t offset, size_t count)
+{
+	count = MIN(count, (size_t) LONG_MAX);
+
+#ifdef __linux__
+	// Unlike send, sendfile cannot be told not to raise SIGPIPE: we hold the
+	// signal back and discard it when the connection turns out to be broken.
+	sigset_t pipe, mask;
+	sigemptyset(&pipe);
+	sigaddset(&pipe, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &pipe, &mask);
+
+	off_t position = (off_t) offset;
+	long ret = (long) sendfile(sock, fd_, &position, count);
+	if (ret < 0 && errno == EPIPE)
+	{
+		timespec none = {0, 0};
+		sigtimedwait(&pipe, nullptr, &none);
+		errno = EPIPE;
+	}
+
+	pthread_sigmask(SIG_SETMASK, &mask, nullptr);
+	return ret;
+#else
+	char buffer[65536];
+	long ret = read(offset, buffer, MIN(count, sizeof (buffer)));
+	if (ret <= 0)
+		return ret;
+	return (long) ::send(sock, buffer, ret, MSG_NOSIGNAL);
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Note: splice needs a pipe on one end; what the socket gives is passed on to
+// the file right away so the pipe is always empty in between.
+
+long File::receive(SOCKET sock, std::int64_t offset, size_t count)
+{
+	count = MIN(count, (size_t) 65536);
+
+#ifdef __linux__
+	if (pipe_[0] < 0 && pipe(pipe_) < 0)
+	{
+		pipe_[0] = pipe_[1] = -1;
+		return -1;
+	}
+
+	long ret = (long) splice(sock, nullptr, pipe_[1], nullptr, count,
+		SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+	if (ret <= 0)
+		return ret;
+
+	loff_t position = (loff_t) offset;
+	for (long left = ret; left > 0;)
+	{
+		long moved = (long) splice(pipe_[0], nullptr, fd_, &position, left,
+			SPLICE_F_MOVE);
+		if (moved <= 0)
+			return -1;
+		left -= moved;
+	}
+	return ret;
+#else
+	char buffer[65536];
+	long ret = (long) recv(sock, buffer, count, 0);
+	if (ret <= 0)
+		return ret;
+	return write(offset, buffer, ret);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+bool replace_file(const char *from, const char *to)
+{
+#ifdef _WIN32
+	return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(from, to) == 0;
+#endif
+}
+
+//==============================================================================
+
+SharedMemory::SharedMemory(const char *name, size_t size)
+	: data_(nullptr), size_(0), error_(0)
+{
+#ifdef _WIN32
+	if (size > 0)
+	{
+		mapping_ = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL,
+			PAGE_READWRITE, (DWORD) ((std::uint64_t) size >> 32), (DWORD) size,
+			name);
+		if (mapping_ != NULL && GetLastError() == ERROR_ALREADY_EXISTS)
+		{
+			CloseHandle(mapping_);
+			mapping_ = NULL;
+			SetLastError(ERROR_ALREADY_EXISTS);
+		}
+	}
+	else
+		mapping_ = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+	
+	if (mapping_ == NULL)
+	{
+		error_ = GetLastError();
+		return;
+	}
+
+	void *view = MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (view == NULL)
+	{
+		error_ = GetLastError();
+		return;
+	}
+
+	// An opened region is as large as the pages it spans
+	MEMORY_BASIC_INFORMATION info;
+	VirtualQuery(view, &info, sizeof (info));
+	data_ = static_cast<char *> (view);
+	size_ = size > 0 ? size : info.RegionSize;
+#else
+	// Portable names start with a slash and contain no other
+	std::string path = name[0] == '/' ? name : std::string("/") + name;
+	bool create = size > 0;
+	
+	int fd = create
+		? shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600)
+		: shm_open(path.c_str(), O_RDWR, 0);
+	if (fd < 0)
+	{
+		error_ = errno;
+		return;
+	}
+	if (create)
+		name_ = path;
+	
+	struct stat info;
+	if (create ? ftruncate(fd, (off_t) size) < 0 : fstat(fd, &info) < 0)
+	{
+		error_ = errno;
+		close(fd);
+		return;
+	}
+	if (!create)
+		size = (size_t) info.st_size;
+	
+	void *view = MAP_FAILED;
+	if (size > 0)
+		view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (view == MAP_FAILED)
+		error_ = size > 0 ? errno : EINVAL;
+	close(fd); // The mapping keeps the region
+	if (view == MAP_FAILED)
+		return;
+	
+	data_ = static_cast<char *> (view);
+	size_ = size;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+SharedMemory::~SharedMemory()
+{
+#ifdef _WIN32
+	if (data_ != nullptr)
+		UnmapViewOfFile(data_);
+	if (mapping_ != NULL)
+		CloseHandle(mapping_);
+#else
+	if (data_ != nullptr)
+		munmap(data_, size_);
+	if (!name_.empty())
+		shm_unlink(name_.c_str());
+#endif
+}
+
 //------------------------------------------------------------------------------
 
 } /* namespace AGSSockAPI */
@@ -470,4 +901,73 @@ int setblocking(SOCKET sock, bool state)
 #endif
 }
 
+//------------------------------------------------------------------------------
+// Local addresses are as long as their path: the system refuses any longer
+// size, and an abstract name (Linux) would include the padding. Other addresses
+// keep the full size so that the raw data of an address stays the same.
+
+ADDRLEN address_size(const void *addr)
+{
+	if (CONST_ADDR(addr)->sa_family != AF_UNIX)
+		return sizeof (SOCKADDR_STORAGE);
+
+	const sockaddr_un *local = reinterpret_cast<const sockaddr_un *> (addr);
+	const char *path = local->sun_path;
+	size_t max = sizeof (local->sun_path);
+	size_t length;
+
+	if (path[0])
+		length = MIN(strnlen(path, max) + 1, max);
+	else if (path[1]) // Abstract: a null character and the name without one
+		length = strnlen(path + 1, max - 1) + 1;
+	else // Unnamed
+		length = 0;
+
+	return (ADDRLEN) (offsetof(sockaddr_un, sun_path) + length);
+}
+
+//------------------------------------------------------------------------------
+
+int socket_pair(int type, SOCKET pair[2])
+{
+#ifdef _WIN32
+	WSASetLastError(WSAEOPNOTSUPP);
+	return SOCKET_ERROR;
+#else
+	return socketpair(AF_UNIX, type, 0, pair);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+long sendv(SOCKET sock, const char *const data[], const size_t size[],
+	size_t count)
+{
+#ifdef _WIN32
+	std::vector<WSABUF> buffers(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		buffers[i].buf = const_cast<char *> (data[i]);
+		buffers[i].len = (ULONG) size[i];
+	}
+
+	DWORD sent;
+	if (WSASend(sock, buffers.data(), (DWORD) count, &sent, 0, NULL, NULL))
+		return SOCKET_ERROR;
+	return (long) sent;
+#else
+	std::vector<iovec> buffers(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		buffers[i].iov_base = const_cast<char *> (data[i]);
+		buffers[i].iov_len = size[i];
+	}
+
+	msghdr message = {};
+	message.msg_iov = buffers.data();
+	message.msg_iovlen = count;
+	return (long) sendmsg(sock, &message, 0);
+#endif
+}
+
 //..............................................................................
@@ -21,6 +21,17 @@
 	#include <winsock2.h>
 	#include <ws2tcpip.h>
 	
+	// Local sockets as declared by afunix.h, which older SDKs lack; creating
+	// one tells whether the system supports them.
+	#ifndef UNIX_PATH_MAX
+		#define UNIX_PATH_MAX 108
+		struct sockaddr_un
+		{
+			u_short sun_family;
+			char sun_path[UNIX_PATH_MAX];
+		};
+	#endif
+	
 	// Not supported prior to vista:
 	#ifndef AI_ADDRCONFIG
 		#define AI_ADDRCONFIG 0x0400
@@ -42,11 +53,20 @@
 	#endif
 
 	#define WOULD_BLOCK(x) ((x) == WSAEWOULDBLOCK)
+	#define WOULD_BLOCK_ERROR WSAEWOULDBLOCK
 	#define ALREADY(x) ((x) == WSAEALREADY || (x) == WSAEINVAL || (x) == WSAEWOULDBLOCK)
+	#define CONNECTION_ABORTED WSAECONNABORTED
+	#define HOST_UNREACHABLE WSAEHOSTUNREACH
+	#define TIMED_OUT WSAETIMEDOUT
+	#define INVALID_ARGUMENT WSAEINVAL
+	#define OPTION_UNSUPPORTED WSAENOPROTOOPT
+	#define NOT_SUPPORTED WSAEOPNOTSUPP
+	#define NOT_CONNECTED WSAENOTCONN
+	#define ALREADY_CONNECTED WSAEISCONN
 	#define GET_ERROR() WSAGetLastError()
 	#define RESET_ERROR()
 	#define ADDRLEN int
-	#define ADDR_SIZE(x) (sizeof (SOCKADDR_STORAGE))
+	#define ADDR_SIZE(x) (address_size(x))
 	#define ADDR_INIT(x, type) ((void) 0)
 #else
 	#include <errno.h>
@@ -56,7 +76,14 @@
 	#include <sys/socket.h>
 	#include <arpa/inet.h>
 	#include <netdb.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+	#include <netinet/udp.h>
 	#include <pthread.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <sys/uio.h>
+	#include <sys/un.h>
 	#include <time.h>
 	#include <string.h>
 	
@@ -72,7 +99,7 @@
 			: (type) == AF_INET6 ? sizeof (sockaddr_in6)          \
 			:                      sizeof (sockaddr_storage) )
 	#else
-		#define ADDR_SIZE(x) (sizeof (sockaddr_storage))
+		#define ADDR_SIZE(x) (address_size(x))
 		#define ADDR_INIT(x, type) ((void) 0)
 	#endif
 	#define closesocket close
@@ -80,15 +107,38 @@
 	#define SD_SEND SHUT_WR
 	#define SD_BOTH SHUT_RDWR
 	#define WOULD_BLOCK(x) ((x) == EAGAIN || (x) == EWOULDBLOCK)
+	#define WOULD_BLOCK_ERROR EWOULDBLOCK
 	#define ALREADY(x) ((x) == EINPROGRESS || (x) == EALREADY)
+	#define CONNECTION_ABORTED ECONNABORTED
+	#define HOST_UNREACHABLE EHOSTUNREACH
+	#define TIMED_OUT ETIMEDOUT
+	#define INVALID_ARGUMENT EINVAL
+	#define OPTION_UNSUPPORTED ENOPROTOOPT
+	#define NOT_SUPPORTED EOPNOTSUPP
+	#define NOT_CONNECTED ENOTCONN
+	#define ALREADY_CONNECTED EISCONN
 	#define GET_ERROR() errno
 	#define RESET_ERROR() do {errno = 0;} while (0)
 #endif
 
+// Sockets should report a broken connection as an error, not as a signal
+#ifndef MSG_NOSIGNAL
+	#define MSG_NOSIGNAL 0
+#endif
+
 #define ADDR(x) (reinterpret_cast<sockaddr *> (x))
 #define CONST_ADDR(x) (reinterpret_cast<const sockaddr *> (x))
 
 int setblocking(SOCKET sock, bool state);
+//! Returns the size the system expects for the address (see ADDR_SIZE)
+ADDRLEN address_size(const void *addr);
+//! Creates two local sockets that are connected to each other
+//! \returns zero when successful or SOCKET_ERROR
+int socket_pair(int type, SOCKET pair[2]);
+//! Sends count buffers in a single call, as if they were one
+//! \returns the number of bytes sent or SOCKET_ERROR
+long sendv(SOCKET sock, const char *const data[], const size_t size[],
+	size_t count);
 
 #ifndef MIN
 	#define MIN(a,b) (((a)<(b)) ? (a) : (b))
@@ -96,8 +146,11 @@ int setblocking(SOCKET sock, bool state);
 
 //------------------------------------------------------------------------------
 
+#include <climits>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <string>
 
 #include "agsplugin.h"
 
@@ -119,7 +172,10 @@ int setblocking(SOCKET sock, bool state);
 #define AGS_READONLY(c,x) engine->RegisterScriptFunction(#c "::get_" #x, (void *) (c ## _get_ ## x));
 #define AGS_ARRAY(c,x)    engine->RegisterScriptFunction(#c "::geti_" #x, (void *) (c ## _geti_ ## x)); \
                           engine->RegisterScriptFunction(#c "::seti_" #x, (void *) (c ## _seti_ ## x));
+#define AGS_INDEXED(c,x)  engine->RegisterScriptFunction(#c "::geti_" #x, (void *) (c ## _geti_ ## x));
 #define AGS_CLASS(c)      engine->AddManagedObjectReader(#c, &ags ## c);
+// Keeps games working that were compiled before a method got more parameters
+#define AGS_LEGACY(c,x,a) engine->RegisterScriptFunction(#c "::" #x "^" #a, (void *) (c ## _ ## x ## a));
 
 // Note: Unfortunately AGS makes assumptions about the size of 'int' and 'long',
 // specifically, long is used to pass around both integral and pointer values
@@ -224,6 +280,56 @@ class Mutex
 
 //------------------------------------------------------------------------------
 
+//! Counting semaphore class
+class Semaphore
+{
+#ifdef _WIN32
+	HANDLE handle;
+	
+	public:
+	Semaphore() { handle = CreateSemaphore(NULL, 0, LONG_MAX, NULL); }
+	~Semaphore() { CloseHandle(handle); }
+	void wait() { WaitForSingleObject(handle, INFINITE); } //!< Takes a unit, waits for one if needed
+	void post() { ReleaseSemaphore(handle, 1, NULL); }    //!< Adds a unit, waking a waiting party
+#else
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	unsigned count;
+	
+	public:
+	Semaphore() : count(0)
+	{
+		pthread_mutex_init(&mutex, NULL);
+		pthread_cond_init(&cond, NULL);
+	}
+	~Semaphore()
+	{
+		pthread_cond_destroy(&cond);
+		pthread_mutex_destroy(&mutex);
+	}
+	void wait()
+	{
+		pthread_mutex_lock(&mutex);
+		while (count == 0)
+			pthread_cond_wait(&cond, &mutex);
+		--count;
+		pthread_mutex_unlock(&mutex);
+	}
+	void post()
+	{
+		pthread_mutex_lock(&mutex);
+		++count;
+		pthread_cond_signal(&cond);
+		pthread_mutex_unlock(&mutex);
+	}
+#endif
+
+	Semaphore(const Semaphore &) = delete;
+	void operator =(const Semaphore &) = delete;
+};
+
+//------------------------------------------------------------------------------
+
 //! Concurrent execution class
 class Thread
 {
@@ -288,6 +394,116 @@ class Beacon
 
 //------------------------------------------------------------------------------
 
+//! Read-only memory mapped file section
+//! \warning The file must not be truncated while it is mapped: touching the
+//! pages past its new end crashes the process (SIGBUS) on most systems. Files
+//! are therefore replaced rather than emptied by File and replace_file.
+class MappedFile
+{
+	public:
+	//! Maps length bytes of a file starting at offset; a negative length maps
+	//! up to the end of the file.
+	MappedFile(const char *path, std::int64_t offset, std::int64_t length);
+	~MappedFile(); //!< Unmaps the file
+
+	bool valid() const { return valid_; }       //!< Whether mapping succeeded
+	const char *data() const { return data_; }  //!< The mapped bytes
+	size_t size() const { return size_; }       //!< The number of mapped bytes
+
+	MappedFile(const MappedFile &) = delete;
+	void operator =(const MappedFile &) = delete;
+
+	private:
+	bool valid_;
+	const char *data_;
+	size_t size_;
+	void *view_;     //!< Start of the mapping, aligned to the page size
+	size_t length_;  //!< Length of the mapping
+};
+
+//------------------------------------------------------------------------------
+
+//! File accessed at explicit offsets
+class File
+{
+	public:
+	//! Opens a file for reading or, when writing, creates it; an existing file
+	//! is replaced by a new one rather than emptied, so mappings of it keep
+	//! their content (on Windows a mapped file cannot be replaced: this fails).
+	File(const char *path, bool write = false);
+	~File(); //!< Closes the file
+
+	bool valid() const;        //!< Whether opening succeeded
+	std::int64_t size() const; //!< The size of the file, or -1 on failure
+
+	//! Reads up to count bytes starting at offset
+	//! \returns the number of bytes read, 0 at the end or -1 on failure
+	long read(std::int64_t offset, char *buffer, size_t count);
+	//! Writes count bytes starting at offset
+	//! \returns the number of bytes written or -1 on failure
+	long write(std::int64_t offset, const char *buffer, size_t count);
+	//! Sends up to count bytes starting at offset to a (non-blocking) socket;
+	//! on Linux the data is copied by the kernel and never enters the process.
+	//! \returns the number of bytes sent, 0 at the end or -1 on failure
+	long send(SOCKET sock, std::int64_t offset, size_t count);
+	//! Writes up to count bytes received from a (non-blocking) stream socket
+	//! starting at offset; on Linux the data moves through a pipe within the
+	//! kernel and never enters the process.
+	//! \returns the number of bytes written, 0 at the end of the stream or -1
+	//! on failure
+	long receive(SOCKET sock, std::int64_t offset, size_t count);
+
+	File(const File &) = delete;
+	void operator =(const File &) = delete;
+
+	private:
+	#ifdef _WIN32
+		HANDLE handle_;
+	#else
+		int fd_;
+	#endif
+	#ifdef __linux__
+		int pipe_[2]; //!< Carries received data to the file, made when needed
+	#endif
+};
+
+//! Moves a file to another path, replacing the file that is there as a whole
+//! (mappings of the old one keep their content, like with File)
+//! \returns whether it succeeded
+bool replace_file(const char *from, const char *to);
+
+//------------------------------------------------------------------------------
+
+//! Memory shared with other processes under a name
+class SharedMemory
+{
+	public:
+	//! Creates a region of size bytes filled with zeroes; fails when the name
+	//! is taken. A size of zero opens the region created under the name.
+	SharedMemory(const char *name, size_t size);
+	~SharedMemory(); //!< Unmaps the region; the creator also removes the name
+
+	bool valid() const { return data_ != nullptr; } //!< Whether it succeeded
+	char *data() const { return data_; }  //!< The shared bytes
+	size_t size() const { return size_; } //!< The number of shared bytes
+	int error() const { return error_; }  //!< Why creating or opening failed
+
+	SharedMemory(const SharedMemory &) = delete;
+	void operator =(const SharedMemory &) = delete;
+
+	private:
+	char *data_;
+	size_t size_;
+	int error_;
+	#ifdef _WIN32
+		HANDLE mapping_; //!< Keeps the region and its name alive
+	#else
+		std::string name_; //!< Removed again by the creator, empty otherwise
+	#endif
+};
+
+//------------------------------------------------------------------------------
+
 } /* namespace AGSSockAPI */
 
 #endif /* _API_H */
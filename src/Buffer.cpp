@@ -11,22 +11,40 @@ namespace AGSSock {
 void Buffer::extract()
 {
 	// Not checked for empty
-	string &buffer = queue_.front();
+	string &buffer = queue_.front().data;
 	size_t pos = buffer.find_first_of('\0');
 	if (pos == string::npos)
-		queue_.pop();
+		queue_.pop_front();
 	else
 	{
 		pos = buffer.find_first_not_of('\0', pos);
 		buffer.erase(0, pos);
 		// Empty strings should only be generated by the sockets API
 		if (buffer.empty())
-			queue_.pop();
+			queue_.pop_front();
 	}
 }
 
 //------------------------------------------------------------------------------
 
+void Buffer::split(const char *data, size_t count, size_t segment,
+	const SOCKADDR_STORAGE &source)
+{
+	if (segment == 0)
+		segment = count;
+
+	do
+	{
+		size_t size = segment < count ? segment : count;
+		push(data, size, source);
+		data += size;
+		count -= size;
+	}
+	while (count > 0);
+}
+
+//------------------------------------------------------------------------------
+
 } /* namespace AGSSock */
 
 //..............................................................................
@@ -14,9 +14,11 @@
 #define _BUFFER_H
 
 #include <cstddef>
-#include <queue>
+#include <deque>
 #include <string>
 
+#include "API.h"
+
 namespace AGSSock {
 
 //------------------------------------------------------------------------------
@@ -24,11 +26,18 @@ namespace AGSSock {
 //! Socket buffer
 
 //! A data structure that enqueues both packet based and streaming data.
+//! Packets may carry the address they were received from.
 class Buffer
 {
 	using string = std::string;
 
-	std::queue<string> queue_;
+	struct Element
+	{
+		string data;
+		SOCKADDR_STORAGE source;
+	};
+
+	std::deque<Element> queue_;
 
 	public:
 	int error; //!< A potential error code the last operation caused
@@ -37,21 +46,42 @@ class Buffer
 
 	//! Access the first element of the buffer
 	inline string &front()
-		{ return queue_.front(); }
+		{ return queue_.front().data; }
 	inline const string &front() const
-		{ return queue_.front(); }
+		{ return queue_.front().data; }
+
+	//! Access the source address of the first element (zero if unknown)
+	inline const SOCKADDR_STORAGE &source() const
+		{ return queue_.front().source; }
 
 	//! Returns if the buffer is empty
 	inline bool empty() const
 		{ return queue_.empty(); }
 
+	//! Returns the number of elements in the buffer
+	inline size_t size() const
+		{ return queue_.size(); }
+	//! Access an element of the buffer, counting from the first
+	inline const string &at(size_t index) const
+		{ return queue_[index].data; }
+
 	//! Adds a new data-string to the buffer (back)
 	inline void push(const char *data, size_t count)
-		{ queue_.push(string(data, count)); }
+		{ queue_.push_back(Element {string(data, count), {}}); }
+
+	//! Adds a new data-string to the buffer (back) along with its source
+	inline void push(const char *data, size_t count,
+		const SOCKADDR_STORAGE &source)
+		{ queue_.push_back(Element {string(data, count), source}); }
+
+	//! Adds datagrams that arrived coalesced into one piece of data, each
+	//! segment bytes long except perhaps the last, along with their source
+	void split(const char *data, size_t count, size_t segment,
+		const SOCKADDR_STORAGE &source);
 
 	//! Removes the first element of the buffer
 	inline void pop()
-		{ queue_.pop(); }
+		{ queue_.pop_front(); }
 	
 	//! Appends a data-string to the (last element of the) buffer
 	//! \note zero-length strings indicate EoF,
@@ -59,9 +89,9 @@ class Buffer
 	inline void append(const char *data, size_t count)
 	{
 		if (queue_.empty() || count == 0)
-			queue_.push(string(data, count));
+			push(data, count);
 		else
-			queue_.back().append(data, count);
+			queue_.back().data.append(data, count);
 	}
 	
 	//! Removes the first zero-terminated string from the buffer.
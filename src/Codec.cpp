@@ -0,0 +1,415 @@
+/*********************************************************
+ * Data codecs -- See header file for more information. *
+ *********************************************************/
+
+#include <cstdint>
+#include <cstring>
+
+#include "Codec.h"
+
+// SSE2 is part of the x86-64 baseline and is enabled by default by most
+// 32-bit x86 toolchains too; other targets use the scalar code paths.
+#if defined(__SSE2__) || defined(_M_X64) \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CODEC_SSE2
+	#include <emmintrin.h>
+#endif
+
+namespace AGSSock {
+
+using std::string;
+using std::uint8_t;
+using std::uint32_t;
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+const char base64_alphabet[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+const char hex_alphabet[] = "0123456789abcdef";
+
+const uint8_t INVALID = 0xFF;
+
+//! Reverse lookup tables, these map characters back to their values
+struct Tables
+{
+	uint8_t base64[256];
+	uint8_t hex[256];
+
+	Tables()
+	{
+		memset(base64, INVALID, sizeof (base64));
+		memset(hex, INVALID, sizeof (hex));
+
+		for (int i = 0; i < 64; ++i)
+			base64[(uint8_t) base64_alphabet[i]] = i;
+
+		for (int i = 0; i < 16; ++i)
+			hex[(uint8_t) hex_alphabet[i]] = i;
+		for (int i = 10; i < 16; ++i)
+			hex[(uint8_t) (hex_alphabet[i] & ~0x20)] = i; // Upper case
+	}
+} const tables;
+
+} /* namespace */
+
+//==============================================================================
+
+void base64_encode(const char *data, size_t count, string &out)
+{
+	const uint8_t *in = reinterpret_cast<const uint8_t *> (data);
+	size_t offset = out.size();
+	out.resize(offset + (count + 2) / 3 * 4);
+	char *ptr = &out[0] + offset;
+
+	// Full blocks of 3 bytes map to 4 characters each
+	for (; count >= 3; count -= 3, in += 3, ptr += 4)
+	{
+		uint32_t block = (in[0] << 16) | (in[1] << 8) | in[2];
+		ptr[0] = base64_alphabet[(block >> 18) & 0x3F];
+		ptr[1] = base64_alphabet[(block >> 12) & 0x3F];
+		ptr[2] = base64_alphabet[(block >> 6) & 0x3F];
+		ptr[3] = base64_alphabet[block & 0x3F];
+	}
+
+	// Remaining bytes are padded
+	if (count > 0)
+	{
+		uint32_t block = (in[0] << 16) | (count > 1 ? in[1] << 8 : 0);
+		ptr[0] = base64_alphabet[(block >> 18) & 0x3F];
+		ptr[1] = base64_alphabet[(block >> 12) & 0x3F];
+		ptr[2] = count > 1 ? base64_alphabet[(block >> 6) & 0x3F] : '=';
+		ptr[3] = '=';
+	}
+}
+
+//------------------------------------------------------------------------------
+
+bool base64_decode(const char *str, size_t count, string &out)
+{
+	if (count % 4)
+		return false;
+	if (count == 0)
+		return true;
+
+	const uint8_t *in = reinterpret_cast<const uint8_t *> (str);
+	size_t padding = (in[count - 1] == '=') + (in[count - 2] == '=');
+	size_t offset = out.size();
+	out.resize(offset + count / 4 * 3 - padding);
+	char *ptr = &out[0] + offset;
+
+	// All but the last block; validity is accumulated and checked once so the
+	// loop itself is free of branches.
+	uint8_t invalid = 0;
+	const uint8_t *end = in + count - 4;
+	for (; in < end; in += 4, ptr += 3)
+	{
+		uint8_t a = tables.base64[in[0]], b = tables.base64[in[1]];
+		uint8_t c = tables.base64[in[2]], d = tables.base64[in[3]];
+		invalid |= a | b | c | d;
+
+		uint32_t block = (a << 18) | (b << 12) | (c << 6) | d;
+		ptr[0] = (char) (block >> 16);
+		ptr[1] = (char) (block >> 8);
+		ptr[2] = (char) block;
+	}
+
+	if (invalid & 0xC0)
+		return false;
+
+	// The last block may be padded; the padded bits must be zero so that
+	// every data string has exactly one representation.
+	uint8_t a = tables.base64[in[0]], b = tables.base64[in[1]];
+	uint8_t c = padding > 1 ? 0 : tables.base64[in[2]];
+	uint8_t d = padding > 0 ? 0 : tables.base64[in[3]];
+	if ((a | b | c | d) & 0xC0)
+		return false;
+
+	uint32_t block = (a << 18) | (b << 12) | (c << 6) | d;
+	ptr[0] = (char) (block >> 16);
+	if (padding < 2)
+		ptr[1] = (char) (block >> 8);
+	if (padding < 1)
+		ptr[2] = (char) block;
+
+	if (padding == 2 && (block & 0xFFFF))
+		return false;
+	if (padding == 1 && (block & 0xFF))
+		return false;
+
+	return true;
+}
+
+//==============================================================================
+
+void hex_encode(const char *data, size_t count, string &out)
+{
+	const uint8_t *in = reinterpret_cast<const uint8_t *> (data);
+	size_t offset = out.size();
+	out.resize(offset + count * 2);
+	char *ptr = &out[0] + offset;
+
+#ifdef CODEC_SSE2
+	const __m128i nibble = _mm_set1_epi8(0x0F);
+	const __m128i nine = _mm_set1_epi8(9);
+	const __m128i digit = _mm_set1_epi8('0');
+	const __m128i letter = _mm_set1_epi8('a' - '0' - 10);
+
+	for (; count >= 16; count -= 16, in += 16, ptr += 32)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *> (in));
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+		__m128i lo = _mm_and_si128(v, nibble);
+
+		__m128i a = _mm_unpacklo_epi8(hi, lo);
+		__m128i b = _mm_unpackhi_epi8(hi, lo);
+
+		a = _mm_add_epi8(_mm_add_epi8(a, digit),
+			_mm_and_si128(_mm_cmpgt_epi8(a, nine), letter));
+		b = _mm_add_epi8(_mm_add_epi8(b, digit),
+			_mm_and_si128(_mm_cmpgt_epi8(b, nine), letter));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i *> (ptr), a);
+		_mm_storeu_si128(reinterpret_cast<__m128i *> (ptr + 16), b);
+	}
+#endif
+
+	for (; count > 0; --count, ++in, ptr += 2)
+	{
+		ptr[0] = hex_alphabet[*in >> 4];
+		ptr[1] = hex_alphabet[*in & 0x0F];
+	}
+}
+
+//------------------------------------------------------------------------------
+
+bool hex_decode(const char *str, size_t count, string &out)
+{
+	if (count % 2)
+		return false;
+
+	const uint8_t *in = reinterpret_cast<const uint8_t *> (str);
+	size_t offset = out.size();
+	out.resize(offset + count / 2);
+	char *ptr = &out[0] + offset;
+
+#ifdef CODEC_SSE2
+	const __m128i zero = _mm_set1_epi8('0');
+	const __m128i lower = _mm_set1_epi8('a');
+	const __m128i caseless = _mm_set1_epi8(0x20);
+	const __m128i nine = _mm_set1_epi8(9);
+	const __m128i five = _mm_set1_epi8(5);
+	const __m128i ten = _mm_set1_epi8(10);
+	const __m128i low_byte = _mm_set1_epi16(0x00FF);
+
+	for (; count >= 32; count -= 32, in += 32, ptr += 16)
+	{
+		__m128i v[2] =
+		{
+			_mm_loadu_si128(reinterpret_cast<const __m128i *> (in)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i *> (in + 16))
+		};
+
+		for (__m128i &x : v)
+		{
+			// Unsigned range checks: x <= max iff min(x, max) == x
+			__m128i d = _mm_sub_epi8(x, zero);
+			__m128i l = _mm_sub_epi8(_mm_or_si128(x, caseless), lower);
+			__m128i is_d = _mm_cmpeq_epi8(_mm_min_epu8(d, nine), d);
+			__m128i is_l = _mm_cmpeq_epi8(_mm_min_epu8(l, five), l);
+
+			if (_mm_movemask_epi8(_mm_or_si128(is_d, is_l)) != 0xFFFF)
+				return false;
+
+			x = _mm_or_si128(_mm_and_si128(is_d, d),
+				_mm_and_si128(is_l, _mm_add_epi8(l, ten)));
+
+			// Merge the nibble pairs in every 16-bit lane
+			x = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(x, low_byte), 4),
+				_mm_srli_epi16(x, 8));
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i *> (ptr),
+			_mm_packus_epi16(v[0], v[1]));
+	}
+#endif
+
+	uint8_t invalid = 0;
+	for (; count > 0; count -= 2, in += 2, ++ptr)
+	{
+		uint8_t hi = tables.hex[in[0]], lo = tables.hex[in[1]];
+		invalid |= hi | lo;
+		*ptr = (char) ((hi << 4) | (lo & 0x0F));
+	}
+
+	return !(invalid & 0xF0);
+}
+
+//==============================================================================
+// Both the unchanged runs and the changes are encoded as varints. Bytes past
+// the end of the base always count as changed (XOR-ed with zero), so that the
+// size of the result is bounded by the sizes of the base and the delta.
+
+namespace {
+
+//! Short unchanged runs between changes are cheaper to include in the change
+const size_t MIN_RUN = 3;
+
+//! Returns the length of the common prefix of a and b
+size_t match_length(const uint8_t *a, const uint8_t *b, size_t count)
+{
+	size_t i = 0;
+
+#ifdef CODEC_SSE2
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *> (a + i));
+		__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *> (b + i));
+		unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) ^ 0xFFFF;
+		if (mask)
+		{
+			while (!(mask & 1))
+				mask >>= 1, ++i;
+			return i;
+		}
+	}
+#endif
+
+	for (; i < count && a[i] == b[i]; ++i);
+	return i;
+}
+
+//------------------------------------------------------------------------------
+
+//! Returns the length of the prefix that has no unchanged runs of MIN_RUN
+size_t change_length(const uint8_t *a, const uint8_t *b, size_t count)
+{
+	size_t i = 0, run = 0;
+	for (; i < count && run < MIN_RUN; ++i)
+		run = (a[i] == b[i]) ? run + 1 : 0;
+	return i - run;
+}
+
+//------------------------------------------------------------------------------
+
+void xor_bytes(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t count)
+{
+	size_t i = 0;
+
+#ifdef CODEC_SSE2
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *> (a + i));
+		__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *> (b + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *> (out + i),
+			_mm_xor_si128(x, y));
+	}
+#endif
+
+	for (; i < count; ++i)
+		out[i] = a[i] ^ b[i];
+}
+
+} /* namespace */
+
+//------------------------------------------------------------------------------
+
+void delta_encode(const char *base, size_t base_count, const char *data,
+	size_t count, string &out)
+{
+	const uint8_t *a = reinterpret_cast<const uint8_t *> (base);
+	const uint8_t *b = reinterpret_cast<const uint8_t *> (data);
+	size_t common = base_count < count ? base_count : count;
+
+	varint_encode(count, out);
+
+	for (size_t pos = 0; pos < count;)
+	{
+		size_t skip = match_length(a + pos, b + pos, common - pos);
+		pos += skip;
+		if (pos == count)
+			break;
+
+		size_t length = change_length(a + pos, b + pos, common - pos);
+		if (pos + length >= common)
+			length = count - pos; // The rest is changed or past the base
+
+		varint_encode(skip, out);
+		varint_encode(length, out);
+
+		size_t offset = out.size();
+		out.resize(offset + length);
+		uint8_t *ptr = reinterpret_cast<uint8_t *> (&out[0]) + offset;
+		size_t overlap = pos < common ? common - pos : 0;
+		if (overlap > length)
+			overlap = length;
+		xor_bytes(a + pos, b + pos, ptr, overlap);
+		memcpy(ptr + overlap, b + pos + overlap, length - overlap);
+		pos += length;
+	}
+}
+
+//------------------------------------------------------------------------------
+
+bool delta_decode(const char *base, size_t base_count, const char *delta,
+	size_t count, string &out)
+{
+	size_t pos = 0;
+	std::uint64_t size;
+	if (!varint_decode(delta, count, pos, size) || size > base_count + count)
+		return false;
+
+	size_t offset = out.size();
+	out.append(base, size < base_count ? size : base_count);
+	out.resize(offset + size);
+	uint8_t *ptr = reinterpret_cast<uint8_t *> (&out[0]) + offset;
+	const uint8_t *in = reinterpret_cast<const uint8_t *> (delta);
+
+	for (std::uint64_t at = 0; pos < count;)
+	{
+		std::uint64_t skip, length;
+		if (!varint_decode(delta, count, pos, skip)
+			|| !varint_decode(delta, count, pos, length)
+			|| skip > size - at || length > size - at - skip
+			|| length > count - pos)
+			return false;
+
+		at += skip;
+		xor_bytes(ptr + at, in + pos, ptr + at, length);
+		at += length;
+		pos += length;
+	}
+	return true;
+}
+
+//==============================================================================
+
+void varint_encode(std::uint64_t value, string &out)
+{
+	for (; value >= 0x80; value >>= 7)
+		out += (char) ((value & 0x7F) | 0x80);
+	out += (char) value;
+}
+
+//------------------------------------------------------------------------------
+
+bool varint_decode(const char *data, size_t count, size_t &pos,
+	std::uint64_t &value)
+{
+	value = 0;
+	for (int shift = 0; pos < count && shift < 64; shift += 7)
+	{
+		uint8_t byte = (uint8_t) data[pos++];
+		value |= (std::uint64_t) (byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+//..............................................................................
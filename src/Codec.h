@@ -0,0 +1,64 @@
+/*******************************************************
+ * Data codecs -- header file                          *
+ *                                                     *
+ * Author: Ferry "Wyz" Timmers                         *
+ *                                                     *
+ * Date: 10:12 2026-10-18                              *
+ *                                                     *
+ * Description: Provides fast conversions of binary    *
+ *              data to and from textual and other     *
+ *              transport friendly representations.    *
+ *******************************************************/
+
+#ifndef _CODEC_H
+#define _CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace AGSSock {
+
+//------------------------------------------------------------------------------
+
+//! Appends the Base64 representation (RFC 4648, padded) of the data to out
+void base64_encode(const char *data, size_t count, std::string &out);
+//! Appends the data represented by a Base64 string to out
+//! \returns false if the input is not canonical padded Base64; out is then
+//! left in an unspecified state.
+bool base64_decode(const char *str, size_t count, std::string &out);
+
+//! Appends the (lower case) hexadecimal representation of the data to out
+void hex_encode(const char *data, size_t count, std::string &out);
+//! Appends the data represented by a hexadecimal string to out
+//! \returns false if the input has an odd length or contains characters other
+//! than hexadecimal digits (of either case); out is then left in an
+//! unspecified state.
+bool hex_decode(const char *str, size_t count, std::string &out);
+
+//! Appends a delta that turns base into data to out
+//! The delta consists of the size of data followed by a series of unchanged
+//! run lengths and the XOR of the changed bytes that follow them.
+void delta_encode(const char *base, size_t base_count, const char *data,
+	size_t count, std::string &out);
+//! Appends the data made by applying a delta to base to out
+//! \returns false if the delta is malformed; out is then left in an
+//! unspecified state. Applying a delta to a different base than it was made
+//! from yields garbage rather than an error.
+bool delta_decode(const char *base, size_t base_count, const char *delta,
+	size_t count, std::string &out);
+
+//! Appends an unsigned integer in a variable length (LEB128) encoding to out
+void varint_encode(std::uint64_t value, std::string &out);
+//! Reads a variable length encoded unsigned integer at pos and advances pos
+//! \returns false if the encoding is truncated or overflows 64 bits
+bool varint_decode(const char *data, size_t count, size_t &pos,
+	std::uint64_t &value);
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+#endif /* _CODEC_H */
+
+//..............................................................................
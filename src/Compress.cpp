@@ -0,0 +1,400 @@
+/**************************************************************
+ * Data compression -- See header file for more information. *
+ **************************************************************/
+
+#include <algorithm>
+#include <cstring>
+
+#include "Codec.h"
+#include "Compress.h"
+
+namespace AGSSock {
+
+using std::string;
+using std::uint8_t;
+using std::uint32_t;
+using std::uint64_t;
+
+//------------------------------------------------------------------------------
+// The output follows the LZ4 block format: a series of sequences, each of
+// which consists of a token (literal length, match length), the literals and
+// a match (2-byte offset). The last sequence only has literals.
+
+namespace {
+
+const size_t MIN_MATCH = 4;      //!< Shortest encodable match
+const size_t LAST_LITERALS = 5;  //!< The last bytes are always literals
+const size_t MF_LIMIT = 12;      //!< No match starts this close to the end
+const size_t MAX_OFFSET = 65535; //!< Largest distance of a match
+const int HASH_BITS = 13;        //!< Size of the match finder hash table
+const int SKIP_TRIGGER = 6;      //!< Speeds up scanning incompressible data
+const size_t MAX_FRAME = 65536;  //!< Largest frame size of a stream
+
+inline uint32_t read32(const uint8_t *ptr)
+{
+	uint32_t value;
+	memcpy(&value, ptr, sizeof (value));
+	return value;
+}
+
+inline uint64_t read64(const uint8_t *ptr)
+{
+	uint64_t value;
+	memcpy(&value, ptr, sizeof (value));
+	return value;
+}
+
+inline uint32_t hash(uint32_t sequence)
+{
+	return (sequence * 2654435761U) >> (32 - HASH_BITS);
+}
+
+//------------------------------------------------------------------------------
+
+inline uint8_t *write_length(uint8_t *op, size_t length)
+{
+	for (; length >= 255; length -= 255)
+		*op++ = 255;
+	*op++ = (uint8_t) length;
+	return op;
+}
+
+// Fails once the length exceeds the limit (the room left in the output), which
+// also keeps it from overflowing.
+inline bool read_length(const uint8_t *&ip, const uint8_t *iend, size_t &length,
+	size_t limit)
+{
+	uint8_t byte;
+	do
+	{
+		if (ip >= iend || length > limit)
+			return false;
+		byte = *ip++;
+		length += byte;
+	} while (byte == 255);
+	return true;
+}
+
+uint8_t *write_sequence(uint8_t *op, const uint8_t *literals, size_t count,
+	size_t offset, size_t length)
+{
+	uint8_t *token = op++;
+	length -= MIN_MATCH;
+	*token = (uint8_t) ((std::min<size_t>(count, 15) << 4)
+		| std::min<size_t>(length, 15));
+
+	if (count >= 15)
+		op = write_length(op, count - 15);
+	memcpy(op, literals, count);
+	op += count;
+
+	*op++ = (uint8_t) (offset & 0xFF);
+	*op++ = (uint8_t) (offset >> 8);
+
+	if (length >= 15)
+		op = write_length(op, length - 15);
+	return op;
+}
+
+uint8_t *write_literals(uint8_t *op, const uint8_t *literals, size_t count)
+{
+	*op++ = (uint8_t) (std::min<size_t>(count, 15) << 4);
+	if (count >= 15)
+		op = write_length(op, count - 15);
+	memcpy(op, literals, count);
+	return op + count;
+}
+
+//------------------------------------------------------------------------------
+
+//! Compresses the bytes of window in [prefix, end); matches may refer back
+//! into the first prefix bytes. The table holds positions relative to window,
+//! offset by base; entries from before the window are ignored.
+void compress_window(const uint8_t *window, size_t prefix, size_t end,
+	uint32_t *table, string &out, uint32_t base = 0)
+{
+	size_t count = end - prefix;
+	size_t offset = out.size();
+	out.resize(offset + count + count / 255 + 16);
+	uint8_t *start = reinterpret_cast<uint8_t *> (&out[0]) + offset;
+	uint8_t *op = start;
+
+	const uint8_t *ip = window + prefix, *anchor = ip;
+	const uint8_t *iend = window + end;
+
+	if (count > MF_LIMIT)
+	{
+		const uint8_t *mflimit = iend - MF_LIMIT;
+		const uint8_t *matchlimit = iend - LAST_LITERALS;
+		size_t misses = 0;
+
+		while (ip < mflimit)
+		{
+			uint32_t sequence = read32(ip);
+			uint32_t &entry = table[hash(sequence)];
+			uint32_t position = entry - base;
+			entry = (uint32_t) (ip - window) + base;
+
+			if (position >= (uint32_t) (ip - window)
+				|| (size_t) (ip - window) - position > MAX_OFFSET
+				|| read32(window + position) != sequence)
+			{
+				ip += 1 + (misses++ >> SKIP_TRIGGER);
+				continue;
+			}
+			misses = 0;
+			const uint8_t *ref = window + position;
+
+			// Extend the match backwards over pending literals
+			while (ip > anchor && ref > window && ip[-1] == ref[-1])
+				--ip, --ref;
+
+			// Extend the match forwards, a word at a time while possible
+			const uint8_t *mp = ip + MIN_MATCH, *rp = ref + MIN_MATCH;
+			while (mp + 8 <= matchlimit && read64(mp) == read64(rp))
+				mp += 8, rp += 8;
+			while (mp < matchlimit && *mp == *rp)
+				++mp, ++rp;
+
+			op = write_sequence(op, anchor, ip - anchor, ip - ref, mp - ip);
+			ip = anchor = mp;
+
+			if (ip < mflimit)
+				table[hash(read32(ip - 2))] = (uint32_t) (ip - 2 - window)
+					+ base;
+		}
+	}
+
+	op = write_literals(op, anchor, iend - anchor);
+	out.resize(offset + (op - start));
+}
+
+//------------------------------------------------------------------------------
+
+//! Decompresses into the bytes of window in [prefix, end); matches may refer
+//! back into the first prefix bytes.
+bool decompress_window(const uint8_t *ip, size_t count, uint8_t *window,
+	size_t prefix, size_t end)
+{
+	const uint8_t *iend = ip + count;
+	uint8_t *op = window + prefix, *oend = window + end;
+
+	for (;;)
+	{
+		if (ip >= iend)
+			return false;
+
+		unsigned token = *ip++;
+
+		size_t literals = token >> 4;
+		if (literals == 15 && !read_length(ip, iend, literals, oend - op))
+			return false;
+		if ((size_t) (iend - ip) < literals || (size_t) (oend - op) < literals)
+			return false;
+		memcpy(op, ip, literals);
+		op += literals;
+		ip += literals;
+
+		// The last sequence has no match
+		if (ip == iend)
+			return op == oend;
+
+		if (iend - ip < 2)
+			return false;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+
+		size_t length = token & 15;
+		if (length == 15 && !read_length(ip, iend, length, oend - op))
+			return false;
+		length += MIN_MATCH;
+
+		if (offset == 0 || offset > (size_t) (op - window)
+			|| (size_t) (oend - op) < length)
+			return false;
+
+		const uint8_t *ref = op - offset;
+		if (offset >= length)
+			memcpy(op, ref, length), op += length;
+		else // Overlapping matches repeat the preceding bytes
+			while (length--)
+				*op++ = *ref++;
+	}
+}
+
+} /* namespace */
+
+//==============================================================================
+
+Dictionary::Dictionary(const char *data, size_t count)
+	: table_(1 << HASH_BITS, 0)
+{
+	if (count > MAX_SIZE)
+	{
+		data += count - MAX_SIZE;
+		count = MAX_SIZE;
+	}
+	data_.assign(data, count);
+
+	const uint8_t *ptr = reinterpret_cast<const uint8_t *> (data_.data());
+	for (size_t i = 0; i + MIN_MATCH <= count; ++i)
+		table_[hash(read32(ptr + i))] = (uint32_t) i;
+}
+
+//------------------------------------------------------------------------------
+
+void compress(const char *data, size_t count, string &out,
+	const Dictionary *dict)
+{
+	if (dict == nullptr)
+	{
+		std::vector<uint32_t> table(1 << HASH_BITS, 0);
+		compress_window(reinterpret_cast<const uint8_t *> (data), 0, count,
+			table.data(), out);
+		return;
+	}
+
+	// Matches are found in a window where the dictionary precedes the data
+	std::vector<uint32_t> table(dict->table());
+	string window;
+	window.reserve(dict->data().size() + count);
+	window.assign(dict->data()).append(data, count);
+
+	compress_window(reinterpret_cast<const uint8_t *> (window.data()),
+		dict->data().size(), window.size(), table.data(), out);
+}
+
+//------------------------------------------------------------------------------
+
+bool decompress(const char *data, size_t count, size_t size, string &out,
+	const Dictionary *dict)
+{
+	if (size > decompress_bound(count))
+		return false;
+
+	const uint8_t *in = reinterpret_cast<const uint8_t *> (data);
+
+	if (dict == nullptr)
+	{
+		size_t offset = out.size();
+		out.resize(offset + size);
+		return decompress_window(in, count,
+			reinterpret_cast<uint8_t *> (&out[0]) + offset, 0, size);
+	}
+
+	// Matches may refer into a dictionary that precedes the output
+	size_t prefix = dict->data().size();
+	string window;
+	window.reserve(prefix + size);
+	window.assign(dict->data()).resize(prefix + size);
+
+	if (!decompress_window(in, count, reinterpret_cast<uint8_t *> (&window[0]),
+		prefix, prefix + size))
+		return false;
+
+	out.append(window, prefix, size);
+	return true;
+}
+
+//==============================================================================
+// A stream consists of frames: the compressed size, the decompressed size (as
+// varints) and an LZ4 block. The last MAX_OFFSET bytes of the stream serve as
+// the dictionary of the next frame; the history is trimmed only once it has
+// doubled in size to keep the moves cheap.
+
+StreamCompressor::StreamCompressor() : table_(1 << HASH_BITS, 0), base_(0) {}
+
+void StreamCompressor::compress(const char *data, size_t count, string &out)
+{
+	string block;
+
+	while (count > 0)
+	{
+		size_t size = std::min(count, MAX_FRAME);
+
+		// Stream positions are 32-bit; start over well before they wrap
+		if (base_ + history_.size() + size > 0x7FFFFFFF)
+		{
+			std::fill(table_.begin(), table_.end(), 0);
+			base_ = 0;
+			history_.clear();
+		}
+
+		size_t prefix = history_.size();
+		history_.append(data, size);
+
+		block.clear();
+		compress_window(reinterpret_cast<const uint8_t *> (history_.data()),
+			prefix, history_.size(), table_.data(), block, base_);
+		varint_encode(block.size(), out);
+		varint_encode(size, out);
+		out.append(block);
+
+		if (history_.size() > 2 * MAX_OFFSET)
+		{
+			size_t cut = history_.size() - MAX_OFFSET;
+			history_.erase(0, cut);
+			base_ += (uint32_t) cut;
+		}
+
+		data += size;
+		count -= size;
+	}
+}
+
+//------------------------------------------------------------------------------
+
+bool StreamDecompressor::decompress(const char *data, size_t count,
+	string &out)
+{
+	pending_.append(data, count);
+
+	size_t pos = 0;
+	for (;;)
+	{
+		size_t start = pos;
+		uint64_t packed, size;
+
+		if (!varint_decode(pending_.data(), pending_.size(), pos, packed)
+			|| !varint_decode(pending_.data(), pending_.size(), pos, size))
+		{
+			// Either the header is incomplete or it is corrupt
+			if (pending_.size() - start >= 20)
+				return false;
+			pos = start;
+			break;
+		}
+
+		if (size > MAX_FRAME || packed > size + size / 255 + 16
+			|| size > decompress_bound(packed))
+			return false;
+
+		if (pending_.size() - pos < packed)
+		{
+			pos = start;
+			break;
+		}
+
+		size_t prefix = history_.size();
+		history_.resize(prefix + size);
+		if (!decompress_window(
+			reinterpret_cast<const uint8_t *> (pending_.data()) + pos, packed,
+			reinterpret_cast<uint8_t *> (&history_[0]), prefix, prefix + size))
+			return false;
+
+		out.append(history_, prefix, size);
+		pos += packed;
+
+		if (history_.size() > 2 * MAX_OFFSET)
+			history_.erase(0, history_.size() - MAX_OFFSET);
+	}
+
+	pending_.erase(0, pos);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+//..............................................................................
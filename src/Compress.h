@@ -0,0 +1,114 @@
+/*******************************************************
+ * Data compression -- header file                     *
+ *                                                     *
+ * Author: Ferry "Wyz" Timmers                         *
+ *                                                     *
+ * Date: 13:20 2026-10-18                              *
+ *                                                     *
+ * Description: Provides a fast LZ77 style codec that  *
+ *              emits the LZ4 block format, with       *
+ *              support for preset dictionaries.       *
+ *******************************************************/
+
+#ifndef _COMPRESS_H
+#define _COMPRESS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace AGSSock {
+
+//------------------------------------------------------------------------------
+
+//! Preset compression dictionary
+
+//! Small messages compress badly on their own; when both parties share a
+//! dictionary of typical content, matches can refer back into it instead.
+//! The hash table of the dictionary is computed once so that using it costs
+//! about the same as not using one.
+class Dictionary
+{
+	public:
+	static const size_t MAX_SIZE = 65535; //!< Larger dictionaries are cut
+
+	//! Creates a dictionary from (the last MAX_SIZE bytes of) some data
+	Dictionary(const char *data, size_t count);
+
+	//! The dictionary content
+	inline const std::string &data() const
+		{ return data_; }
+	//! Hash table that indexes the dictionary content
+	inline const std::vector<std::uint32_t> &table() const
+		{ return table_; }
+
+	private:
+	std::string data_;
+	std::vector<std::uint32_t> table_;
+};
+
+//------------------------------------------------------------------------------
+
+//! Appends the compressed representation of data to out
+void compress(const char *data, size_t count, std::string &out,
+	const Dictionary *dict = nullptr);
+
+//! Appends the decompressed data to out, which should be exactly size bytes
+//! \returns false if the input is malformed, refers outside of the data or
+//! does not decompress to the given size; out is then left in an unspecified
+//! state. Decompressing never reads or writes out of bounds.
+bool decompress(const char *data, size_t count, size_t size, std::string &out,
+	const Dictionary *dict = nullptr);
+
+//! Returns the largest size some compressed data of count bytes may expand to
+inline size_t decompress_bound(size_t count)
+	{ return count * 255; }
+
+//------------------------------------------------------------------------------
+
+//! Stream compressor
+
+//! Compresses a stream of data into a series of frames. Unlike compressing
+//! every part separately, matches may refer back to earlier parts of the
+//! stream. Frames carry their sizes so they can be decompressed as soon as
+//! they arrive completely.
+class StreamCompressor
+{
+	public:
+	StreamCompressor();
+
+	//! Appends the frame(s) that represent the data to out
+	void compress(const char *data, size_t count, std::string &out);
+
+	private:
+	std::string history_;              //!< Recent data, matches refer to it
+	std::vector<std::uint32_t> table_; //!< Stream positions of the history
+	std::uint32_t base_;               //!< Stream position of the history
+};
+
+//------------------------------------------------------------------------------
+
+//! Stream decompressor
+
+//! Counterpart of the StreamCompressor; accepts the compressed stream in
+//! arbitrarily sized parts.
+class StreamDecompressor
+{
+	public:
+	//! Decompresses all complete frames and appends the result to out
+	//! \returns false if the stream is corrupted, which is irrecoverable.
+	bool decompress(const char *data, size_t count, std::string &out);
+
+	private:
+	std::string history_; //!< Recently decompressed data
+	std::string pending_; //!< Incomplete frame data
+};
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+#endif /* _COMPRESS_H */
+
+//..............................................................................
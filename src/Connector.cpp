@@ -0,0 +1,301 @@
+/**************************************************************
+ * Connection racing -- See header file for more information. *
+ **************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "Connector.h"
+
+namespace AGSSock {
+
+using namespace AGSSockAPI;
+
+using Clock = std::chrono::steady_clock;
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+const int POLL_INTERVAL = 50; //!< Milliseconds between checks for cancellation
+const int LOOKUP_INTERVAL = 10; //!< Milliseconds between checks of the lookup
+
+struct Attempt
+{
+	SOCKET id;
+	int domain;
+};
+
+// Alternates between address families, starting with the family of the first
+// (most preferred) address (RFC 8305 section 4).
+void interleave(Addresses &addresses)
+{
+	if (addresses.empty())
+		return;
+
+	Addresses first, second;
+	int preferred = addresses.front().ss_family;
+	for (const SOCKADDR_STORAGE &addr : addresses)
+		(addr.ss_family == preferred ? first : second).push_back(addr);
+
+	addresses.clear();
+	for (size_t i = 0; i < std::max(first.size(), second.size()); ++i)
+	{
+		if (i < first.size())
+			addresses.push_back(first[i]);
+		if (i < second.size())
+			addresses.push_back(second[i]);
+	}
+}
+
+// Waits at most the given time (in milliseconds, negative is forever) for a
+// beacon to be signalled.
+void await(SOCKET signal, long wait)
+{
+	fd_set read;
+	FD_ZERO(&read);
+	FD_SET(signal, &read);
+	timeval timeout = {wait / 1000, (wait % 1000) * 1000};
+	select(signal + 1, &read, nullptr, nullptr, wait < 0 ? nullptr : &timeout);
+}
+
+} /* namespace */
+
+//==============================================================================
+
+const int Connector::CONNECTION_DELAY;
+
+//------------------------------------------------------------------------------
+
+Connector::Connector(const Query &query, int type, int protocol, Setup setup)
+	: query_(query), type_(type), protocol_(protocol), setup_(setup),
+	done_(false), cancelled_(false), error_(0), id_(INVALID_SOCKET),
+	domain_(0) {}
+
+//------------------------------------------------------------------------------
+
+Connector::~Connector()
+{
+	// The race notices right away, so this does not keep the caller waiting
+	cancel();
+	thread_.reset();
+
+	if (id_ != INVALID_SOCKET)
+		closesocket(id_);
+}
+
+//------------------------------------------------------------------------------
+
+void Connector::start()
+{
+	thread_.reset(new Thread([this]() { run(); }));
+	thread_->start();
+}
+
+//------------------------------------------------------------------------------
+
+bool Connector::wait(int timeout)
+{
+	if (done())
+		return true;
+
+	await(finished_, timeout > 0 ? timeout : -1);
+	return done();
+}
+
+//------------------------------------------------------------------------------
+
+void Connector::run()
+{
+	SOCKET wake = wake_;
+
+	// The lookup takes a resolver worker only for as long as it lasts
+	std::shared_ptr<Resolver::Request> request = resolver->resolve(query_);
+	for (;;)
+	{
+		{
+			Mutex::Lock lock(guard_);
+			if (cancelled_)
+				break;
+		}
+		if (request->done())
+			break;
+		await(wake, LOOKUP_INTERVAL);
+	}
+
+	Addresses addresses;
+	int error = 0;
+	if (!request->done())
+		request->cancel();
+	else if (request->error())
+		error = HOST_UNREACHABLE;
+	else
+		addresses = request->addresses();
+	interleave(addresses);
+
+	std::vector<Attempt> attempts;
+	size_t next = 0;
+	Attempt winner = {INVALID_SOCKET, 0};
+	Clock::time_point start = Clock::now();
+
+	for (;;)
+	{
+		{
+			Mutex::Lock lock(guard_);
+			if (cancelled_)
+				break;
+		}
+
+		// Start the next attempt when it is due or nothing else is going on
+		if (next < addresses.size()
+			&& (attempts.empty() || Clock::now() >= start))
+		{
+			const SOCKADDR_STORAGE &addr = addresses[next++];
+			start = Clock::now() + std::chrono::milliseconds(CONNECTION_DELAY);
+
+			Attempt attempt = {socket(addr.ss_family, type_, protocol_),
+				addr.ss_family};
+			if (attempt.id == INVALID_SOCKET)
+			{
+				error = GET_ERROR();
+				start = Clock::now();
+				continue;
+			}
+
+			setblocking(attempt.id, false);
+			if (setup_)
+				setup_(attempt.id, attempt.domain);
+			int ret = connect(attempt.id, CONST_ADDR(&addr), ADDR_SIZE(&addr));
+			int err = GET_ERROR();
+
+			if (ret != SOCKET_ERROR)
+			{
+				winner = attempt;
+				break;
+			}
+			if (!ALREADY(err) && !WOULD_BLOCK(err))
+			{
+				// A failure makes way for the next attempt right away
+				error = err;
+				closesocket(attempt.id);
+				start = Clock::now();
+				continue;
+			}
+			attempts.push_back(attempt);
+		}
+
+		if (attempts.empty())
+		{
+			if (next < addresses.size())
+				continue;
+			break; // Every attempt failed
+		}
+
+		// Wait for an attempt to finish, for the next one to be due or for
+		// the race to be cancelled, whichever comes first.
+		fd_set read, write, except;
+		FD_ZERO(&read);
+		FD_ZERO(&write);
+		FD_ZERO(&except);
+		FD_SET(wake, &read);
+		SOCKET nfds = wake;
+		for (const Attempt &attempt : attempts)
+		{
+			FD_SET(attempt.id, &write);
+			FD_SET(attempt.id, &except);
+			nfds = std::max(nfds, attempt.id);
+		}
+
+		long wait = POLL_INTERVAL;
+		if (next < addresses.size())
+			wait = std::min<long>(wait, std::max<long>(0, (long)
+				std::chrono::duration_cast<std::chrono::milliseconds>
+				(start - Clock::now()).count()));
+		timeval timeout = {wait / 1000, (wait % 1000) * 1000};
+
+		if (select(nfds + 1, &read, &write, &except, &timeout) <= 0)
+			continue;
+
+		for (auto it = attempts.begin(); it != attempts.end();)
+		{
+			if (!FD_ISSET(it->id, &write) && !FD_ISSET(it->id, &except))
+			{
+				++it;
+				continue;
+			}
+
+			int err = 0;
+			ADDRLEN size = sizeof (err);
+			if (getsockopt(it->id, SOL_SOCKET, SO_ERROR,
+				reinterpret_cast<char *> (&err), &size))
+				err = GET_ERROR();
+
+			if (!err && winner.id == INVALID_SOCKET)
+				winner = *it;
+			else
+			{
+				if (err)
+					error = err;
+				closesocket(it->id);
+				start = Clock::now();
+			}
+			it = attempts.erase(it);
+		}
+
+		if (winner.id != INVALID_SOCKET)
+			break;
+	}
+
+	for (const Attempt &attempt : attempts)
+		closesocket(attempt.id);
+
+	Mutex::Lock lock(guard_);
+	if (cancelled_ && winner.id != INVALID_SOCKET)
+	{
+		closesocket(winner.id);
+		winner.id = INVALID_SOCKET;
+	}
+
+	id_ = winner.id;
+	domain_ = winner.domain;
+	error_ = winner.id != INVALID_SOCKET ? 0 : (error ? error : HOST_UNREACHABLE);
+	done_ = true;
+	finished_.signal();
+}
+
+//------------------------------------------------------------------------------
+
+bool Connector::done()
+{
+	Mutex::Lock lock(guard_);
+	return done_;
+}
+
+//------------------------------------------------------------------------------
+
+void Connector::cancel()
+{
+	Mutex::Lock lock(guard_);
+	if (!cancelled_)
+		wake_.signal();
+	cancelled_ = true;
+}
+
+//------------------------------------------------------------------------------
+
+SOCKET Connector::take(int &domain)
+{
+	Mutex::Lock lock(guard_);
+
+	SOCKET id = id_;
+	id_ = INVALID_SOCKET;
+	domain = domain_;
+	return id;
+}
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+//..............................................................................
@@ -0,0 +1,93 @@
+/*******************************************************
+ * Connection racing -- header file                    *
+ *                                                     *
+ * Author: Ferry "Wyz" Timmers                         *
+ *                                                     *
+ * Date: 16:25 2026-10-18                              *
+ *                                                     *
+ * Description: Connects to a host by name, trying all *
+ *              of its addresses in a staggered race   *
+ *              (Happy Eyeballs, RFC 8305).            *
+ *******************************************************/
+
+#ifndef _CONNECTOR_H
+#define _CONNECTOR_H
+
+#include <functional>
+#include <memory>
+
+#include "API.h"
+#include "Resolver.h"
+
+namespace AGSSock {
+
+//------------------------------------------------------------------------------
+
+//! Connection race
+
+//! Resolves a host name and connects to its addresses, alternating between
+//! address families. Every CONNECTION_DELAY another attempt is started while
+//! the earlier ones continue, so that an unreachable address (commonly a
+//! broken IPv6 route) costs a fraction of a second instead of a full connect
+//! timeout. The first attempt to succeed wins, the others are abandoned.
+//! The lookup is queued with the resolver and the race runs on a thread of its
+//! own, so neither the game nor the resolver workers wait for the connections.
+class Connector
+{
+	using Mutex = AGSSockAPI::Mutex;
+	using Beacon = AGSSockAPI::Beacon;
+	using Thread = AGSSockAPI::Thread;
+
+	public:
+	static const int CONNECTION_DELAY = 250; //!< Milliseconds between attempts
+
+	//! Prepares the socket of an attempt (of the given domain) to connect
+	using Setup = std::function<void(SOCKET, int domain)>;
+
+	Connector(const Query &query, int type, int protocol, Setup setup);
+	~Connector(); //!< Abandons the race and closes the socket unless taken
+
+	//! Starts the race in the background
+	void start();
+	//! Waits at most timeout milliseconds for the race to be decided; zero
+	//! waits until it is.
+	//! \returns whether it was decided
+	bool wait(int timeout);
+
+	//! Returns whether the race has been decided
+	bool done();
+	//! Abandons the race; the thread running it ends soon after
+	void cancel();
+
+	//! The error of the race, only valid once done
+	int error() const { return error_; }
+	//! Takes the connected socket, only valid once done without error
+	//! \returns the socket, which is INVALID_SOCKET after the first call
+	SOCKET take(int &domain);
+
+	Connector(const Connector &) = delete;
+	void operator =(const Connector &) = delete;
+
+	private:
+	void run(); //!< Runs the race; this blocks until it is decided or cancelled
+
+	Mutex guard_;
+	Query query_;
+	int type_, protocol_;
+	Setup setup_;
+	bool done_, cancelled_;
+	int error_;
+	SOCKET id_;
+	int domain_;
+	Beacon wake_;     //!< Signalled when the race is cancelled
+	Beacon finished_; //!< Signalled when the race is decided
+	std::unique_ptr<Thread> thread_;
+};
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+#endif /* _CONNECTOR_H */
+
+//..............................................................................
@@ -0,0 +1,582 @@
+/*********************************************************************
+ * Authenticated encryption -- See header file for more information. *
+ *********************************************************************/
+
+#include <cstring>
+
+#include "Crypto.h"
+
+#ifdef CHACHA20_SSE2
+	#include <emmintrin.h>
+#endif
+
+namespace AGSSock {
+
+using std::uint8_t;
+using std::uint32_t;
+using std::uint64_t;
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+inline uint32_t load32(const uint8_t *p)
+{
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16)
+		| ((uint32_t) p[3] << 24);
+}
+
+inline void store32(uint8_t *p, uint32_t value)
+{
+	p[0] = (uint8_t) value;
+	p[1] = (uint8_t) (value >> 8);
+	p[2] = (uint8_t) (value >> 16);
+	p[3] = (uint8_t) (value >> 24);
+}
+
+#ifdef POLY1305_64
+__extension__ typedef unsigned __int128 uint128_t;
+
+inline uint64_t load64(const uint8_t *p)
+{
+	return (uint64_t) load32(p) | ((uint64_t) load32(p + 4) << 32);
+}
+#endif
+
+inline uint32_t rotl(uint32_t x, int n)
+{
+	return (x << n) | (x >> (32 - n));
+}
+
+#define QUARTER_ROUND(a, b, c, d)                          \
+	a += b; d ^= a; d = rotl(d, 16);                       \
+	c += d; b ^= c; b = rotl(b, 12);                       \
+	a += b; d ^= a; d = rotl(d, 8);                        \
+	c += d; b ^= c; b = rotl(b, 7);
+
+// "expand 32-byte k", the key, the block counter and the nonce
+void chacha20_init(uint32_t state[16], const uint8_t key[32],
+	const uint8_t nonce[12], uint32_t counter)
+{
+	state[0] = 0x61707865;
+	state[1] = 0x3320646E;
+	state[2] = 0x79622D32;
+	state[3] = 0x6B206574;
+	for (int i = 0; i < 8; ++i)
+		state[4 + i] = load32(key + 4 * i);
+	state[12] = counter;
+	for (int i = 0; i < 3; ++i)
+		state[13 + i] = load32(nonce + 4 * i);
+}
+
+// Produces the key stream of one block and moves the counter on
+void chacha20_block(uint32_t state[16], uint8_t out[64])
+{
+	uint32_t x[16];
+	memcpy(x, state, sizeof (x));
+
+	for (int i = 0; i < 10; ++i)
+	{
+		QUARTER_ROUND(x[0], x[4], x[ 8], x[12])
+		QUARTER_ROUND(x[1], x[5], x[ 9], x[13])
+		QUARTER_ROUND(x[2], x[6], x[10], x[14])
+		QUARTER_ROUND(x[3], x[7], x[11], x[15])
+		QUARTER_ROUND(x[0], x[5], x[10], x[15])
+		QUARTER_ROUND(x[1], x[6], x[11], x[12])
+		QUARTER_ROUND(x[2], x[7], x[ 8], x[13])
+		QUARTER_ROUND(x[3], x[4], x[ 9], x[14])
+	}
+
+	for (int i = 0; i < 16; ++i)
+		store32(out + 4 * i, x[i] + state[i]);
+	state[12]++;
+}
+
+inline void xor_bytes(const char *in, const uint8_t *stream, char *out,
+	size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+		out[i] = (char) (in[i] ^ stream[i]);
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+#ifdef CHACHA20_SSE2
+
+#define ROTL_SSE2(x, n) \
+	_mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - (n)))
+// Swapping the halves of each word takes one shuffle per half of the vector
+#define ROTL16_SSE2(x) \
+	_mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xB1), 0xB1)
+
+#define QUARTER_ROUND_SSE2(a, b, c, d)                                        \
+	a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = ROTL16_SSE2(d);     \
+	c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = ROTL_SSE2(b, 12);   \
+	a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = ROTL_SSE2(d, 8);    \
+	c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = ROTL_SSE2(b, 7);
+
+// Produces the key stream of four blocks at once: each vector holds the same
+// word of four blocks, which are transposed back into place at the end.
+void chacha20_block4(uint32_t state[16], uint8_t out[256])
+{
+	const __m128i lanes = _mm_set_epi32(3, 2, 1, 0);
+	__m128i x[16];
+	for (int i = 0; i < 16; ++i)
+		x[i] = _mm_set1_epi32((int) state[i]);
+	x[12] = _mm_add_epi32(x[12], lanes);
+
+	for (int i = 0; i < 10; ++i)
+	{
+		QUARTER_ROUND_SSE2(x[0], x[4], x[ 8], x[12])
+		QUARTER_ROUND_SSE2(x[1], x[5], x[ 9], x[13])
+		QUARTER_ROUND_SSE2(x[2], x[6], x[10], x[14])
+		QUARTER_ROUND_SSE2(x[3], x[7], x[11], x[15])
+		QUARTER_ROUND_SSE2(x[0], x[5], x[10], x[15])
+		QUARTER_ROUND_SSE2(x[1], x[6], x[11], x[12])
+		QUARTER_ROUND_SSE2(x[2], x[7], x[ 8], x[13])
+		QUARTER_ROUND_SSE2(x[3], x[4], x[ 9], x[14])
+	}
+
+	x[12] = _mm_add_epi32(x[12], lanes);
+	for (int i = 0; i < 16; ++i)
+		x[i] = _mm_add_epi32(x[i], _mm_set1_epi32((int) state[i]));
+
+	// The platform is little endian, like the key stream
+	for (int i = 0; i < 16; i += 4)
+	{
+		__m128i ab_lo = _mm_unpacklo_epi32(x[i], x[i + 1]);
+		__m128i ab_hi = _mm_unpackhi_epi32(x[i], x[i + 1]);
+		__m128i cd_lo = _mm_unpacklo_epi32(x[i + 2], x[i + 3]);
+		__m128i cd_hi = _mm_unpackhi_epi32(x[i + 2], x[i + 3]);
+
+		__m128i *p = (__m128i *) (out + 4 * i);
+		_mm_storeu_si128(p, _mm_unpacklo_epi64(ab_lo, cd_lo));
+		_mm_storeu_si128(p + 4, _mm_unpackhi_epi64(ab_lo, cd_lo));
+		_mm_storeu_si128(p + 8, _mm_unpacklo_epi64(ab_hi, cd_hi));
+		_mm_storeu_si128(p + 12, _mm_unpackhi_epi64(ab_hi, cd_hi));
+	}
+	state[12] += 4;
+}
+
+inline void xor_bytes_sse2(const char *in, const uint8_t *stream, char *out,
+	size_t count)
+{
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+		_mm_storeu_si128((__m128i *) (out + i), _mm_xor_si128(
+			_mm_loadu_si128((const __m128i *) (in + i)),
+			_mm_loadu_si128((const __m128i *) (stream + i))));
+	xor_bytes(in + i, stream + i, out + i, count - i);
+}
+
+#endif /* CHACHA20_SSE2 */
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+} /* namespace */
+
+//------------------------------------------------------------------------------
+
+void chacha20_xor_scalar(const uint8_t key[32], const uint8_t nonce[12],
+	uint32_t counter, const char *in, char *out, size_t count)
+{
+	uint32_t state[16];
+	uint8_t stream[64];
+	chacha20_init(state, key, nonce, counter);
+
+	while (count > 0)
+	{
+		size_t size = count < 64 ? count : 64;
+		chacha20_block(state, stream);
+		xor_bytes(in, stream, out, size);
+		in += size;
+		out += size;
+		count -= size;
+	}
+}
+
+//------------------------------------------------------------------------------
+// More than one block left is worth four at once, even if part of the key
+// stream goes unused.
+
+void chacha20_xor(const uint8_t key[32], const uint8_t nonce[12],
+	uint32_t counter, const char *in, char *out, size_t count)
+{
+#ifdef CHACHA20_SSE2
+	uint32_t state[16];
+	uint8_t stream[256];
+	chacha20_init(state, key, nonce, counter);
+
+	while (count > 0)
+	{
+		size_t size;
+		if (count > 64)
+		{
+			size = count < 256 ? count : 256;
+			chacha20_block4(state, stream);
+			xor_bytes_sse2(in, stream, out, size);
+		}
+		else
+		{
+			size = count;
+			chacha20_block(state, stream);
+			xor_bytes(in, stream, out, size);
+		}
+		in += size;
+		out += size;
+		count -= size;
+	}
+#else
+	chacha20_xor_scalar(key, nonce, counter, in, out, count);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+const char *chacha20_implementation()
+{
+#ifdef CHACHA20_SSE2
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+
+//==============================================================================
+
+const int Poly1305::LIMBS;
+const Poly1305::Limb Poly1305::HIBIT;
+
+//------------------------------------------------------------------------------
+
+#ifdef POLY1305_64
+
+// Limbs of 44, 44 and 42 bits: the products of a block fit in 128 bits with
+// room for the carries, so a block takes 9 multiplications instead of 25.
+
+const uint64_t MASK44 = 0xFFFFFFFFFFF, MASK42 = 0x3FFFFFFFFFF;
+
+Poly1305::Poly1305(const uint8_t key[32]) : used_(0)
+{
+	// The clamped half of the key
+	uint64_t t0 = load64(key), t1 = load64(key + 8);
+	r_[0] = t0 & 0xFFC0FFFFFFF;
+	r_[1] = ((t0 >> 44) | (t1 << 20)) & 0xFFFFFC0FFFF;
+	r_[2] = (t1 >> 24) & 0x00FFFFFFC0F;
+
+	for (int i = 0; i < 3; ++i)
+		h_[i] = 0;
+	for (int i = 0; i < 4; ++i)
+		pad_[i] = load32(key + 16 + 4 * i);
+}
+
+//------------------------------------------------------------------------------
+// h = (h + block) * r mod 2^130 - 5, where the block has a one bit appended
+// (hibit) unless it is the last one and was padded already. The top limbs of
+// r are multiplied by 20 rather than 5, for the 2 bits the top limb of h lacks.
+
+void Poly1305::blocks(const uint8_t *data, size_t count, uint64_t hibit)
+{
+	uint64_t r0 = r_[0], r1 = r_[1], r2 = r_[2];
+	uint64_t s1 = r1 * 20, s2 = r2 * 20;
+	uint64_t h0 = h_[0], h1 = h_[1], h2 = h_[2];
+
+	for (; count >= 16; data += 16, count -= 16)
+	{
+		uint64_t t0 = load64(data), t1 = load64(data + 8);
+		h0 += t0 & MASK44;
+		h1 += ((t0 >> 44) | (t1 << 20)) & MASK44;
+		h2 += ((t1 >> 24) & MASK42) | hibit;
+
+		uint128_t d0 = (uint128_t) h0 * r0 + (uint128_t) h1 * s2
+			+ (uint128_t) h2 * s1;
+		uint128_t d1 = (uint128_t) h0 * r1 + (uint128_t) h1 * r0
+			+ (uint128_t) h2 * s2;
+		uint128_t d2 = (uint128_t) h0 * r2 + (uint128_t) h1 * r1
+			+ (uint128_t) h2 * r0;
+
+		uint64_t c;
+		c = (uint64_t) (d0 >> 44); h0 = (uint64_t) d0 & MASK44;
+		d1 += c; c = (uint64_t) (d1 >> 44); h1 = (uint64_t) d1 & MASK44;
+		d2 += c; c = (uint64_t) (d2 >> 42); h2 = (uint64_t) d2 & MASK42;
+		h0 += c * 5; c = h0 >> 44; h0 &= MASK44;
+		h1 += c;
+	}
+
+	h_[0] = h0; h_[1] = h1; h_[2] = h2;
+}
+
+#else
+
+Poly1305::Poly1305(const uint8_t key[32]) : used_(0)
+{
+	// The clamped half of the key, in 26 bit limbs
+	r_[0] = (load32(key +  0)     ) & 0x3FFFFFF;
+	r_[1] = (load32(key +  3) >> 2) & 0x3FFFF03;
+	r_[2] = (load32(key +  6) >> 4) & 0x3FFC0FF;
+	r_[3] = (load32(key +  9) >> 6) & 0x3F03FFF;
+	r_[4] = (load32(key + 12) >> 8) & 0x00FFFFF;
+
+	for (int i = 0; i < 5; ++i)
+		h_[i] = 0;
+	for (int i = 0; i < 4; ++i)
+		pad_[i] = load32(key + 16 + 4 * i);
+}
+
+//------------------------------------------------------------------------------
+// h = (h + block) * r mod 2^130 - 5, where the block has a one bit appended
+// (hibit) unless it is the last one and was padded already.
+
+void Poly1305::blocks(const uint8_t *data, size_t count, uint32_t hibit)
+{
+	const uint32_t mask = 0x3FFFFFF;
+	uint32_t r0 = r_[0], r1 = r_[1], r2 = r_[2], r3 = r_[3], r4 = r_[4];
+	uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+	uint32_t h0 = h_[0], h1 = h_[1], h2 = h_[2], h3 = h_[3], h4 = h_[4];
+
+	for (; count >= 16; data += 16, count -= 16)
+	{
+		h0 += (load32(data +  0)     ) & mask;
+		h1 += (load32(data +  3) >> 2) & mask;
+		h2 += (load32(data +  6) >> 4) & mask;
+		h3 += (load32(data +  9) >> 6) & mask;
+		h4 += (load32(data + 12) >> 8) | hibit;
+
+		uint64_t d0 = (uint64_t) h0 * r0 + (uint64_t) h1 * s4
+			+ (uint64_t) h2 * s3 + (uint64_t) h3 * s2 + (uint64_t) h4 * s1;
+		uint64_t d1 = (uint64_t) h0 * r1 + (uint64_t) h1 * r0
+			+ (uint64_t) h2 * s4 + (uint64_t) h3 * s3 + (uint64_t) h4 * s2;
+		uint64_t d2 = (uint64_t) h0 * r2 + (uint64_t) h1 * r1
+			+ (uint64_t) h2 * r0 + (uint64_t) h3 * s4 + (uint64_t) h4 * s3;
+		uint64_t d3 = (uint64_t) h0 * r3 + (uint64_t) h1 * r2
+			+ (uint64_t) h2 * r1 + (uint64_t) h3 * r0 + (uint64_t) h4 * s4;
+		uint64_t d4 = (uint64_t) h0 * r4 + (uint64_t) h1 * r3
+			+ (uint64_t) h2 * r2 + (uint64_t) h3 * r1 + (uint64_t) h4 * r0;
+
+		uint32_t c;
+		c = (uint32_t) (d0 >> 26); h0 = (uint32_t) d0 & mask;
+		d1 += c; c = (uint32_t) (d1 >> 26); h1 = (uint32_t) d1 & mask;
+		d2 += c; c = (uint32_t) (d2 >> 26); h2 = (uint32_t) d2 & mask;
+		d3 += c; c = (uint32_t) (d3 >> 26); h3 = (uint32_t) d3 & mask;
+		d4 += c; c = (uint32_t) (d4 >> 26); h4 = (uint32_t) d4 & mask;
+		h0 += c * 5; c = h0 >> 26; h0 &= mask;
+		h1 += c;
+	}
+
+	h_[0] = h0; h_[1] = h1; h_[2] = h2; h_[3] = h3; h_[4] = h4;
+}
+
+#endif /* POLY1305_64 */
+
+//------------------------------------------------------------------------------
+
+void Poly1305::update(const char *data, size_t count)
+{
+	const uint8_t *bytes = reinterpret_cast<const uint8_t *> (data);
+
+	if (used_ > 0)
+	{
+		size_t size = 16 - used_ < count ? 16 - used_ : count;
+		memcpy(buffer_ + used_, bytes, size);
+		used_ += size;
+		bytes += size;
+		count -= size;
+		if (used_ < 16)
+			return;
+		blocks(buffer_, 16, HIBIT);
+		used_ = 0;
+	}
+
+	size_t whole = count & ~(size_t) 15;
+	blocks(bytes, whole, HIBIT);
+	memcpy(buffer_, bytes + whole, count - whole);
+	used_ = count - whole;
+}
+
+//------------------------------------------------------------------------------
+
+void Poly1305::pad16()
+{
+	if (used_ == 0)
+		return;
+
+	memset(buffer_ + used_, 0, 16 - used_);
+	blocks(buffer_, 16, HIBIT);
+	used_ = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void Poly1305::finish(uint8_t tag[16])
+{
+	if (used_ > 0)
+	{
+		buffer_[used_] = 1;
+		memset(buffer_ + used_ + 1, 0, 15 - used_);
+		blocks(buffer_, 16, 0);
+		used_ = 0;
+	}
+
+#ifdef POLY1305_64
+	// Carry all the way through
+	uint64_t h0 = h_[0], h1 = h_[1], h2 = h_[2], c;
+	c = h1 >> 44; h1 &= MASK44; h2 += c;
+	c = h2 >> 42; h2 &= MASK42; h0 += c * 5;
+	c = h0 >> 44; h0 &= MASK44; h1 += c;
+	c = h1 >> 44; h1 &= MASK44; h2 += c;
+	c = h2 >> 42; h2 &= MASK42; h0 += c * 5;
+	c = h0 >> 44; h0 &= MASK44; h1 += c;
+
+	// Subtract the prime if h is not smaller, without branching
+	uint64_t g0 = h0 + 5; c = g0 >> 44; g0 &= MASK44;
+	uint64_t g1 = h1 + c; c = g1 >> 44; g1 &= MASK44;
+	uint64_t g2 = h2 + c - ((uint64_t) 1 << 42);
+
+	uint64_t select = (g2 >> 63) - 1; // All ones when h >= 2^130 - 5
+	h0 = (h0 & ~select) | (g0 & select);
+	h1 = (h1 & ~select) | (g1 & select);
+	h2 = (h2 & ~select) | (g2 & select);
+
+	// Plus the other half of the key, then back to 32 bit words
+	uint64_t t0 = (uint64_t) pad_[0] | ((uint64_t) pad_[1] << 32);
+	uint64_t t1 = (uint64_t) pad_[2] | ((uint64_t) pad_[3] << 32);
+	h0 += t0 & MASK44; c = h0 >> 44; h0 &= MASK44;
+	h1 += (((t0 >> 44) | (t1 << 20)) & MASK44) + c; c = h1 >> 44; h1 &= MASK44;
+	h2 += ((t1 >> 24) & MASK42) + c;
+
+	h0 = h0 | (h1 << 44);
+	h1 = (h1 >> 20) | (h2 << 24);
+	store32(tag +  0, (uint32_t) h0);
+	store32(tag +  4, (uint32_t) (h0 >> 32));
+	store32(tag +  8, (uint32_t) h1);
+	store32(tag + 12, (uint32_t) (h1 >> 32));
+#else
+	const uint32_t mask = 0x3FFFFFF;
+
+	// Carry all the way through
+	uint32_t h0 = h_[0], h1 = h_[1], h2 = h_[2], h3 = h_[3], h4 = h_[4], c;
+	c = h1 >> 26; h1 &= mask; h2 += c;
+	c = h2 >> 26; h2 &= mask; h3 += c;
+	c = h3 >> 26; h3 &= mask; h4 += c;
+	c = h4 >> 26; h4 &= mask; h0 += c * 5;
+	c = h0 >> 26; h0 &= mask; h1 += c;
+
+	// Subtract the prime if h is not smaller, without branching
+	uint32_t g0 = h0 + 5; c = g0 >> 26; g0 &= mask;
+	uint32_t g1 = h1 + c; c = g1 >> 26; g1 &= mask;
+	uint32_t g2 = h2 + c; c = g2 >> 26; g2 &= mask;
+	uint32_t g3 = h3 + c; c = g3 >> 26; g3 &= mask;
+	uint32_t g4 = h4 + c - (1 << 26);
+
+	uint32_t select = (g4 >> 31) - 1; // All ones when h >= 2^130 - 5
+	h0 = (h0 & ~select) | (g0 & select);
+	h1 = (h1 & ~select) | (g1 & select);
+	h2 = (h2 & ~select) | (g2 & select);
+	h3 = (h3 & ~select) | (g3 & select);
+	h4 = (h4 & ~select) | (g4 & select);
+
+	// Back to 32 bit words, plus the other half of the key
+	h0 = h0 | (h1 << 26);
+	h1 = (h1 >> 6) | (h2 << 20);
+	h2 = (h2 >> 12) | (h3 << 14);
+	h3 = (h3 >> 18) | (h4 << 8);
+
+	uint64_t f;
+	f = (uint64_t) h0 + pad_[0];             store32(tag +  0, (uint32_t) f);
+	f = (uint64_t) h1 + pad_[1] + (f >> 32); store32(tag +  4, (uint32_t) f);
+	f = (uint64_t) h2 + pad_[2] + (f >> 32); store32(tag +  8, (uint32_t) f);
+	f = (uint64_t) h3 + pad_[3] + (f >> 32); store32(tag + 12, (uint32_t) f);
+#endif /* POLY1305_64 */
+}
+
+//==============================================================================
+
+namespace {
+
+// Produces block zero, whose start is the one-time key, and with SSE2 the
+// first three blocks of data with it; the rest of the data starts at the
+// returned block.
+uint32_t aead_start(const uint8_t key[32], const uint8_t nonce[12],
+	uint8_t stream[256])
+{
+	uint32_t state[16];
+	chacha20_init(state, key, nonce, 0);
+#ifdef CHACHA20_SSE2
+	chacha20_block4(state, stream);
+#else
+	chacha20_block(state, stream);
+#endif
+	return state[12];
+}
+
+// Encrypts or decrypts using the key stream aead_start produced first
+void aead_xor(const uint8_t key[32], const uint8_t nonce[12],
+	const uint8_t stream[256], uint32_t counter, const char *in, char *out,
+	size_t count)
+{
+	size_t size = (counter - 1) * 64;
+	size = size < count ? size : count;
+#ifdef CHACHA20_SSE2
+	xor_bytes_sse2(in, stream + 64, out, size);
+#else
+	xor_bytes(in, stream + 64, out, size);
+#endif
+	chacha20_xor(key, nonce, counter, in + size, out + size, count - size);
+}
+
+void aead_tag(const uint8_t stream[256], const char *aad, size_t aad_count,
+	const char *cipher, size_t count, uint8_t tag[16])
+{
+	Poly1305 mac(stream);
+	mac.update(aad, aad_count);
+	mac.pad16();
+	mac.update(cipher, count);
+	mac.pad16();
+
+	uint8_t lengths[16];
+	store32(lengths, (uint32_t) aad_count);
+	store32(lengths + 4, (uint32_t) ((uint64_t) aad_count >> 32));
+	store32(lengths + 8, (uint32_t) count);
+	store32(lengths + 12, (uint32_t) ((uint64_t) count >> 32));
+	mac.update(reinterpret_cast<const char *> (lengths), sizeof (lengths));
+	mac.finish(tag);
+}
+
+} /* namespace */
+
+//------------------------------------------------------------------------------
+
+void aead_seal(const uint8_t key[32], const uint8_t nonce[12], const char *aad,
+	size_t aad_count, const char *in, size_t count, char *out, uint8_t tag[16])
+{
+	uint8_t stream[256];
+	uint32_t counter = aead_start(key, nonce, stream);
+	aead_xor(key, nonce, stream, counter, in, out, count);
+	aead_tag(stream, aad, aad_count, out, count, tag);
+}
+
+//------------------------------------------------------------------------------
+// The tags are compared in constant time, so timing tells nothing about how
+// much of a forged tag was right.
+
+bool aead_open(const uint8_t key[32], const uint8_t nonce[12], const char *aad,
+	size_t aad_count, const char *in, size_t count, char *out,
+	const uint8_t tag[16])
+{
+	uint8_t stream[256], expected[16];
+	uint32_t counter = aead_start(key, nonce, stream);
+	aead_tag(stream, aad, aad_count, in, count, expected);
+
+	uint8_t diff = 0;
+	for (int i = 0; i < 16; ++i)
+		diff |= expected[i] ^ tag[i];
+	if (diff)
+		return false;
+
+	aead_xor(key, nonce, stream, counter, in, out, count);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+//..............................................................................
@@ -0,0 +1,97 @@
+/*******************************************************
+ * Authenticated encryption -- header file             *
+ *                                                     *
+ * Author: Ferry "Wyz" Timmers                         *
+ *                                                     *
+ * Date: 16:30 2026-10-18                              *
+ *                                                     *
+ * Description: ChaCha20-Poly1305 (RFC 8439), to keep  *
+ *              datagrams from being read or tampered  *
+ *              with.                                  *
+ *******************************************************/
+
+#ifndef _CRYPTO_H
+#define _CRYPTO_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CHACHA20_SSE2
+	#ifdef __SIZEOF_INT128__
+		#define POLY1305_64
+	#endif
+#endif
+
+namespace AGSSock {
+
+//------------------------------------------------------------------------------
+
+const size_t CRYPTO_KEY_SIZE = 32;
+const size_t CRYPTO_NONCE_SIZE = 12;
+const size_t CRYPTO_TAG_SIZE = 16;
+
+//! Encrypts or decrypts data with the ChaCha20 stream cipher, starting at a
+//! block counter; the input and output may be the same.
+//! Uses four blocks at once with SSE2 where available.
+void chacha20_xor(const std::uint8_t key[32], const std::uint8_t nonce[12],
+	std::uint32_t counter, const char *in, char *out, size_t count);
+//! The same, one block at a time on any platform
+void chacha20_xor_scalar(const std::uint8_t key[32],
+	const std::uint8_t nonce[12], std::uint32_t counter, const char *in,
+	char *out, size_t count);
+
+//! Returns the name of the ChaCha20 implementation chacha20_xor uses
+const char *chacha20_implementation();
+
+//------------------------------------------------------------------------------
+
+//! One-time authenticator; in 44 bit limbs on 64 bit platforms with 128 bit
+//! products, in 26 bit limbs (no 128 bit arithmetic) elsewhere
+class Poly1305
+{
+#ifdef POLY1305_64
+	using Limb = std::uint64_t;
+	static const int LIMBS = 3;
+	static const Limb HIBIT = (Limb) 1 << 40; //!< 2^128, in the top limb
+#else
+	using Limb = std::uint32_t;
+	static const int LIMBS = 5;
+	static const Limb HIBIT = (Limb) 1 << 24;
+#endif
+
+	Limb r_[LIMBS], h_[LIMBS];
+	std::uint32_t pad_[4];
+	std::uint8_t buffer_[16];
+	size_t used_;
+
+	void blocks(const std::uint8_t *data, size_t count, Limb hibit);
+
+	public:
+	explicit Poly1305(const std::uint8_t key[32]);
+
+	void update(const char *data, size_t count);
+	void pad16();                        //!< Zero fills up to a whole block
+	void finish(std::uint8_t tag[16]);
+};
+
+//------------------------------------------------------------------------------
+
+//! Encrypts data and computes the tag that covers it and the additional data
+void aead_seal(const std::uint8_t key[32], const std::uint8_t nonce[12],
+	const char *aad, size_t aad_count, const char *in, size_t count, char *out,
+	std::uint8_t tag[16]);
+//! Decrypts data if the tag matches, otherwise leaves the output untouched
+//! \returns whether the data is authentic
+bool aead_open(const std::uint8_t key[32], const std::uint8_t nonce[12],
+	const char *aad, size_t aad_count, const char *in, size_t count, char *out,
+	const std::uint8_t tag[16]);
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+#endif /* _CRYPTO_H */
+
+//..............................................................................
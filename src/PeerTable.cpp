@@ -0,0 +1,246 @@
+/*****************************************************************
+ * Peer table interface -- See header file for more information. *
+ *****************************************************************/
+
+#include <cstring>
+
+#include "PeerTable.h"
+
+namespace AGSSock {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+const size_t MIN_CAPACITY = 16;
+
+// Saved entries hold the id, the size of the address and its first bytes; the
+// family specific part is all that address_equal looks at.
+size_t saved_size(const SOCKADDR_STORAGE &addr)
+{
+	if (addr.ss_family == AF_INET)
+		return sizeof (sockaddr_in);
+	else if (addr.ss_family == AF_INET6)
+		return sizeof (sockaddr_in6);
+	else
+		return sizeof (SOCKADDR_STORAGE);
+}
+
+} /* namespace */
+
+//------------------------------------------------------------------------------
+
+size_t PeerTable::probe(const SOCKADDR_STORAGE &addr, std::uint32_t hash) const
+{
+	size_t mask = entries.size() - 1;
+	size_t index = hash & mask;
+
+	while (entries[index].used)
+	{
+		const Entry &entry = entries[index];
+		if (entry.hash == hash && address_equal(entry.addr, addr))
+			break;
+		index = (index + 1) & mask;
+	}
+
+	return index;
+}
+
+//------------------------------------------------------------------------------
+
+void PeerTable::grow()
+{
+	std::vector<Entry> old(entries.empty() ? MIN_CAPACITY : entries.size() * 2);
+	old.swap(entries);
+
+	for (const Entry &entry : old)
+		if (entry.used)
+			entries[probe(entry.addr, entry.hash)] = entry;
+}
+
+//------------------------------------------------------------------------------
+
+ags_t PeerTable::find(const SOCKADDR_STORAGE &addr) const
+{
+	if (!count)
+		return -1;
+
+	const Entry &entry = entries[probe(addr, address_hash(addr))];
+	return entry.used ? entry.id : -1;
+}
+
+//------------------------------------------------------------------------------
+
+void PeerTable::set(const SOCKADDR_STORAGE &addr, ags_t id)
+{
+	// Keep the load factor at or below three quarters
+	if ((count + 1) * 4 > entries.size() * 3)
+		grow();
+
+	std::uint32_t hash = address_hash(addr);
+	Entry &entry = entries[probe(addr, hash)];
+	if (!entry.used)
+	{
+		entry.hash = hash;
+		entry.addr = addr;
+		entry.used = true;
+		count++;
+	}
+	entry.id = id;
+}
+
+//------------------------------------------------------------------------------
+
+bool PeerTable::remove(const SOCKADDR_STORAGE &addr)
+{
+	if (!count)
+		return false;
+
+	size_t mask = entries.size() - 1;
+	size_t index = probe(addr, address_hash(addr));
+	if (!entries[index].used)
+		return false;
+
+	// Move later entries of the cluster back into the gap when their home
+	// slot does not lie between the gap and their current slot.
+	size_t next = index;
+	for (;;)
+	{
+		next = (next + 1) & mask;
+		if (!entries[next].used)
+			break;
+
+		size_t home = entries[next].hash & mask;
+		if (((next - home) & mask) >= ((next - index) & mask))
+		{
+			entries[index] = entries[next];
+			index = next;
+		}
+	}
+
+	entries[index].used = false;
+	count--;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+
+void PeerTable::clear()
+{
+	for (Entry &entry : entries)
+		entry.used = false;
+	count = 0;
+}
+
+//==============================================================================
+
+int AGSPeerTable::Dispose(const char *ptr, bool force)
+{
+	delete (PeerTable *) ptr;
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+
+int AGSPeerTable::Serialize(const char *ptr, char *buffer, int size)
+{
+	const PeerTable *table = (const PeerTable *) ptr;
+	int pos = 0;
+
+	// Entries that do not fit the buffer are left out
+	for (const PeerTable::Entry &entry : table->entries)
+	{
+		if (!entry.used)
+			continue;
+
+		std::int32_t id = entry.id;
+		std::uint8_t length = saved_size(entry.addr);
+		if (pos + (int) (sizeof (id) + 1 + length) > size)
+			break;
+
+		memcpy(buffer + pos, &id, sizeof (id));
+		pos += sizeof (id);
+		buffer[pos++] = length;
+		memcpy(buffer + pos, &entry.addr, length);
+		pos += length;
+	}
+
+	return pos;
+}
+
+//------------------------------------------------------------------------------
+
+void AGSPeerTable::Unserialize(int key, const char *buffer, int size)
+{
+	PeerTable *table = new PeerTable();
+	int pos = 0;
+
+	while (pos + (int) sizeof (std::int32_t) + 1 <= size)
+	{
+		std::int32_t id;
+		memcpy(&id, buffer + pos, sizeof (id));
+		pos += sizeof (id);
+		size_t length = (std::uint8_t) buffer[pos++];
+		if (pos + (int) length > size || length > sizeof (SOCKADDR_STORAGE))
+			break;
+
+		SOCKADDR_STORAGE addr;
+		memset(&addr, 0, sizeof (addr));
+		memcpy(&addr, buffer + pos, length);
+		pos += length;
+		table->set(addr, id);
+	}
+
+	AGS_RESTORE(PeerTable, table, key);
+}
+
+//==============================================================================
+
+PeerTable *PeerTable_Create()
+{
+	PeerTable *table = new PeerTable();
+	AGS_OBJECT(PeerTable, table);
+	return table;
+}
+
+//------------------------------------------------------------------------------
+
+ags_t PeerTable_Find(PeerTable *table, const SockAddr *addr)
+{
+	return addr != nullptr ? table->find(*addr) : -1;
+}
+
+//------------------------------------------------------------------------------
+
+void PeerTable_Set(PeerTable *table, const SockAddr *addr, ags_t id)
+{
+	if (addr != nullptr)
+		table->set(*addr, id);
+}
+
+//------------------------------------------------------------------------------
+
+ags_t PeerTable_Remove(PeerTable *table, const SockAddr *addr)
+{
+	return addr != nullptr && table->remove(*addr) ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
+
+void PeerTable_Clear(PeerTable *table)
+{
+	table->clear();
+}
+
+//------------------------------------------------------------------------------
+
+ags_t PeerTable_get_Count(PeerTable *table)
+{
+	return table->count;
+}
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+//..............................................................................
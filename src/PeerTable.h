@@ -0,0 +1,111 @@
+/*******************************************************
+ * Peer table interface -- header file                 *
+ *                                                     *
+ * Author: Ferry "Wyz" Timmers                         *
+ *                                                     *
+ * Date: 17:10 2026-10-18                              *
+ *                                                     *
+ * Description: Maps socket addresses to numbers, so   *
+ *              that servers can find the player a     *
+ *              datagram came from.                    *
+ *******************************************************/
+
+#ifndef _PEERTABLE_H
+#define _PEERTABLE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "API.h"
+#include "SockAddr.h"
+
+namespace AGSSock {
+
+//------------------------------------------------------------------------------
+
+//! Open addressing hash map from socket address to id
+
+//! Uses linear probing with backward shift deletion, so there are no
+//! tombstones and lookups stay short after many removals. The stored hash
+//! rejects most mismatches without comparing addresses.
+struct PeerTable
+{
+	struct Entry
+	{
+		std::uint32_t hash;
+		ags_t id;
+		SOCKADDR_STORAGE addr;
+		bool used;
+	};
+
+	std::vector<Entry> entries; //!< Empty or a power of two in size
+	size_t count = 0;
+
+	//! Returns the id of an address or -1 when it is absent
+	ags_t find(const SOCKADDR_STORAGE &addr) const;
+	//! Stores the id of an address, replacing an existing one
+	void set(const SOCKADDR_STORAGE &addr, ags_t id);
+	//! Removes an address; returns whether it was present
+	bool remove(const SOCKADDR_STORAGE &addr);
+	//! Removes all addresses
+	void clear();
+
+	private:
+	//! Returns the slot of an address or of the free slot where it belongs
+	size_t probe(const SOCKADDR_STORAGE &addr, std::uint32_t hash) const;
+	void grow();
+};
+
+AGS_DEFINE_CLASS(PeerTable)
+
+//------------------------------------------------------------------------------
+
+PeerTable *PeerTable_Create();
+
+ags_t PeerTable_Find(PeerTable *, const SockAddr *);
+void PeerTable_Set(PeerTable *, const SockAddr *, ags_t id);
+ags_t PeerTable_Remove(PeerTable *, const SockAddr *);
+void PeerTable_Clear(PeerTable *);
+ags_t PeerTable_get_Count(PeerTable *);
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+//------------------------------------------------------------------------------
+//                           Plugin interface
+
+#define PEERTABLE_HEADER \
+	"managed struct PeerTable\r\n" \
+	"{\r\n" \
+	"  /// Creates an empty table that maps socket addresses to numbers. (for example: player ids)\r\n" \
+	"  import static PeerTable *Create(); // $AUTOCOMPLETESTATICONLY$\r\n" \
+	"  \r\n" \
+	"  /// Returns the number stored for the address, or -1 when it is not in the table.\r\n" \
+	"  import int Find(SockAddr *addr);\r\n" \
+	"  /// Stores a number for the address, replacing the previous one.\r\n" \
+	"  import void Set(SockAddr *addr, int id);\r\n" \
+	"  /// Removes the address from the table. Returns whether it was present.\r\n" \
+	"  import bool Remove(SockAddr *addr);\r\n" \
+	"  /// Removes all addresses from the table.\r\n" \
+	"  import void Clear();\r\n" \
+	"  \r\n" \
+	"  /// The number of addresses in the table.\r\n" \
+	"  readonly import attribute int Count;\r\n" \
+	"};\r\n" \
+	"\r\n"
+
+#define PEERTABLE_ENTRY 	                     \
+	AGS_CLASS   (PeerTable)                      \
+	AGS_METHOD  (PeerTable, Create, 0)           \
+	AGS_METHOD  (PeerTable, Find, 1)             \
+	AGS_METHOD  (PeerTable, Set, 2)              \
+	AGS_METHOD  (PeerTable, Remove, 1)           \
+	AGS_METHOD  (PeerTable, Clear, 0)            \
+	AGS_READONLY(PeerTable, Count)
+
+//------------------------------------------------------------------------------
+
+#endif /* _PEERTABLE_H */
+
+//..............................................................................
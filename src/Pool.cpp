@@ -9,48 +9,264 @@
 	#define DEBUG_P(x) std::puts("\t\t" x)
 #endif
 
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
 #include "Pool.h"
 
 namespace AGSSock {
 
 using namespace AGSSockAPI;
 
+using Clock = std::chrono::steady_clock;
+
 // Invariant I: (sockets_.size() > 0) => thread_->active()
 // Invariant II: (sock->id == INVALID_SOCKET) => !sockets_.count(sock)
 
 //------------------------------------------------------------------------------
 
+namespace {
+
+// Sends as much of the outgoing data of a socket as it accepts
+// Returns false if the socket failed
+bool send_outgoing(Socket *sock)
+{
+	if (sock->outgoing.empty())
+		return true;
+
+	int ret = send(sock->id, sock->outgoing.data(), sock->outgoing.size(),
+		MSG_NOSIGNAL);
+
+	if (ret == SOCKET_ERROR)
+	{
+		int error = GET_ERROR();
+		if (WOULD_BLOCK(error))
+			return true;
+		sock->incoming.error = error;
+		return false;
+	}
+
+	sock->outgoing.erase(0, ret);
+	return true;
+}
+
+// Marks part of the file being sent as done, closing it once it is sent
+void advance(FileTransfer &transfer, long count)
+{
+	transfer.offset += count;
+	transfer.remaining -= count;
+	transfer.done += count;
+	if (transfer.remaining <= 0)
+		transfer.file.reset();
+}
+
+// Sends the next part of the file being sent, once the outgoing data is sent
+// Returns false if the socket or the file failed
+bool send_file(Socket *sock)
+{
+	FileTransfer &transfer = sock->sending;
+	size_t count = (size_t) MIN(transfer.remaining, (std::int64_t) 65536);
+	long ret;
+
+	if (!transfer.file || !sock->outgoing.empty())
+		return true;
+
+	// Compressed streams receive the file in parts through the outgoing data
+	if (sock->deflate)
+	{
+		char buffer[65536];
+		ret = transfer.file->read(transfer.offset, buffer, count);
+		if (ret > 0)
+		{
+			sock->deflate->compress(buffer, ret, sock->outgoing);
+			advance(transfer, ret);
+			return send_outgoing(sock);
+		}
+	}
+	else
+	{
+		ret = transfer.file->send(sock->id, transfer.offset, transfer.remaining);
+		if (ret > 0)
+		{
+			advance(transfer, ret);
+			return true;
+		}
+	}
+
+	if (ret == 0)
+	{
+		// The file got shorter while it was being sent
+		transfer.file.reset();
+		return true;
+	}
+
+	int error = GET_ERROR();
+	if (WOULD_BLOCK(error))
+		return true;
+	sock->incoming.error = error;
+	return false;
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
+
+// Sends what the reliability layer of a socket has due; packets that are not
+// accepted are lost like any other and resent later.
+// Returns false if the socket is connected to a host that was given up on
+bool poll_reliable(Socket *sock, Clock::time_point now)
+{
+	std::vector<Reliable::Packet> packets;
+	bool answered = sock->reliable->poll(now, packets);
+
+	for (const Reliable::Packet &packet : packets)
+		transmit(sock->id, packet.peer, packet.data);
+
+	// Only a connected socket fails; a server simply forgets the host
+	SOCKADDR_STORAGE peer;
+	ADDRLEN size = sizeof (peer);
+	return answered || getpeername(sock->id, ADDR(&peer), &size) == SOCKET_ERROR;
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
+
+// Hands received stream data to the file being received, if any, and the rest
+// to the incoming buffer; no data marks the end of the stream
+// Returns false if the file failed
+bool deliver(Socket *sock, const char *data, size_t count)
+{
+	FileTransfer &transfer = sock->receiving;
+
+	if (transfer.file && count > 0)
+	{
+		size_t part = (size_t) MIN((std::int64_t) count, transfer.remaining);
+		if (transfer.file->write(transfer.offset, data, part) < 0)
+		{
+			sock->incoming.error = GET_ERROR();
+			return false;
+		}
+
+		advance(transfer, part);
+		data += part;
+		count -= part;
+		if (count == 0)
+			return true;
+	}
+
+	// A file that is received until the end is done now
+	if (count == 0)
+		transfer.file.reset();
+	sock->incoming.append(data, count);
+	return true;
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
+
+// Decompresses received stream data into the incoming buffer
+// Returns false if the stream was corrupted
+bool inflate_incoming(Socket *sock, const char *buffer, size_t count)
+{
+	std::string data;
+	if (!sock->inflate->decompress(buffer, count, data))
+	{
+		sock->incoming.error = CONNECTION_ABORTED;
+		return false;
+	}
+
+	// Note: appending nothing would mark the end of the stream
+	if (!data.empty())
+		return deliver(sock, data.data(), data.size());
+	return true;
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
+
+#ifdef UDP_GRO
+// Receives datagrams that the system may have coalesced; segment is set to the
+// size of the original datagrams, or zero if it did not coalesce them
+int recv_coalesced(SOCKET sock, char *buffer, size_t size,
+	SOCKADDR_STORAGE &source, int &segment)
+{
+	iovec data = {buffer, size};
+	char control[CMSG_SPACE(sizeof (int))];
+	msghdr message = {};
+	message.msg_name = &source;
+	message.msg_namelen = sizeof (source);
+	message.msg_iov = &data;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof (control);
+
+	segment = 0;
+	int ret = (int) recvmsg(sock, &message, 0);
+	if (ret == SOCKET_ERROR)
+		return ret;
+
+	for (cmsghdr *header = CMSG_FIRSTHDR(&message); header != nullptr;
+		header = CMSG_NXTHDR(&message, header))
+		if (header->cmsg_level == IPPROTO_UDP && header->cmsg_type == UDP_GRO)
+			memcpy(&segment, CMSG_DATA(header), sizeof (segment));
+	return ret;
+}
+#endif
+
+} /* namespace */
+
+//------------------------------------------------------------------------------
+
 void Pool::run()
 {
 	SOCKET signal = beacon_;
-	fd_set read;
+	fd_set read, write;
 	int nfds;
+	timeval timeout;
+	timeval *wait;
 	
 	DEBUG_P("Thread started");
 	for (;;) { /* event loop */
 	
 	// Reset FD sets
 	FD_ZERO(&read);
+	FD_ZERO(&write);
 	FD_SET(signal, &read);
 	nfds = signal;
+	wait = nullptr;
 	
 	// Add pool sockets to FD sets
 	{
 		Mutex::Lock lock(guard_);
 		
+		Clock::time_point deadline = Clock::time_point::max();
 		for (Socket *sock : sockets_)
 		{
 			FD_SET(sock->id, &read);
+			if (!sock->outgoing.empty() || sock->sending.file)
+				FD_SET(sock->id, &write);
+			if (sock->closing != Socket::OPEN)
+				deadline = std::min(deadline, sock->deadline);
+			if (sock->reliable)
+				deadline = std::min(deadline, sock->reliable->deadline());
 			// Windows ignores the nfds parameter, skip for efficiency
 		#ifndef _WIN32
 			if (nfds < sock->id)
 				nfds = sock->id;
 		#endif
 		}
+		
+		// Wake up when the linger time of a closed connection is up, or when
+		// a reliable socket has to resend or acknowledge
+		if (deadline != Clock::time_point::max())
+		{
+			long long us = std::chrono::duration_cast<std::chrono::microseconds>
+				(deadline - Clock::now()).count();
+			us = std::max(us, 0LL);
+			timeout.tv_sec = us / 1000000;
+			timeout.tv_usec = us % 1000000;
+			wait = &timeout;
+		}
 	}
 	
 	// Wait for events
-	select(nfds + 1, &read, nullptr, nullptr, nullptr);
+	select(nfds + 1, &read, &write, nullptr, wait);
 	// If select errs a socket was most likely closed locally, this is fine.
 	// We need to check which one(s) and ignore all 'would block's.
 	
@@ -65,14 +281,67 @@ void Pool::run()
 			DEBUG_P("Thread signalled");
 		}
 
+		Clock::time_point now = Clock::now();
 		for (Sockets::iterator it = sockets_.begin(); it != sockets_.end();)
 		{
 			Socket *sock = *it;
 
+			if (sock->closing != Socket::OPEN && now >= sock->deadline)
+			{
+				// Linger time is up: data that was not sent is lost, otherwise
+				// we simply stop waiting for the remote host.
+				if (!sock->outgoing.empty() || sock->sending.file)
+					sock->incoming.error = CONNECTION_ABORTED;
+				else
+					sock->incoming.append(nullptr, 0);
+				it = drop(it);
+				continue;
+			}
+
+			if (FD_ISSET(sock->id, &write)
+				&& (!send_outgoing(sock) || !send_file(sock)))
+			{
+				// This socket is done for, stop processing
+				it = drop(it);
+				continue;
+			}
+
+			// A closed connection is shut down once everything is sent
+			if (sock->closing == Socket::FLUSHING && sock->outgoing.empty()
+				&& !sock->sending.file)
+			{
+				shutdown(sock->id, SD_SEND);
+				sock->closing = Socket::DRAINING;
+			}
+
 			if (FD_ISSET(sock->id, &read))
 			{
 				char buffer[65536];
-				int ret = recv(sock->id, buffer, sizeof (buffer), 0);
+				SOCKADDR_STORAGE source = {}; // Unnamed local senders set no path
+				ADDRLEN size = sizeof (source);
+				int ret;
+				
+				// Files being received are written without using the buffer
+				// (unless the data needs to be decompressed first)
+				FileTransfer &transfer = sock->receiving;
+				bool direct = transfer.file && !sock->inflate;
+				
+				int segment = 0;
+				
+				// Datagrams are stored along with their source address
+				if (direct)
+					ret = transfer.file->receive(sock->id, transfer.offset,
+						(size_t) MIN(transfer.remaining, (std::int64_t) 65536));
+				else if (sock->type == SOCK_STREAM)
+					ret = recv(sock->id, buffer, sizeof (buffer), 0);
+			#ifdef UDP_GRO
+				else if (sock->coalesced)
+					ret = recv_coalesced(sock->id, buffer, sizeof (buffer),
+						source, segment);
+			#endif
+				else
+					ret = recvfrom(sock->id, buffer, sizeof (buffer), 0,
+						ADDR(&source), &size);
 				int error = GET_ERROR();
 				
 				// We ignore sockets that would block:
@@ -89,20 +358,39 @@ void Pool::run()
 				
 				if (ret == SOCKET_ERROR)
 					sock->incoming.error = error;
-				else if (sock->type == SOCK_STREAM)
-					sock->incoming.append(buffer, ret);
-				else
-					sock->incoming.push(buffer, ret);
+				else if (sock->reliable)
+					sock->reliable->receive(buffer, ret, segment, source,
+						sock->incoming, now);
+				else if (sock->type != SOCK_STREAM)
+					sock->incoming.split(buffer, ret, segment, source);
+				else if (direct && ret)
+					advance(transfer, ret);
+				else if (!sock->inflate || !ret)
+				{
+					if (!deliver(sock, buffer, ret))
+						ret = SOCKET_ERROR;
+				}
+				else if (!inflate_incoming(sock, buffer, ret))
+					ret = SOCKET_ERROR;
 				
 				if ((ret == SOCKET_ERROR)
 					|| (!ret && sock->type == SOCK_STREAM))
 				{
 					// This socket is done for, stop reading
-					sockets_.erase(it++);
+					it = drop(it);
 					continue;
 				}	
 			}
 
+			if (sock->reliable && now >= sock->reliable->deadline()
+				&& !poll_reliable(sock, now))
+			{
+				// The connected host stopped answering
+				sock->incoming.error = TIMED_OUT;
+				it = drop(it);
+				continue;
+			}
+
 			++it;
 		}
 		
@@ -130,6 +418,45 @@ void Pool::run()
 
 //------------------------------------------------------------------------------
 
+Pool::Sockets::iterator Pool::drop(Sockets::iterator it)
+{
+	Socket *sock = *it;
+	it = sockets_.erase(it);
+
+	// Files that are being transferred end with the connection
+	sock->sending.file.reset();
+	sock->receiving.file.reset();
+
+	// Connections that were closed locally are no longer used by the game
+	if (sock->closing != Socket::OPEN)
+	{
+		closesocket(sock->id);
+		sock->id = INVALID_SOCKET;
+		if (sock->orphaned)
+			delete sock;
+	}
+
+	return it;
+}
+
+//------------------------------------------------------------------------------
+
+Pool::~Pool()
+{
+	Mutex::Lock lock(guard_);
+
+	for (Sockets::iterator it = sockets_.begin(); it != sockets_.end();)
+	{
+		if ((*it)->orphaned)
+			it = drop(it);
+		else
+			++it;
+	}
+	beacon_.signal();
+}
+
+//------------------------------------------------------------------------------
+
 void Pool::add(Socket *sock)
 {
 	Mutex::Lock lock(guard_);
@@ -140,6 +467,47 @@ void Pool::add(Socket *sock)
 		beacon_.signal();
 }
 
+bool Pool::contains(Socket *sock)
+{
+	Mutex::Lock lock(guard_);
+
+	return sockets_.count(sock) > 0;
+}
+
+bool Pool::finish(Socket *sock)
+{
+	Mutex::Lock lock(guard_);
+
+	if (!sockets_.count(sock))
+		return false;
+
+	if (sock->closing == Socket::OPEN)
+	{
+		sock->deadline = Clock::now() + std::chrono::milliseconds(sock->linger);
+		if (sock->outgoing.empty() && !sock->sending.file)
+		{
+			shutdown(sock->id, SD_SEND);
+			sock->closing = Socket::DRAINING;
+		}
+		else
+			sock->closing = Socket::FLUSHING;
+		beacon_.signal();
+	}
+
+	return true;
+}
+
+bool Pool::orphan(Socket *sock)
+{
+	Mutex::Lock lock(guard_);
+
+	if (sock->closing == Socket::OPEN || !sockets_.count(sock))
+		return false;
+
+	sock->orphaned = true;
+	return true;
+}
+
 void Pool::remove(Socket *sock)
 {
 	Mutex::Lock lock(guard_);
@@ -159,6 +527,13 @@ void Pool::clear()
 	beacon_.signal();
 }
 
+void Pool::wake()
+{
+	Mutex::Lock lock(guard_);
+
+	beacon_.signal();
+}
+
 Pool::operator bool()
 {
 	Mutex::Lock lock(guard_);
@@ -26,8 +26,13 @@ namespace AGSSock {
 
 //! Allows sockets to be registered to a pool for which the incoming data is
 //! processed by a threaded read cycle.
-//! \warning Lock the pool when using id, protocol or the incoming buffer of
-//! a socket when it is registered to the pool to prevent race-conditions.
+//! Data queued in the outgoing buffer of a socket is sent by the read cycle as
+//! soon as the socket becomes writable, followed by the file being sent if
+//! there is one. Closed connections are finished by the read cycle as well, so
+//! that closing never has to wait.
+//! \warning Lock the pool when using id, protocol, the incoming and outgoing
+//! buffers or the file being sent of a socket when it is registered to the
+//! pool to prevent race-conditions.
 class Pool
 {
 	using Mutex = AGSSockAPI::Mutex;
@@ -43,13 +48,30 @@ class Pool
 	Thread thread_;   //!< Thread that processes incoming data of pool sockets
 
 	void run(); //!< Read cycle for pool sockets
+	//! Unregisters a socket during the read cycle, finishing it if it was closed
+	Sockets::iterator drop(Sockets::iterator);
 
 	public:
 	Pool() : thread_([this]() { run(); }) {}
+	~Pool(); //!< Deletes the sockets that were left to the pool to close
 
-	void add(Socket *);    //!< Registers a socket at the pool for processing
-	void remove(Socket *); //!< Unregisters a previously added socket
-	void clear();          //!< Unregisters all pool sockets
+
+	void add(Socket *);      //!< Registers a socket at the pool for processing
+	void remove(Socket *);   //!< Unregisters a previously added socket
+	bool contains(Socket *); //!< Returns whether a socket is registered
+
+	//! Finishes a closed connection gracefully: the outgoing data is sent,
+	//! the connection shut down and closed once the remote host closes it as
+	//! well or the linger time of the socket has passed.
+	//! \returns false if the socket is not registered
+	bool finish(Socket *);
+	//! Hands a connection that is being closed over to the pool, which deletes
+	//! it when done.
+	//! \returns false if the socket is not being closed by the pool
+	bool orphan(Socket *);
+
+	void clear();            //!< Unregisters all pool sockets
+	void wake();             //!< Makes the read cycle reconsider its sockets
 
 	//! Returns whether the threaded read cycle is currently active
 	bool active() { return thread_.active(); }
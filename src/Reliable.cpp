@@ -0,0 +1,517 @@
+/**************************************************************
+ * Reliable channels -- See header file for more information. *
+ **************************************************************/
+
+#include <algorithm>
+
+#include "Reliable.h"
+
+using namespace AGSSockAPI;
+
+namespace AGSSock {
+
+using std::string;
+
+const int Reliable::CHANNELS;
+const size_t Reliable::HEADER_SIZE;
+const size_t Reliable::MAX_MESSAGE;
+const std::uint16_t Reliable::WINDOW;
+const int Reliable::MAX_RETRIES;
+const int Reliable::ACK_EVERY;
+constexpr Reliable::Clock::duration Reliable::ACK_DELAY;
+constexpr Reliable::Clock::duration Reliable::MIN_TIMEOUT;
+constexpr Reliable::Clock::duration Reliable::MAX_TIMEOUT;
+constexpr Reliable::Clock::duration Reliable::INITIAL_TIMEOUT;
+constexpr Reliable::Clock::duration Reliable::IDLE_TIMEOUT;
+
+//------------------------------------------------------------------------------
+// Packet layout (network byte order):
+//     flags    8 bits: message, acks, delivery (2 bits) and channel (4 bits)
+//     sequence 16 bits
+//     ack      16 bits: the newest sequence number heard (if acks is set)
+//     ack bits 32 bits: bit n is set if ack - n - 1 was heard as well
+//     id       16 bits: of the message within its channel (if message is set)
+//     message  the rest of the packet
+// A packet without a message instead ends in any number of channel acks:
+//     channel  8 bits: delivery (ORDERED or RELIABLE) and channel, as in flags
+//     next     16 bits: every message before this id arrived
+
+namespace {
+
+const std::uint8_t FLAG_MESSAGE = 0x80;
+const std::uint8_t FLAG_ACKS = 0x40;
+const size_t ACK_SIZE = 9; // Of a packet without a message
+
+inline std::uint8_t message_flags(int delivery, int channel)
+{
+	return FLAG_MESSAGE | (std::uint8_t) (delivery << 4) | (std::uint8_t) channel;
+}
+
+inline void put16(std::string &packet, std::uint16_t value)
+{
+	packet.push_back((char) (value >> 8));
+	packet.push_back((char) value);
+}
+
+inline void put32(std::string &packet, std::uint32_t value)
+{
+	put16(packet, (std::uint16_t) (value >> 16));
+	put16(packet, (std::uint16_t) value);
+}
+
+inline std::uint16_t get16(const char *data)
+{
+	const unsigned char *bytes = reinterpret_cast<const unsigned char *> (data);
+	return (std::uint16_t) ((bytes[0] << 8) | bytes[1]);
+}
+
+inline std::uint32_t get32(const char *data)
+{
+	return ((std::uint32_t) get16(data) << 16) | get16(data + 2);
+}
+
+// Sequence numbers wrap around: a is newer if it is less than half ahead
+inline bool newer(std::uint16_t a, std::uint16_t b)
+{
+	return a != b && (std::uint16_t) (a - b) < 0x8000;
+}
+
+} /* namespace */
+
+//------------------------------------------------------------------------------
+// An idle peer is also forgotten when it is looked up, before poll gets to it:
+// a packet that arrives just then finds fresh state, like on the other side.
+
+Reliable::Peer *Reliable::find(const SOCKADDR_STORAGE &addr,
+	Clock::time_point now, bool create)
+{
+	auto it = peers_.find(addr);
+	if (it != peers_.end() && idle(it->second, now))
+	{
+		peers_.erase(it);
+		it = peers_.end();
+	}
+
+	if (it != peers_.end())
+		return &it->second;
+	if (!create)
+		return nullptr;
+
+	deadline_ = std::min(deadline_, now + IDLE_TIMEOUT);
+	return &peers_[addr];
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool Reliable::idle(const Peer &peer, Clock::time_point now)
+{
+	return peer.pending.empty() && peer.ack_due == Clock::time_point::max()
+		&& now - peer.active >= IDLE_TIMEOUT;
+}
+
+//------------------------------------------------------------------------------
+// Acknowledgements ride along with every packet, so none has to be sent on its
+// own later; unless more arrived than the bitfield covers.
+
+void Reliable::header(Peer &peer, std::uint8_t flags, std::string &packet,
+	Clock::time_point now)
+{
+	peer.active = now;
+
+	if (peer.heard)
+		flags |= FLAG_ACKS;
+
+	packet.push_back((char) flags);
+	put16(packet, peer.sequence++);
+	put16(packet, peer.heard ? peer.latest : 0);
+	put32(packet, peer.heard ? peer.received : 0);
+
+	if (peer.unacked <= 32)
+	{
+		peer.ack_due = Clock::time_point::max();
+		peer.unacked = 0;
+	}
+}
+
+//------------------------------------------------------------------------------
+
+bool Reliable::send(const SOCKADDR_STORAGE &addr, int delivery, int channel,
+	const char *buf, size_t count, std::string &packet, Clock::time_point now)
+{
+	Peer &peer = *find(addr, now, true);
+	std::uint16_t id = 0;
+
+	if (delivery == ORDERED || delivery == RELIABLE)
+	{
+		Outbound &out = peer.outbound[delivery][channel];
+		if ((std::uint16_t) (out.next - out.oldest) >= WINDOW)
+			return false;
+		id = out.next++;
+	}
+	else if (delivery == SEQUENCED)
+		id = peer.sequenced[channel]++;
+
+	std::uint8_t flags = message_flags(delivery, channel);
+	std::uint16_t sequence = peer.sequence;
+
+	packet.clear();
+	header(peer, flags, packet, now);
+	put16(packet, id);
+	packet.append(buf, count);
+
+	if (delivery == ORDERED || delivery == RELIABLE)
+	{
+		peer.pending[sequence] = Pending {now, 0, flags, id, string(buf, count)};
+		deadline_ = std::min(deadline_, now + peer.timeout);
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------------
+
+void Reliable::acknowledge(Peer &peer, std::uint16_t sequence,
+	Clock::time_point now, bool sample)
+{
+	auto it = peer.pending.find(sequence);
+	if (it == peer.pending.end())
+		return;
+
+	// Karn's algorithm: a resent message says nothing about the round trip
+	Pending &pending = it->second;
+	if (sample && !pending.tries)
+		measure(peer, now - pending.sent);
+
+	int delivery = (pending.flags >> 4) & 3;
+	Outbound &out = peer.outbound[delivery][pending.flags & 0x0F];
+	out.acked[pending.id % WINDOW] = true;
+	while (out.oldest != out.next && out.acked[out.oldest % WINDOW])
+		out.acked[out.oldest++ % WINDOW] = false;
+
+	peer.pending.erase(it);
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// The acknowledgement of a channel may come long after its messages arrived,
+// so it is no sample of the round trip time.
+
+void Reliable::acknowledge_channels(Peer &peer, const char *data, size_t count,
+	Clock::time_point now)
+{
+	// How many of the unacknowledged messages of each channel arrived
+	std::uint16_t arrived[2][CHANNELS] = {};
+	bool any = false;
+	for (; count >= 3; data += 3, count -= 3)
+	{
+		int delivery = (data[0] >> 4) & 3;
+		int channel = data[0] & 0x0F;
+		if (delivery != ORDERED && delivery != RELIABLE)
+			continue;
+
+		const Outbound &out = peer.outbound[delivery][channel];
+		std::uint16_t done = get16(data + 1) - out.oldest;
+		if (done <= (std::uint16_t) (out.next - out.oldest))
+		{
+			arrived[delivery][channel] = done;
+			any = any || done;
+		}
+	}
+
+	if (!any)
+		return;
+
+	std::vector<std::uint16_t> sequences;
+	for (const auto &entry : peer.pending)
+	{
+		const Pending &pending = entry.second;
+		int delivery = (pending.flags >> 4) & 3;
+		int channel = pending.flags & 0x0F;
+		std::uint16_t oldest = peer.outbound[delivery][channel].oldest;
+		if ((std::uint16_t) (pending.id - oldest) < arrived[delivery][channel])
+			sequences.push_back(entry.first);
+	}
+
+	for (std::uint16_t sequence : sequences)
+		acknowledge(peer, sequence, now, false);
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+void Reliable::measure(Peer &peer, Clock::duration sample)
+{
+	if (!peer.measured)
+	{
+		peer.srtt = sample;
+		peer.rttvar = sample / 2;
+		peer.measured = true;
+	}
+	else
+	{
+		Clock::duration delta = peer.srtt > sample
+			? peer.srtt - sample : sample - peer.srtt;
+		peer.rttvar = (3 * peer.rttvar + delta) / 4;
+		peer.srtt = (7 * peer.srtt + sample) / 8;
+	}
+
+	peer.timeout = std::min(std::max(peer.srtt + 4 * peer.rttvar, MIN_TIMEOUT),
+		MAX_TIMEOUT);
+}
+
+//------------------------------------------------------------------------------
+
+void Reliable::receive(const char *data, size_t count, size_t segment,
+	const SOCKADDR_STORAGE &source, Buffer &incoming, Clock::time_point now)
+{
+	if (segment == 0)
+		segment = count;
+
+	while (count > 0)
+	{
+		size_t size = std::min(segment, count);
+
+		// Only a message is worth state for an unknown peer: acknowledgements
+		// from it are of nothing that was sent
+		bool message = (data[0] & FLAG_MESSAGE) != 0;
+		Peer *peer = nullptr;
+		if (size >= (message ? HEADER_SIZE : ACK_SIZE))
+			peer = find(source, now, message);
+		if (peer)
+		{
+			peer->active = now;
+			deliver(*peer, data, size, source, incoming, now);
+		}
+		data += size;
+		count -= size;
+	}
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+void Reliable::deliver(Peer &peer, const char *data, size_t count,
+	const SOCKADDR_STORAGE &source, Buffer &incoming, Clock::time_point now)
+{
+	std::uint8_t flags = (std::uint8_t) data[0];
+	std::uint16_t sequence = get16(data + 1);
+
+	// Note which packets were heard, for the acknowledgements we send
+	if (!peer.heard)
+	{
+		peer.heard = true;
+		peer.latest = sequence;
+		peer.received = 0;
+	}
+	else if (newer(sequence, peer.latest))
+	{
+		std::uint16_t shift = sequence - peer.latest;
+		peer.received = shift > 32 ? 0 : shift == 32 ? 1u << 31
+			: (peer.received << shift) | (1u << (shift - 1));
+		peer.latest = sequence;
+	}
+	else if (sequence != peer.latest)
+	{
+		std::uint16_t behind = peer.latest - sequence;
+		if (behind <= 32)
+			peer.received |= 1u << (behind - 1);
+	}
+
+	// Then which of ours were heard
+	if (flags & FLAG_ACKS)
+	{
+		std::uint16_t ack = get16(data + 3);
+		std::uint32_t bits = get32(data + 5);
+		acknowledge(peer, ack, now);
+		for (int i = 0; bits; ++i, bits >>= 1)
+			if (bits & 1)
+				acknowledge(peer, ack - i - 1, now);
+	}
+
+	if (!(flags & FLAG_MESSAGE))
+	{
+		acknowledge_channels(peer, data + ACK_SIZE, count - ACK_SIZE, now);
+		return;
+	}
+
+	int delivery = (flags >> 4) & 3;
+	int channel = flags & 0x0F;
+	std::uint16_t id = get16(data + ACK_SIZE);
+	data += HEADER_SIZE;
+	count -= HEADER_SIZE;
+
+	if (delivery == UNRELIABLE)
+	{
+		incoming.push(data, count, source);
+		return;
+	}
+
+	Inbound &in = peer.inbound[delivery][channel];
+	if (delivery == SEQUENCED)
+	{
+		if (!in.heard || newer(id, in.next))
+		{
+			in.heard = true;
+			in.next = id;
+			incoming.push(data, count, source);
+		}
+		return;
+	}
+
+	// Reliable messages are acknowledged even when they are duplicates: the
+	// acknowledgement of the first one may have been lost.
+	peer.ack_due = std::min(peer.ack_due,
+		++peer.unacked >= ACK_EVERY ? now : now + ACK_DELAY);
+	deadline_ = std::min(deadline_, peer.ack_due);
+
+	// The sender never gets more than a window ahead; anything else is old
+	if ((std::uint16_t) (id - in.next) >= WINDOW)
+		return;
+	in.heard = true;
+
+	if (delivery == RELIABLE)
+	{
+		if (id != in.next)
+		{
+			if (in.seen.insert(id).second)
+				incoming.push(data, count, source);
+			return;
+		}
+
+		incoming.push(data, count, source);
+		while (in.seen.erase(++in.next));
+		return;
+	}
+
+	if (id != in.next)
+	{
+		in.held.emplace(id, string(data, count));
+		return;
+	}
+
+	incoming.push(data, count, source);
+	for (auto it = in.held.find(++in.next); it != in.held.end();
+		it = in.held.find(++in.next))
+	{
+		incoming.push(it->second.data(), it->second.size(), source);
+		in.held.erase(it);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Resent messages get a new packet sequence number: the acknowledgement of the
+// old packet would be indistinguishable otherwise.
+
+bool Reliable::poll(Clock::time_point now, std::vector<Packet> &packets)
+{
+	bool answered = true;
+	deadline_ = Clock::time_point::max();
+
+	for (auto it = peers_.begin(); it != peers_.end();)
+	{
+		Peer &peer = it->second;
+		if (idle(peer, now))
+		{
+			it = peers_.erase(it);
+			continue;
+		}
+
+		std::vector<Pending> resend;
+
+		for (auto p = peer.pending.begin(); p != peer.pending.end();)
+		{
+			Pending &pending = p->second;
+			Clock::duration timeout = std::min(peer.timeout * (1 << pending.tries),
+				MAX_TIMEOUT);
+			if (now < pending.sent + timeout)
+			{
+				deadline_ = std::min(deadline_, pending.sent + timeout);
+				++p;
+				continue;
+			}
+
+			resend.push_back(std::move(pending));
+			p = peer.pending.erase(p);
+		}
+
+		bool lost = false;
+		for (Pending &pending : resend)
+		{
+			if (++pending.tries > MAX_RETRIES)
+			{
+				lost = true;
+				break;
+			}
+
+			packets.push_back(Packet {it->first, string()});
+			std::string &packet = packets.back().data;
+			std::uint16_t sequence = peer.sequence;
+			header(peer, pending.flags, packet, now);
+			put16(packet, pending.id);
+			packet.append(pending.message);
+
+			pending.sent = now;
+			Clock::duration timeout = std::min(
+				peer.timeout * (1 << pending.tries), MAX_TIMEOUT);
+			deadline_ = std::min(deadline_, now + timeout);
+			peer.pending.emplace(sequence, std::move(pending));
+		}
+
+		// A peer that stays silent is forgotten, along with what it was sent
+		if (lost)
+		{
+			answered = false;
+			it = peers_.erase(it);
+			continue;
+		}
+
+		if (peer.ack_due <= now)
+		{
+			packets.push_back(Packet {it->first, string()});
+			std::string &packet = packets.back().data;
+			header(peer, 0, packet, now);
+			for (int delivery : {ORDERED, RELIABLE})
+				for (int channel = 0; channel < CHANNELS; ++channel)
+				{
+					const Inbound &in = peer.inbound[delivery][channel];
+					if (!in.heard)
+						continue;
+					packet.push_back((char) ((delivery << 4) | channel));
+					put16(packet, in.next);
+				}
+			peer.ack_due = Clock::time_point::max();
+			peer.unacked = 0;
+		}
+		deadline_ = std::min({deadline_, peer.ack_due,
+			peer.active + IDLE_TIMEOUT});
+		++it;
+	}
+
+	return answered;
+}
+
+//------------------------------------------------------------------------------
+
+Reliable::Clock::duration Reliable::round_trip(const SOCKADDR_STORAGE &addr) const
+{
+	auto it = peers_.find(addr);
+	if (it == peers_.end() || !it->second.measured)
+		return Clock::duration::zero();
+	return it->second.srtt;
+}
+
+//==============================================================================
+
+int transmit(SOCKET id, const SOCKADDR_STORAGE &peer, const std::string &packet)
+{
+	long ret = sendto(id, packet.data(), packet.size(), MSG_NOSIGNAL,
+		CONST_ADDR(&peer), ADDR_SIZE(&peer));
+
+	// Some systems refuse an address once the socket is connected
+	if (ret == SOCKET_ERROR && GET_ERROR() == ALREADY_CONNECTED)
+		ret = send(id, packet.data(), packet.size(), MSG_NOSIGNAL);
+
+	return ret == SOCKET_ERROR ? GET_ERROR() : 0;
+}
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+//..............................................................................
@@ -0,0 +1,187 @@
+/*******************************************************
+ * Reliable channels -- header file                    *
+ *                                                     *
+ * Author: Ferry "Wyz" Timmers                         *
+ *                                                     *
+ * Date: 15:20 2026-10-18                              *
+ *                                                     *
+ * Description: Adds acknowledgements, retransmission  *
+ *              and ordering to datagram sockets, per  *
+ *              channel, without blocking one another. *
+ *******************************************************/
+
+#ifndef _RELIABLE_H
+#define _RELIABLE_H
+
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "API.h"
+#include "Buffer.h"
+#include "SockAddr.h"
+
+namespace AGSSock {
+
+//------------------------------------------------------------------------------
+
+//! Reliability layer for the datagrams of one socket
+
+//! Every datagram is a packet with a header: a sequence number, the latest
+//! sequence number heard from the peer and a bitfield of the 32 before it. A
+//! packet may carry one message, which is delivered according to its channel:
+//! - ORDERED: resent until acknowledged, handed over in the order it was sent
+//! - RELIABLE: resent until acknowledged, handed over as soon as it arrives
+//! - SEQUENCED: never resent, dropped when a newer one arrived already
+//! - UNRELIABLE: never resent, handed over as is
+//! Reliable messages are resent once the timeout derived from the round trip
+//! time (RFC 6298) passes, doubling it each time. A packet without a message
+//! is sent when reliable messages arrived but no packet went back within
+//! ACK_DELAY, or right away after ACK_EVERY of them; it also tells up to which
+//! message each reliable channel arrived in full, so a burst longer than the
+//! bitfield is acknowledged as well. Each peer address has its own state, so a
+//! server can use one socket for all of its players. The state is forgotten
+//! once nothing was sent to or heard from the peer for IDLE_TIMEOUT, with
+//! nothing left to resend; the peer does the same, so both start over.
+//! \warning Not thread safe: the pool lock guards it.
+class Reliable
+{
+	public:
+	using Clock = std::chrono::steady_clock;
+
+	enum Delivery { ORDERED = 0, RELIABLE, SEQUENCED, UNRELIABLE, DELIVERIES };
+
+	static const int CHANNELS = 16;
+	static const size_t HEADER_SIZE = 11;      // Of a packet with a message
+	static const size_t MAX_MESSAGE = 65507 - HEADER_SIZE;
+	static const std::uint16_t WINDOW = 1024;  // Unacknowledged per channel
+	static const int MAX_RETRIES = 10;         // Before a peer is given up on
+	static const int ACK_EVERY = 16;           // Reliable packets per ack
+
+	static constexpr Clock::duration ACK_DELAY = std::chrono::milliseconds(5);
+	static constexpr Clock::duration MIN_TIMEOUT = std::chrono::milliseconds(50);
+	static constexpr Clock::duration MAX_TIMEOUT = std::chrono::seconds(2);
+	static constexpr Clock::duration INITIAL_TIMEOUT
+		= std::chrono::milliseconds(250);
+	static constexpr Clock::duration IDLE_TIMEOUT = std::chrono::seconds(30);
+
+	//! A packet that is to be sent to a peer
+	struct Packet
+	{
+		SOCKADDR_STORAGE peer;
+		std::string data;
+	};
+
+	//! Wraps a message for a peer into a packet; reliable messages are kept
+	//! until the peer acknowledges them.
+	//! \returns false when too many messages of the channel are unacknowledged
+	bool send(const SOCKADDR_STORAGE &peer, int delivery, int channel,
+		const char *buf, size_t count, std::string &packet, Clock::time_point now);
+	//! Unwraps datagrams that arrived (like Buffer::split), storing the
+	//! messages that can be handed over in the buffer
+	void receive(const char *data, size_t count, size_t segment,
+		const SOCKADDR_STORAGE &source, Buffer &incoming, Clock::time_point now);
+	//! Adds the packets that are due to be (re)sent
+	//! \returns false when a peer did not answer and was given up on
+	bool poll(Clock::time_point now, std::vector<Packet> &packets);
+
+	//! The time at which poll has something to do
+	Clock::time_point deadline() const { return deadline_; }
+	//! The smoothed round trip time to a peer, zero when there is no estimate
+	Clock::duration round_trip(const SOCKADDR_STORAGE &peer) const;
+	//! The number of peers there is state for
+	size_t peers() const { return peers_.size(); }
+
+	private:
+	struct Pending // A reliable message awaiting acknowledgement
+	{
+		Clock::time_point sent;
+		int tries;
+		std::uint8_t flags;
+		std::uint16_t id;
+		std::string message;
+	};
+
+	struct Outbound // Sender side of a reliable channel
+	{
+		std::uint16_t next = 0;  // Id of the next message
+		std::uint16_t oldest = 0; // Id of the oldest unacknowledged message
+		std::bitset<WINDOW> acked;
+	};
+
+	struct Inbound // Receiver side of a channel
+	{
+		std::uint16_t next = 0; // Id expected next (or the latest if sequenced)
+		bool heard = false;
+		std::unordered_map<std::uint16_t, std::string> held; // ORDERED
+		std::unordered_set<std::uint16_t> seen;               // RELIABLE
+	};
+
+	struct Peer
+	{
+		Clock::time_point active; // Last packet sent to or heard from it
+
+		// Sending
+		std::uint16_t sequence = 0;
+		std::unordered_map<std::uint16_t, Pending> pending; // By packet
+		Outbound outbound[2][CHANNELS];  // ORDERED and RELIABLE
+		std::uint16_t sequenced[CHANNELS] = {};
+
+		// Round trip time
+		bool measured = false;
+		Clock::duration srtt {}, rttvar {};
+		Clock::duration timeout = INITIAL_TIMEOUT;
+
+		// Receiving
+		bool heard = false;
+		std::uint16_t latest = 0;    // Newest packet sequence number heard
+		std::uint32_t received = 0;  // Bitfield of the 32 before it
+		int unacked = 0;             // Reliable packets since the last ack
+		Clock::time_point ack_due = Clock::time_point::max();
+		Inbound inbound[3][CHANNELS];    // ORDERED, RELIABLE and SEQUENCED
+	};
+
+	struct AddressHash
+	{
+		size_t operator ()(const SOCKADDR_STORAGE &addr) const
+			{ return address_hash(addr); }
+	};
+
+	struct AddressEqual
+	{
+		bool operator ()(const SOCKADDR_STORAGE &a,
+			const SOCKADDR_STORAGE &b) const
+			{ return address_equal(a, b); }
+	};
+
+	std::unordered_map<SOCKADDR_STORAGE, Peer, AddressHash, AddressEqual> peers_;
+	Clock::time_point deadline_ = Clock::time_point::max();
+
+	Peer *find(const SOCKADDR_STORAGE &, Clock::time_point now, bool create);
+	static bool idle(const Peer &, Clock::time_point now);
+	void header(Peer &, std::uint8_t flags, std::string &packet,
+		Clock::time_point now);
+	void acknowledge(Peer &, std::uint16_t sequence, Clock::time_point now,
+		bool sample = true);
+	void acknowledge_channels(Peer &, const char *data, size_t count,
+		Clock::time_point now);
+	void measure(Peer &, Clock::duration sample);
+	void deliver(Peer &, const char *data, size_t count,
+		const SOCKADDR_STORAGE &source, Buffer &incoming, Clock::time_point now);
+};
+
+//! Sends a packet to a peer, also when the socket is connected to it
+//! \returns an error code, or zero when successful
+int transmit(SOCKET id, const SOCKADDR_STORAGE &peer, const std::string &packet);
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+#endif /* _RELIABLE_H */
+
+//..............................................................................
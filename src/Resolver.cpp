@@ -0,0 +1,445 @@
+/*************************************************************
+ * Address resolver -- See header file for more information. *
+ *************************************************************/
+
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+
+#include "Resolver.h"
+
+namespace AGSSock {
+
+using namespace AGSSockAPI;
+
+Resolver *resolver;
+
+//------------------------------------------------------------------------------
+
+void parse_address(const char *addr, int family, Query &query)
+{
+	std::string &node = query.node, &service = query.service;
+	size_t index;
+
+	node = addr;
+	service.clear();
+
+	if ((index = node.find("://")) != std::string::npos)
+	{
+		service = node.substr(0, index);
+		node = node.substr(index + 3);
+	}
+
+	if ((family != AF_INET6)
+	&& ((index = node.rfind(':')) != std::string::npos))
+	{
+		service = node.substr(index + 1);
+		node.resize(index);
+	}
+
+	query.family = family ? family : AF_UNSPEC;
+	query.flags = AI_ADDRCONFIG | AI_V4MAPPED | (node.empty() ? AI_PASSIVE : 0);
+}
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+int lookup_system(const Query &query, Addresses &result)
+{
+	addrinfo hint, *list = nullptr;
+	memset(&hint, 0, sizeof (addrinfo));
+	hint.ai_flags = query.flags;
+	hint.ai_family = query.family;
+
+	int error = getaddrinfo(query.node.c_str(), query.service.c_str(), &hint,
+		&list);
+	if (error)
+		return error;
+
+	for (addrinfo *info = list; info != nullptr; info = info->ai_next)
+	{
+		if (info->ai_addrlen > sizeof (SOCKADDR_STORAGE))
+			continue;
+
+		// Every socket type yields the same address, keep just one of them
+		bool duplicate = false;
+		for (const SOCKADDR_STORAGE &addr : result)
+			duplicate |= !memcmp(&addr, info->ai_addr, info->ai_addrlen);
+		if (duplicate)
+			continue;
+
+		result.emplace_back();
+		memset(&result.back(), 0, sizeof (SOCKADDR_STORAGE));
+		memcpy(&result.back(), info->ai_addr, info->ai_addrlen);
+	}
+
+	freeaddrinfo(list);
+	return result.empty() ? EAI_NONAME : 0;
+}
+
+//------------------------------------------------------------------------------
+// Results are cached per query. The system does not tell how long a result
+// stays valid so a fixed time is used; failures are kept shorter so that a
+// temporary outage does not linger.
+
+using Clock = std::chrono::steady_clock;
+
+struct Entry
+{
+	Addresses addresses;
+	int error;
+	Clock::time_point expiry;
+};
+
+const size_t MAX_ENTRIES = 256; //!< The cache is pruned beyond this size
+
+Mutex cache_guard;
+std::unordered_map<std::string, Entry> cache;
+std::unordered_map<std::string, std::string> overrides;
+Clock::duration cache_time = std::chrono::seconds(60);
+Clock::duration failed_time = std::chrono::seconds(10);
+
+// Host names are case insensitive
+std::string host_key(const std::string &host)
+{
+	std::string key = host;
+	for (char &c : key)
+		c = (char) tolower((unsigned char) c);
+	return key;
+}
+
+std::string query_key(const Query &query)
+{
+	std::string key = host_key(query.node);
+	key += '\0';
+	key += query.service;
+	key += '\0';
+	key += std::to_string(query.family) + ':' + std::to_string(query.flags);
+	return key;
+}
+
+//------------------------------------------------------------------------------
+
+//! Answers a query from the host overrides or the cache if possible
+bool lookup_local(const Query &query, Addresses &result, int &error)
+{
+	Mutex::Lock lock(cache_guard);
+
+	auto it = overrides.find(host_key(query.node));
+	if (it != overrides.end())
+	{
+		// Numeric addresses are resolved without asking any server
+		Query numeric = query;
+		numeric.node = it->second;
+		numeric.flags |= AI_NUMERICHOST;
+		error = lookup_system(numeric, result);
+		return true;
+	}
+
+	auto entry = cache.find(query_key(query));
+	if (entry == cache.end())
+		return false;
+
+	if (entry->second.expiry <= Clock::now())
+	{
+		cache.erase(entry);
+		return false;
+	}
+
+	result = entry->second.addresses;
+	error = entry->second.error;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+
+void store(const Query &query, const Addresses &result, int error)
+{
+	Mutex::Lock lock(cache_guard);
+
+	Clock::duration time = error ? failed_time : cache_time;
+	if (time <= Clock::duration::zero())
+		return;
+
+	Clock::time_point now = Clock::now();
+	if (cache.size() >= MAX_ENTRIES)
+	{
+		for (auto it = cache.begin(); it != cache.end();)
+			if (it->second.expiry <= now)
+				it = cache.erase(it);
+			else
+				++it;
+
+		if (cache.size() >= MAX_ENTRIES)
+			cache.clear();
+	}
+
+	cache[query_key(query)] = Entry { result, error, now + time };
+}
+
+} /* namespace */
+
+//------------------------------------------------------------------------------
+
+int lookup(const Query &query, Addresses &result)
+{
+	int error;
+	if (lookup_local(query, result, error))
+		return error;
+
+	error = lookup_system(query, result);
+	store(query, result, error);
+	return error;
+}
+
+//------------------------------------------------------------------------------
+
+void set_cache_time(int seconds, int failed_seconds)
+{
+	Mutex::Lock lock(cache_guard);
+
+	cache_time = std::chrono::seconds(seconds);
+	failed_time = std::chrono::seconds(failed_seconds);
+	cache.clear();
+}
+
+//------------------------------------------------------------------------------
+
+void clear_cache()
+{
+	Mutex::Lock lock(cache_guard);
+
+	cache.clear();
+}
+
+//------------------------------------------------------------------------------
+
+void set_host_override(const std::string &host, const std::string &address)
+{
+	Mutex::Lock lock(cache_guard);
+
+	if (address.empty())
+		overrides.erase(host_key(host));
+	else
+		overrides[host_key(host)] = address;
+}
+
+//==============================================================================
+
+bool Resolver::Request::done()
+{
+	Mutex::Lock lock(guard_);
+	return done_;
+}
+
+//------------------------------------------------------------------------------
+
+void Resolver::Request::cancel()
+{
+	Mutex::Lock lock(guard_);
+	cancelled_ = true;
+}
+
+//------------------------------------------------------------------------------
+
+void Resolver::Request::run()
+{
+	{
+		Mutex::Lock lock(guard_);
+		if (cancelled_)
+			return;
+	}
+
+	Addresses result;
+	int error = lookup(query_, result);
+
+	Mutex::Lock lock(guard_);
+	error_ = error;
+	addresses_.swap(result);
+	done_ = true;
+}
+
+//==============================================================================
+
+Resolver::Resolver() : started_(0), idle_(0), stopping_(false) {}
+
+//------------------------------------------------------------------------------
+
+Resolver::~Resolver()
+{
+	size_t count;
+	{
+		Mutex::Lock lock(guard_);
+		stopping_ = true;
+		count = started_;
+	}
+
+	// Wake every worker so they notice; a worker stuck in a lookup is given
+	// two seconds by the thread destructor before it is killed.
+	for (size_t i = 0; i < count; ++i)
+		pending_.post();
+	for (size_t i = 0; i < count; ++i)
+		threads_[i].reset();
+}
+
+//------------------------------------------------------------------------------
+
+std::shared_ptr<Resolver::Request> Resolver::resolve(const Query &query)
+{
+	std::shared_ptr<Request> request(new Request(query));
+
+	// Answers that are known already do not need a worker
+	if (lookup_local(query, request->addresses_, request->error_))
+	{
+		request->done_ = true;
+		return request;
+	}
+
+	post([request]() { request->run(); });
+	return request;
+}
+
+//------------------------------------------------------------------------------
+// Reverse lookups are only ever started in the background; until the name is
+// known the numeric address is used instead. The results share the cache
+// times with the forward lookups.
+
+namespace {
+
+struct Name
+{
+	std::string host; //!< Empty if the lookup failed or is in progress
+	bool pending;
+	Clock::time_point expiry;
+};
+
+std::unordered_map<std::string, Name> names; // Guarded by the cache guard
+
+// Identifies the host of an address, ignoring the port
+bool name_key(const SOCKADDR_STORAGE &addr, std::string &key)
+{
+	const char *ptr;
+	size_t size;
+
+	if (addr.ss_family == AF_INET)
+	{
+		const sockaddr_in *in = reinterpret_cast<const sockaddr_in *> (&addr);
+		ptr = reinterpret_cast<const char *> (&in->sin_addr);
+		size = sizeof (in->sin_addr);
+	}
+	else if (addr.ss_family == AF_INET6)
+	{
+		const sockaddr_in6 *in = reinterpret_cast<const sockaddr_in6 *> (&addr);
+		ptr = reinterpret_cast<const char *> (&in->sin6_addr);
+		size = sizeof (in->sin6_addr);
+	}
+	else
+		return false;
+
+	key.assign(1, (char) addr.ss_family).append(ptr, size);
+	return true;
+}
+
+} /* namespace */
+
+bool Resolver::reverse(const SOCKADDR_STORAGE &addr, std::string &host)
+{
+	std::string key;
+	if (!name_key(addr, key))
+		return false;
+
+	{
+		Mutex::Lock lock(cache_guard);
+
+		auto it = names.find(key);
+		if (it != names.end()
+			&& (it->second.pending || it->second.expiry > Clock::now()))
+		{
+			host = it->second.host;
+			return !host.empty();
+		}
+
+		if (names.size() >= MAX_ENTRIES)
+			names.clear();
+		names[key] = Name { std::string(), true, Clock::time_point() };
+	}
+
+	post([addr, key]()
+	{
+		char buffer[NI_MAXHOST];
+		bool found = !getnameinfo(CONST_ADDR(&addr), ADDR_SIZE(&addr),
+			buffer, sizeof (buffer), nullptr, 0, NI_NAMEREQD);
+
+		Mutex::Lock lock(cache_guard);
+		Name &name = names[key];
+		name.host = found ? buffer : "";
+		name.pending = false;
+		name.expiry = Clock::now() + (found ? cache_time : failed_time);
+	});
+	return false;
+}
+
+//------------------------------------------------------------------------------
+
+void Resolver::post(Job job)
+{
+	{
+		Mutex::Lock lock(guard_);
+		queue_.push_back(std::move(job));
+
+		// Start another worker when the idle ones cannot keep up
+		if (queue_.size() > idle_ && started_ < MAX_THREADS)
+		{
+			size_t index = started_++;
+			++idle_;
+			threads_[index].reset(new Thread([this, index]() { run(index); }));
+			threads_[index]->start();
+		}
+	}
+
+	pending_.post();
+}
+
+//------------------------------------------------------------------------------
+
+void Resolver::run(size_t index)
+{
+	Thread *thread;
+	{
+		Mutex::Lock lock(guard_);
+		thread = threads_[index].get();
+	}
+
+	for (;;)
+	{
+		pending_.wait();
+
+		Job job;
+		{
+			Mutex::Lock lock(guard_);
+			if (stopping_)
+				break;
+
+			job.swap(queue_.front());
+			queue_.pop_front();
+			--idle_;
+		}
+
+		job();
+
+		{
+			Mutex::Lock lock(guard_);
+			++idle_;
+		}
+	}
+
+	thread->exit();
+}
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+//..............................................................................
@@ -0,0 +1,139 @@
+/*******************************************************
+ * Address resolver -- header file                     *
+ *                                                     *
+ * Author: Ferry "Wyz" Timmers                         *
+ *                                                     *
+ * Date: 15:02 2026-10-18                              *
+ *                                                     *
+ * Description: Resolves host names on a small pool of *
+ *              worker threads so that slow lookups do *
+ *              not stall the game.                    *
+ *******************************************************/
+
+#ifndef _RESOLVER_H
+#define _RESOLVER_H
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "API.h"
+
+namespace AGSSock {
+
+//------------------------------------------------------------------------------
+
+//! Address lookup parameters
+struct Query
+{
+	std::string node;    //!< Host name or numeric address
+	std::string service; //!< Service name or port number
+	int family;          //!< Address family, AF_UNSPEC for any
+	int flags;           //!< Flags passed on to getaddrinfo
+};
+
+using Addresses = std::vector<SOCKADDR_STORAGE>;
+
+//! Splits an address string of the form "service://node:service" into a query
+void parse_address(const char *addr, int family, Query &query);
+
+//! Looks up the addresses of a query; this blocks until it is done unless the
+//! answer is cached or the host name is overridden.
+//! \returns 0 if successful or a getaddrinfo error code otherwise.
+int lookup(const Query &query, Addresses &result);
+
+//! Sets how long lookup results are cached, for successful and failed lookups
+//! respectively (in seconds); zero disables caching.
+void set_cache_time(int seconds, int failed_seconds);
+//! Forgets all cached lookup results
+void clear_cache();
+//! Makes a host name resolve to a fixed numeric address instead of asking the
+//! system; an empty address removes the override.
+void set_host_override(const std::string &host, const std::string &address);
+
+//------------------------------------------------------------------------------
+
+//! Asynchronous address resolver
+
+//! Queries are queued and processed by worker threads, which are started as
+//! needed up to a fixed number so that several lookups proceed in parallel.
+class Resolver
+{
+	using Mutex = AGSSockAPI::Mutex;
+	using Semaphore = AGSSockAPI::Semaphore;
+	using Thread = AGSSockAPI::Thread;
+
+	public:
+	static const size_t MAX_THREADS = 4; //!< Upper bound of worker threads
+
+	//! Lookup in progress, shared between the requesting party and a worker
+	class Request
+	{
+		friend class Resolver;
+
+		Mutex guard_;
+		Query query_;
+		bool done_, cancelled_;
+		int error_;
+		Addresses addresses_;
+
+		void run(); //!< Performs the lookup unless cancelled
+
+		public:
+		Request(const Query &query)
+			: query_(query), done_(false), cancelled_(false), error_(0) {}
+
+		//! Returns whether the lookup has finished
+		bool done();
+		//! Abandons the lookup; it is skipped if it has not started yet
+		void cancel();
+
+		//! The getaddrinfo error code, only valid once done
+		int error() const { return error_; }
+		//! The resulting addresses, only valid once done
+		const Addresses &addresses() const { return addresses_; }
+	};
+
+	Resolver();
+	~Resolver(); //!< Stops the workers, abandoning queued requests
+
+	//! Queues a lookup and returns a handle to follow its progress
+	std::shared_ptr<Request> resolve(const Query &query);
+
+	using Job = std::function<void()>;
+
+	//! Queues a job for the workers, for tasks that start with a lookup
+	void post(Job job);
+
+	//! Looks up the host name of an address without blocking
+	//! \returns true and sets host if the name is known; otherwise a lookup is
+	//! started in the background, if not already in progress.
+	bool reverse(const SOCKADDR_STORAGE &addr, std::string &host);
+
+	Resolver(const Resolver &) = delete;
+	void operator =(const Resolver &) = delete;
+
+	private:
+	void run(size_t index); //!< Work cycle of a worker thread
+
+	Mutex guard_;         //!< Guards the queue and the worker administration
+	Semaphore pending_;   //!< Counts the jobs in the queue
+	std::deque<Job> queue_;
+	std::unique_ptr<Thread> threads_[MAX_THREADS];
+	size_t started_;      //!< Number of workers started
+	size_t idle_;         //!< Number of workers waiting for requests
+	bool stopping_;
+};
+
+//! The resolver used by the plugin, created by Initialize
+extern Resolver *resolver;
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+#endif /* _RESOLVER_H */
+
+//..............................................................................
@@ -0,0 +1,357 @@
+/******************************************************************
+ * Shared ring interface -- See header file for more information. *
+ ******************************************************************/
+
+#include <cstring>
+#include <new>
+
+#include "SharedRing.h"
+
+using namespace AGSSockAPI;
+
+namespace AGSSock {
+
+const std::uint32_t SharedRing::MAGIC;
+const size_t SharedRing::MIN_CAPACITY;
+const size_t SharedRing::MAX_CAPACITY;
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+const size_t HEADER_SIZE = 64; // The rings start on a cache line of their own
+static_assert(sizeof (SharedRing::Header) <= HEADER_SIZE, "header too large");
+
+size_t region_size(size_t capacity)
+{
+	return HEADER_SIZE + 2 * (sizeof (SharedRing::Control) + capacity);
+}
+
+} /* namespace */
+
+//------------------------------------------------------------------------------
+
+SharedRing::SharedRing(const char *name, size_t capacity) : side(0), error(0),
+	capacity(0)
+{
+	size_t size = MIN_CAPACITY;
+	while (size < capacity && size < MAX_CAPACITY)
+		size <<= 1;
+
+	memory.reset(new SharedMemory(name, region_size(size)));
+	if (!memory->valid())
+	{
+		error = memory->error();
+		memory.reset();
+		return;
+	}
+
+	// The region is filled with zeroes: both rings are empty and open
+	Header *head = new (memory->data()) Header();
+	head->capacity = this->capacity = (std::uint32_t) size;
+	new (control(0)) Control();
+	new (control(1)) Control();
+	head->magic.store(MAGIC, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------------
+
+SharedRing::SharedRing(const char *name) : side(1), error(0), capacity(0)
+{
+	memory.reset(new SharedMemory(name, 0));
+	if (!memory->valid())
+	{
+		error = memory->error();
+		memory.reset();
+		return;
+	}
+
+	// Refuse anything that was not made by Create, or not finished yet
+	if (memory->size() < HEADER_SIZE
+		|| header()->magic.load(std::memory_order_acquire) != MAGIC)
+	{
+		error = INVALID_ARGUMENT;
+		memory.reset();
+		return;
+	}
+
+	std::uint32_t size = header()->capacity;
+	if (size < MIN_CAPACITY || size > MAX_CAPACITY || (size & (size - 1))
+		|| memory->size() < region_size(size))
+	{
+		error = INVALID_ARGUMENT;
+		memory.reset();
+		return;
+	}
+	capacity = size;
+}
+
+//------------------------------------------------------------------------------
+
+SharedRing::~SharedRing()
+{
+	close();
+}
+
+//------------------------------------------------------------------------------
+
+SharedRing::Header *SharedRing::header() const
+{
+	return reinterpret_cast<Header *> (memory->data());
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+SharedRing::Control *SharedRing::control(int ring) const
+{
+	return reinterpret_cast<Control *> (memory->data() + HEADER_SIZE
+		+ ring * (sizeof (Control) + capacity));
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+char *SharedRing::ring(int ring) const
+{
+	return reinterpret_cast<char *> (control(ring)) + sizeof (Control);
+}
+
+//------------------------------------------------------------------------------
+// Positions count on past the capacity (and wrap around at 2^32); only the
+// part below the capacity is a place in the ring.
+
+void SharedRing::copy_in(int ring, std::uint32_t pos, const char *src,
+	size_t count)
+{
+	size_t offset = pos & (capacity - 1);
+	size_t first = MIN(count, capacity - offset);
+
+	memcpy(this->ring(ring) + offset, src, first);
+	memcpy(this->ring(ring), src + first, count - first);
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+void SharedRing::copy_out(int ring, std::uint32_t pos, char *dst,
+	size_t count) const
+{
+	size_t offset = pos & (capacity - 1);
+	size_t first = MIN(count, capacity - offset);
+
+	memcpy(dst, this->ring(ring) + offset, first);
+	memcpy(dst + first, this->ring(ring), count - first);
+}
+
+//------------------------------------------------------------------------------
+
+bool SharedRing::send(const char *buf, size_t count)
+{
+	if (!valid() || header()->closed[!side].load(std::memory_order_acquire))
+	{
+		error = NOT_CONNECTED;
+		return false;
+	}
+
+	std::uint32_t length = (std::uint32_t) count;
+	size_t needed = sizeof (length) + count;
+	if (count > capacity || needed > capacity)
+	{
+		error = INVALID_ARGUMENT;
+		return false;
+	}
+
+	error = 0;
+	Control *ctrl = control(side);
+	std::uint32_t head = ctrl->head.load(std::memory_order_relaxed);
+	std::uint32_t tail = ctrl->tail.load(std::memory_order_acquire);
+	if (head - tail > capacity)
+	{
+		// Only a misbehaving other side gets here
+		error = INVALID_ARGUMENT;
+		return false;
+	}
+	if (capacity - (head - tail) < needed)
+		return false;
+
+	copy_in(side, head, reinterpret_cast<const char *> (&length),
+		sizeof (length));
+	copy_in(side, head + sizeof (length), buf, count);
+	ctrl->head.store(head + (std::uint32_t) needed, std::memory_order_release);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool SharedRing::receive(std::string &data)
+{
+	if (!valid())
+	{
+		error = NOT_CONNECTED;
+		return false;
+	}
+
+	// Read the state of the other side first: what it sent before closing is
+	// then sure to be seen.
+	bool closed = header()->closed[!side].load(std::memory_order_acquire);
+	Control *ctrl = control(!side);
+	std::uint32_t tail = ctrl->tail.load(std::memory_order_relaxed);
+	std::uint32_t head = ctrl->head.load(std::memory_order_acquire);
+	if (head == tail)
+	{
+		error = closed ? NOT_CONNECTED : 0;
+		return false;
+	}
+
+	// Only a misbehaving other side gets to either error: the ring cannot
+	// hold more than its capacity, nor a message longer than what is in it.
+	std::uint32_t length;
+	if (head - tail > capacity || head - tail < sizeof (length))
+	{
+		error = INVALID_ARGUMENT;
+		return false;
+	}
+	copy_out(!side, tail, reinterpret_cast<char *> (&length), sizeof (length));
+	if (length > head - tail - sizeof (length))
+	{
+		error = INVALID_ARGUMENT;
+		return false;
+	}
+
+	data.resize(length);
+	copy_out(!side, tail + sizeof (length), &data[0], length);
+	ctrl->tail.store(tail + sizeof (length) + length, std::memory_order_release);
+	error = 0;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+
+void SharedRing::close()
+{
+	if (!valid())
+		return;
+
+	header()->closed[side].store(1, std::memory_order_release);
+	memory.reset();
+}
+
+//==============================================================================
+
+int AGSSharedRing::Dispose(const char *ptr, bool force)
+{
+	delete (SharedRing *) ptr;
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+// Note: like sockets, shared memory does not survive serialization; the ring
+// comes back closed.
+
+int AGSSharedRing::Serialize(const char *ptr, char *buffer, int size)
+{
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+
+void AGSSharedRing::Unserialize(int key, const char *buffer, int size)
+{
+	AGS_RESTORE(SharedRing, new SharedRing(), key);
+}
+
+//==============================================================================
+
+SharedRing *SharedRing_Create(const char *name, ags_t size)
+{
+	SharedRing *ring = new SharedRing(name, size > 0 ? (size_t) size : 0);
+	AGS_OBJECT(SharedRing, ring);
+	return ring;
+}
+
+//------------------------------------------------------------------------------
+
+SharedRing *SharedRing_Open(const char *name)
+{
+	SharedRing *ring = new SharedRing(name);
+	AGS_OBJECT(SharedRing, ring);
+	return ring;
+}
+
+//------------------------------------------------------------------------------
+
+ags_t SharedRing_get_Valid(SharedRing *ring)
+{
+	return ring->valid() ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
+
+ags_t SharedRing_ErrorValue(SharedRing *ring)
+{
+	return AGSEnumerateError(ring->error);
+}
+
+//------------------------------------------------------------------------------
+
+const char *SharedRing_ErrorString(SharedRing *ring)
+{
+	return AGSFormatError(ring->error);
+}
+
+//------------------------------------------------------------------------------
+
+ags_t SharedRing_Send(SharedRing *ring, const char *str)
+{
+	return ring->send(str, strlen(str)) ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
+
+ags_t SharedRing_SendData(SharedRing *ring, const SockData *data)
+{
+	if (data == nullptr)
+	{
+		ring->error = INVALID_ARGUMENT;
+		return 0;
+	}
+
+	return ring->send(data->bytes(), data->size()) ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
+
+const char *SharedRing_Recv(SharedRing *ring)
+{
+	std::string data;
+	if (!ring->receive(data))
+		return nullptr;
+
+	return AGS_STRING(data.c_str());
+}
+
+//------------------------------------------------------------------------------
+
+SockData *SharedRing_RecvData(SharedRing *ring)
+{
+	SockData *data = new SockData();
+	if (!ring->receive(data->data))
+	{
+		delete data;
+		return nullptr;
+	}
+
+	AGS_OBJECT(SockData, data);
+	return data;
+}
+
+//------------------------------------------------------------------------------
+
+void SharedRing_Close(SharedRing *ring)
+{
+	ring->close();
+}
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+//..............................................................................
@@ -0,0 +1,154 @@
+/*******************************************************
+ * Shared ring interface -- header file                *
+ *                                                     *
+ * Author: Ferry "Wyz" Timmers                         *
+ *                                                     *
+ * Date: 14:05 2026-10-18                              *
+ *                                                     *
+ * Description: Passes messages between two processes  *
+ *              on the same machine through shared     *
+ *              memory, without system calls.          *
+ *******************************************************/
+
+#ifndef _SHAREDRING_H
+#define _SHAREDRING_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "API.h"
+#include "SockData.h"
+
+namespace AGSSock {
+
+//------------------------------------------------------------------------------
+
+//! Two message queues in shared memory, one for each direction
+
+//! The region starts with a header, followed by a ring for the messages of the
+//! side that created it and one for the side that opened it. A message is its
+//! length (32 bits, native byte order) followed by its bytes; both wrap around
+//! at the end of the ring. Only the sender moves the head of a ring and only
+//! the receiver moves the tail, so neither side ever waits for the other.
+//! The game polls like it does sockets; there is nobody to wake up.
+struct SharedRing
+{
+	static const std::uint32_t MAGIC = 0x52534741; // "AGSR"
+	static const size_t MIN_CAPACITY = 4096;
+	static const size_t MAX_CAPACITY = 1 << 30;
+
+	struct Header
+	{
+		std::atomic<std::uint32_t> magic; // Set once the region is ready
+		std::uint32_t capacity;           // Bytes in each ring, a power of two
+		std::atomic<std::uint32_t> closed[2]; // Whether a side has closed
+	};
+
+	struct alignas(64) Control
+	{
+		alignas(64) std::atomic<std::uint32_t> head; // Moved by the sender
+		alignas(64) std::atomic<std::uint32_t> tail; // Moved by the receiver
+	};
+
+	std::unique_ptr<AGSSockAPI::SharedMemory> memory;
+	int side;  // 0 for the side that created it, 1 for the one that opened it
+	int error;
+	std::uint32_t capacity; // Checked once, the header is not to be trusted
+
+	//! Creates the region under a name with rings of at least capacity bytes
+	SharedRing(const char *name, size_t capacity);
+	//! Opens the region another process created under the name
+	explicit SharedRing(const char *name);
+	SharedRing() : side(0), error(0), capacity(0) {} //!< Not attached
+	~SharedRing(); //!< Closes
+
+	bool valid() const { return memory != nullptr; }
+
+	//! Queues a message; false with error zero when it does not fit right now
+	bool send(const char *buf, size_t count);
+	//! Takes the next message; false with error zero when there is none yet
+	bool receive(std::string &data);
+	//! Tells the other side no more messages come and lets go of the region
+	void close();
+
+	private:
+	Header *header() const;
+	Control *control(int ring) const;
+	char *ring(int ring) const;
+	void copy_in(int ring, std::uint32_t pos, const char *src, size_t count);
+	void copy_out(int ring, std::uint32_t pos, char *dst, size_t count) const;
+	void attach();
+};
+
+AGS_DEFINE_CLASS(SharedRing)
+
+//------------------------------------------------------------------------------
+
+SharedRing *SharedRing_Create(const char *name, ags_t size);
+SharedRing *SharedRing_Open(const char *name);
+
+ags_t SharedRing_get_Valid(SharedRing *);
+ags_t SharedRing_ErrorValue(SharedRing *);
+const char *SharedRing_ErrorString(SharedRing *);
+
+ags_t SharedRing_Send(SharedRing *, const char *);
+ags_t SharedRing_SendData(SharedRing *, const SockData *);
+const char *SharedRing_Recv(SharedRing *);
+SockData *SharedRing_RecvData(SharedRing *);
+void SharedRing_Close(SharedRing *);
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+//------------------------------------------------------------------------------
+//                           Plugin interface
+
+#define SHAREDRING_HEADER \
+	"\r\n" \
+	"managed struct SharedRing\r\n" \
+	"{\r\n" \
+	"	/// Creates shared memory under a name for another program on this machine to open. Size is the number of bytes buffered in each direction.\r\n" \
+	"	import static SharedRing *Create(const string name, int size = 65536); // $AUTOCOMPLETESTATICONLY$\r\n" \
+	"	/// Opens the shared memory another program created under the name.\r\n" \
+	"	import static SharedRing *Open(const string name);                     // $AUTOCOMPLETESTATICONLY$\r\n" \
+	"	\r\n" \
+	"	readonly import attribute bool Valid;\r\n" \
+	"	\r\n" \
+	"	/// Returns the last error observed from this ring as an enumerated value.\r\n" \
+	"	import SockError ErrorValue();\r\n" \
+	"	/// Returns the last error observed from this ring as an human readable string.\r\n" \
+	"	import String ErrorString();\r\n" \
+	"	\r\n" \
+	"	/// Sends a string as one message. (no error means: full, try again later)\r\n" \
+	"	import bool Send(const string msg);\r\n" \
+	"	/// Sends raw data as one message. (no error means: full, try again later)\r\n" \
+	"	import bool SendData(SockData *data);\r\n" \
+	"	/// Receives the next message as a string. (null and no error means: try again later)\r\n" \
+	"	import String Recv();\r\n" \
+	"	/// Receives the next message as raw data. (null and no error means: try again later)\r\n" \
+	"	import SockData *RecvData();\r\n" \
+	"	/// Lets the other program know no more messages come.\r\n" \
+	"	import void Close();\r\n" \
+	"};\r\n"
+
+#define SHAREDRING_ENTRY 	                     \
+	AGS_CLASS   (SharedRing)                     \
+	AGS_METHOD  (SharedRing, Create, 2)          \
+	AGS_METHOD  (SharedRing, Open, 1)            \
+	AGS_READONLY(SharedRing, Valid)              \
+	AGS_METHOD  (SharedRing, ErrorValue, 0)      \
+	AGS_METHOD  (SharedRing, ErrorString, 0)     \
+	AGS_METHOD  (SharedRing, Send, 1)            \
+	AGS_METHOD  (SharedRing, SendData, 1)        \
+	AGS_METHOD  (SharedRing, Recv, 0)            \
+	AGS_METHOD  (SharedRing, RecvData, 0)        \
+	AGS_METHOD  (SharedRing, Close, 0)
+
+//------------------------------------------------------------------------------
+
+#endif /* _SHAREDRING_H */
+
+//..............................................................................
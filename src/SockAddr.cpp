@@ -6,12 +6,25 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <memory>
 #include <string>
+#include <unordered_map>
 
+#include "Resolver.h"
 #include "SockAddr.h"
 
 namespace AGSSock {
 
+// Addresses created asynchronously; the result is applied when the status is
+// first observed after the lookup finished.
+struct Lookup
+{
+	std::shared_ptr<Resolver::Request> request;
+	ags_t status;
+};
+
+std::unordered_map<const SockAddr *, Lookup> lookups;
+
 //------------------------------------------------------------------------------
 
 void decode_type(ags_t &type)
@@ -22,10 +35,130 @@ void decode_type(ags_t &type)
 		type = AF_INET6;
 }
 
+//------------------------------------------------------------------------------
+// Abstract names are written with a leading @ in place of the null character.
+
+std::string get_local_path(const SockAddr *sa)
+{
+	const sockaddr_un *addr = reinterpret_cast<const sockaddr_un *> (sa);
+	size_t length = ADDR_SIZE(sa) - offsetof(sockaddr_un, sun_path);
+
+	if (!length)
+		return std::string();
+	else if (addr->sun_path[0])
+		return std::string(addr->sun_path, strnlen(addr->sun_path, length));
+	else
+		return "@" + std::string(addr->sun_path + 1, length - 1);
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
+
+// Paths that do not fit leave the address empty
+void set_local_path(SockAddr *sa, const char *path)
+{
+	sockaddr_un *addr = reinterpret_cast<sockaddr_un *> (sa);
+	size_t length = strlen(path);
+	memset(addr->sun_path, 0, sizeof (addr->sun_path));
+
+	if (length < sizeof (addr->sun_path))
+		memcpy(addr->sun_path, path, length);
+	if (addr->sun_path[0] == '@')
+		addr->sun_path[0] = '\0';
+
+#ifdef __APPLE__
+	addr->sun_len = offsetof(sockaddr_un, sun_path)
+		+ (length < sizeof (addr->sun_path) ? length + 1 : 0);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+// Stops following an asynchronous lookup of an address, if any
+void forget_lookup(const SockAddr *sa)
+{
+	auto it = lookups.find(sa);
+	if (it != lookups.end())
+	{
+		if (it->second.request)
+			it->second.request->cancel();
+		lookups.erase(it);
+	}
+}
+
+//------------------------------------------------------------------------------
+
+bool address_equal(const SOCKADDR_STORAGE &a, const SOCKADDR_STORAGE &b)
+{
+	if (a.ss_family != b.ss_family)
+		return false;
+
+	if (a.ss_family == AF_INET)
+	{
+		const sockaddr_in &x = reinterpret_cast<const sockaddr_in &> (a);
+		const sockaddr_in &y = reinterpret_cast<const sockaddr_in &> (b);
+		return x.sin_port == y.sin_port
+			&& x.sin_addr.s_addr == y.sin_addr.s_addr;
+	}
+	else if (a.ss_family == AF_INET6)
+	{
+		const sockaddr_in6 &x = reinterpret_cast<const sockaddr_in6 &> (a);
+		const sockaddr_in6 &y = reinterpret_cast<const sockaddr_in6 &> (b);
+		return x.sin6_port == y.sin6_port
+			&& x.sin6_scope_id == y.sin6_scope_id
+			&& !memcmp(&x.sin6_addr, &y.sin6_addr, sizeof (x.sin6_addr));
+	}
+	else
+		return !memcmp(&a, &b, ADDR_SIZE(&a));
+}
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+// FNV-1a
+std::uint32_t hash_bytes(std::uint32_t hash, const void *data, size_t size)
+{
+	const unsigned char *bytes = static_cast<const unsigned char *> (data);
+	for (size_t i = 0; i < size; ++i)
+		hash = (hash ^ bytes[i]) * 16777619u;
+	return hash;
+}
+
+} /* namespace */
+
+std::uint32_t address_hash(const SOCKADDR_STORAGE &a)
+{
+	std::uint32_t hash = hash_bytes(2166136261u, &a.ss_family,
+		sizeof (a.ss_family));
+
+	if (a.ss_family == AF_INET)
+	{
+		const sockaddr_in &x = reinterpret_cast<const sockaddr_in &> (a);
+		hash = hash_bytes(hash, &x.sin_port, sizeof (x.sin_port));
+		hash = hash_bytes(hash, &x.sin_addr, sizeof (x.sin_addr));
+	}
+	else if (a.ss_family == AF_INET6)
+	{
+		const sockaddr_in6 &x = reinterpret_cast<const sockaddr_in6 &> (a);
+		hash = hash_bytes(hash, &x.sin6_port, sizeof (x.sin6_port));
+		hash = hash_bytes(hash, &x.sin6_scope_id, sizeof (x.sin6_scope_id));
+		hash = hash_bytes(hash, &x.sin6_addr, sizeof (x.sin6_addr));
+	}
+	else
+		hash = hash_bytes(hash, &a, ADDR_SIZE(&a));
+
+	// Final mix so that the low bits depend on every byte
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6Bu;
+	hash ^= hash >> 13;
+	return hash;
+}
+
 //------------------------------------------------------------------------------
 
 int AGSSockAddr::Dispose(const char *addr, bool force)
 {
+	forget_lookup((const SockAddr *) addr);
 	delete (SockAddr *) addr;
 	return 1;
 }
@@ -74,11 +207,24 @@ SockAddr *SockAddr_CreateFromString(const char *str, ags_t type)
 
 //------------------------------------------------------------------------------
 
+SockAddr *SockAddr_CreateFromStringAsync(const char *str, ags_t type)
+{
+	decode_type(type);
+	SockAddr *addr = SockAddr_Create(type);
+
+	Query query;
+	parse_address(str, type, query);
+	lookups[addr] = Lookup { resolver->resolve(query), AGSSOCK_ADDR_PENDING };
+	return addr;
+}
+
+//------------------------------------------------------------------------------
+
 SockAddr *SockAddr_CreateFromData(const SockData *data)
 {
 	SockAddr *addr = new SockAddr; // by design
 	AGS_OBJECT(SockAddr, addr);
-	memcpy(addr, data->data.data(), MIN(data->data.size(), sizeof (SockAddr)));
+	memcpy(addr, data->bytes(), MIN(data->size(), sizeof (SockAddr)));
 	return addr;
 }
 
@@ -104,6 +250,15 @@ SockAddr *SockAddr_CreateIPv6(const char *ip, ags_t port)
 
 //------------------------------------------------------------------------------
 
+SockAddr *SockAddr_CreateLocal(const char *path)
+{
+	SockAddr *addr = SockAddr_Create(AF_UNIX);
+	set_local_path(addr, path);
+	return addr;
+}
+
+//------------------------------------------------------------------------------
+
 ags_t SockAddr_get_Port(SockAddr *sa)
 {
 	if (sa->ss_family == AF_INET)
@@ -138,37 +293,41 @@ void SockAddr_set_Port(SockAddr *sa, ags_t port)
 
 //------------------------------------------------------------------------------
 
+// The numeric host is returned until the host name is known; the name is
+// resolved in the background so that reading the address never blocks.
+
 const char *SockAddr_get_Address(SockAddr *sa)
 {
-	std::string addr;
+	std::string addr, name;
 	char host[NI_MAXHOST];
 	char serv[NI_MAXSERV];
 	
+	if (sa->ss_family == AF_UNIX)
+		return AGS_STRING(get_local_path(sa).c_str());
+	
 	if (getnameinfo(ADDR(sa), ADDR_SIZE(sa),
-		host, sizeof (host), serv, sizeof (serv), 0))
+		host, sizeof (host), serv, sizeof (serv), NI_NUMERICHOST))
 	{
 		// It failed: let's try without service names
 		if (getnameinfo(ADDR(sa), ADDR_SIZE(sa),
-			host, sizeof (host), NULL, 0, 0))
+			host, sizeof (host), NULL, 0, NI_NUMERICHOST))
 		{
 			// Handle error:
 			// we'll just return an empty string, that will be comforting enough
+			return AGS_STRING("");
 		}
-		else
-		{
-			sprintf(serv, "%d", SockAddr_get_Port(sa));
-			addr = (std::string(host) + ":") + serv;
-		}
+		sprintf(serv, "%d", SockAddr_get_Port(sa));
 	}
+	
+	if (!resolver->reverse(*sa, name))
+		name = host;
+	
+	if (!serv[0] || (serv[0] == '0' && !serv[1]))
+		addr = name;
+	else if (atof(serv) == 0.0) // A bit wonky but does the trick
+		addr = (std::string(serv) + "://") + name;
 	else
-	{
-		if (!serv[0] || (serv[0] == '0' && !serv[1]))
-			addr = host;
-		else if (atof(serv) == 0.0) // A bit wonky but does the trick
-			addr = (std::string(serv) + "://") + host;
-		else
-			addr = (std::string(host) + ":") + serv;
-	}
+		addr = (name + ":") + serv;
 	
 	return AGS_STRING(addr.c_str());
 }
@@ -177,28 +336,19 @@ const char *SockAddr_get_Address(SockAddr *sa)
 
 void SockAddr_set_Address(SockAddr *sa, const char *addr)
 {
-	std::string node = addr, service;
-	size_t index;
-	
-	if ((index = node.find("://")) != std::string::npos)
-	{
-		service = node.substr(0, index);
-		node = node.substr(index + 3);
-	}
+	Query query;
+	Addresses result;
+	forget_lookup(sa); // The new address replaces a pending one
 	
-	if ((sa->ss_family != AF_INET6)
-	&& ((index = node.rfind(':')) != std::string::npos))
+	if (sa->ss_family == AF_UNIX)
 	{
-		service = node.substr(index + 1);
-		node.resize(index);
+		set_local_path(sa, addr);
+		return;
 	}
 	
-	addrinfo hint, *result = nullptr;
-	memset(&hint, 0, sizeof (addrinfo));
-	hint.ai_flags = AI_ADDRCONFIG | AI_V4MAPPED | (node.empty() ? AI_PASSIVE : 0);
-	hint.ai_family = sa->ss_family ? sa->ss_family : AF_UNSPEC;
+	parse_address(addr, sa->ss_family, query);
 	
-	if (getaddrinfo(node.c_str(), service.c_str(), &hint, &result) || !result)
+	if (lookup(query, result))
 	{
 		// Handle error:
 		// We'll simply do nothing when address resolving failed;
@@ -207,8 +357,7 @@ void SockAddr_set_Address(SockAddr *sa, const char *addr)
 		return;
 	}
 
-	memcpy(sa, result->ai_addr, result->ai_addrlen);
-	freeaddrinfo(result);
+	memcpy(sa, &result.front(), sizeof (SOCKADDR_STORAGE));
 }
 
 //------------------------------------------------------------------------------
@@ -250,6 +399,66 @@ void SockAddr_set_IP(SockAddr *sa, const char *ip)
 
 //------------------------------------------------------------------------------
 
+ags_t SockAddr_get_Status(SockAddr *sa)
+{
+	auto it = lookups.find(sa);
+	if (it == lookups.end())
+		return AGSSOCK_ADDR_RESOLVED;
+
+	Lookup &entry = it->second;
+	if (entry.request && entry.request->done())
+	{
+		if (entry.request->error())
+			entry.status = AGSSOCK_ADDR_FAILED;
+		else
+		{
+			memcpy(sa, &entry.request->addresses().front(),
+				sizeof (SOCKADDR_STORAGE));
+			entry.status = AGSSOCK_ADDR_RESOLVED;
+		}
+		entry.request.reset();
+	}
+
+	return entry.status;
+}
+
+//------------------------------------------------------------------------------
+
+ags_t SockAddr_Equals(SockAddr *sa, const SockAddr *other)
+{
+	return other != nullptr && address_equal(*sa, *other) ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
+
+ags_t SockAddr_Hash(SockAddr *sa)
+{
+	return address_hash(*sa) & 0x7FFFFFFF;
+}
+
+//==============================================================================
+
+void SockAddr_SetHostOverride(const char *host, const char *addr)
+{
+	set_host_override(host, addr ? addr : "");
+}
+
+//------------------------------------------------------------------------------
+
+void SockAddr_SetCacheTime(ags_t seconds, ags_t failed_seconds)
+{
+	set_cache_time(seconds, failed_seconds);
+}
+
+//------------------------------------------------------------------------------
+
+void SockAddr_ClearCache()
+{
+	clear_cache();
+}
+
+//==============================================================================
+
 SockData *SockAddr_GetData(SockAddr *sa)
 {
 	SockData *data = new SockData();
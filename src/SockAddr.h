@@ -12,6 +12,8 @@
 #ifndef _SOCKADDR_H
 #define _SOCKADDR_H
 
+#include <cstdint>
+
 #include "API.h"
 #include "SockData.h"
 
@@ -25,13 +27,20 @@ struct SockAddr : public SOCKADDR_STORAGE
 
 AGS_DEFINE_CLASS(SockAddr)
 
+//! Compares the family, host and port of two addresses (and nothing else)
+bool address_equal(const SOCKADDR_STORAGE &, const SOCKADDR_STORAGE &);
+//! Hashes the parts of an address that address_equal compares
+std::uint32_t address_hash(const SOCKADDR_STORAGE &);
+
 //------------------------------------------------------------------------------
 
 SockAddr *SockAddr_Create(ags_t type);
 SockAddr *SockAddr_CreateFromString(const char *, ags_t type);
+SockAddr *SockAddr_CreateFromStringAsync(const char *, ags_t type);
 SockAddr *SockAddr_CreateFromData(const SockData *);
 SockAddr *SockAddr_CreateIP(const char *addr, ags_t port);
 SockAddr *SockAddr_CreateIPv6(const char *addr, ags_t port);
+SockAddr *SockAddr_CreateLocal(const char *path);
 
 ags_t SockAddr_get_Port(SockAddr *);
 void SockAddr_set_Port(SockAddr *, ags_t);
@@ -39,6 +48,14 @@ const char *SockAddr_get_Address(SockAddr *);
 void SockAddr_set_Address(SockAddr *, const char *);
 const char *SockAddr_get_IP(SockAddr *);
 void SockAddr_set_IP(SockAddr *, const char *);
+ags_t SockAddr_get_Status(SockAddr *);
+
+ags_t SockAddr_Equals(SockAddr *, const SockAddr *);
+ags_t SockAddr_Hash(SockAddr *);
+
+void SockAddr_SetHostOverride(const char *host, const char *addr);
+void SockAddr_SetCacheTime(ags_t seconds, ags_t failed_seconds);
+void SockAddr_ClearCache();
 
 SockData *SockAddr_GetData(SockAddr *);
 
@@ -49,27 +66,55 @@ SockData *SockAddr_GetData(SockAddr *);
 //------------------------------------------------------------------------------
 //                           Plugin interface
 
+// Status constant values of address resolution
+#define AGSSOCK_ADDR_RESOLVED 0
+#define AGSSOCK_ADDR_PENDING  1
+#define AGSSOCK_ADDR_FAILED   2
 
 #define SOCKADDR_HEADER \
 	"#define IPv4 -1\r\n" \
 	"#define IPv6 -2\r\n" \
 	"\r\n" \
+	"enum SockAddrStatus\r\n" \
+	"{\r\n" \
+	"	eSockAddrResolved = " STRINGIFY(AGSSOCK_ADDR_RESOLVED) ",\r\n" \
+	"	eSockAddrPending  = " STRINGIFY(AGSSOCK_ADDR_PENDING) ",\r\n" \
+	"	eSockAddrFailed   = " STRINGIFY(AGSSOCK_ADDR_FAILED) "\r\n" \
+	"};\r\n" \
+	"\r\n" \
 	"managed struct SockAddr\r\n" \
 	"{\r\n" \
 	"  /// Creates an empty socket address. (advanced: set type to IPv6 if you're using IPv6).\r\n" \
 	"  import static SockAddr *Create(int type = IPv4);                                 // $AUTOCOMPLETESTATICONLY$\r\n" \
 	"  /// Creates a socket address from a string. (for example: \"http://www.adventuregamestudio.co.uk\")\r\n" \
 	"  import static SockAddr *CreateFromString(const string address, int type = IPv4); // $AUTOCOMPLETESTATICONLY$\r\n" \
+	"  /// Creates a socket address from a string without waiting for the host name to be resolved; check the Status before using it.\r\n" \
+	"  import static SockAddr *CreateFromStringAsync(const string address, int type = IPv4); // $AUTOCOMPLETESTATICONLY$\r\n" \
 	"  /// Creates a socket address from raw data. (advanced)\r\n" \
 	"  import static SockAddr *CreateFromData(SockData *);                              // $AUTOCOMPLETEIGNORE$\r\n" \
 	"  /// Creates a socket address from an IP-address. (for example: \"127.0.0.1\")\r\n" \
 	"  import static SockAddr *CreateIP(const string address, int port);                // $AUTOCOMPLETESTATICONLY$\r\n" \
 	"  /// Creates a socket address from an IPv6-address. (for example: \"::1\")\r\n" \
 	"  import static SockAddr *CreateIPv6(const string address, int port);              // $AUTOCOMPLETESTATICONLY$\r\n" \
+	"  /// Creates a local socket address from a file path, or from an abstract name starting with @. (abstract names are Linux only)\r\n" \
+	"  import static SockAddr *CreateLocal(const string path);                          // $AUTOCOMPLETESTATICONLY$\r\n" \
+	"  /// Makes a host name resolve to the given IP-address instead of looking it up. (null removes it)\r\n" \
+	"  import static void SetHostOverride(const string host, const string ip);           // $AUTOCOMPLETESTATICONLY$\r\n" \
+	"  /// Sets how many seconds resolved host names are remembered. (zero disables it)\r\n" \
+	"  import static void SetCacheTime(int seconds = 60, int failed_seconds = 10);       // $AUTOCOMPLETESTATICONLY$\r\n" \
+	"  /// Forgets all remembered host names.\r\n" \
+	"  import static void ClearCache();                                                 // $AUTOCOMPLETESTATICONLY$\r\n" \
 	"  \r\n" \
 	"  import attribute int Port;\r\n" \
 	"  import attribute String Address;\r\n" \
 	"  import attribute String IP;\r\n" \
+	"  /// Whether the address has been resolved yet. (see CreateFromStringAsync)\r\n" \
+	"  readonly import attribute SockAddrStatus Status;\r\n" \
+	"  \r\n" \
+	"  /// Returns whether both addresses refer to the same host and port.\r\n" \
+	"  import bool Equals(SockAddr *other);\r\n" \
+	"  /// Returns a number that is the same for equal addresses. (never negative)\r\n" \
+	"  import int Hash();\r\n" \
 	"  \r\n" \
 	"  /// Returns a SockData object that contains the raw data of the socket address. (advanced)\r\n" \
 	"  import SockData *GetData();\r\n" \
@@ -77,16 +122,24 @@ SockData *SockAddr_GetData(SockAddr *);
 	"\r\n"
 
 #define SOCKADDR_ENTRY  	                     \
-	AGS_CLASS (SockAddr)                         \
-	AGS_METHOD(SockAddr, Create, 1)              \
-	AGS_METHOD(SockAddr, CreateFromString, 2)    \
-	AGS_METHOD(SockAddr, CreateFromData, 1)      \
-	AGS_METHOD(SockAddr, CreateIP, 2)            \
-	AGS_METHOD(SockAddr, CreateIPv6, 2)          \
-	AGS_MEMBER(SockAddr, Port)                   \
-	AGS_MEMBER(SockAddr, Address)                \
-	AGS_MEMBER(SockAddr, IP)                     \
-	AGS_METHOD(SockAddr, GetData, 0)
+	AGS_CLASS   (SockAddr)                       \
+	AGS_METHOD  (SockAddr, Create, 1)            \
+	AGS_METHOD  (SockAddr, CreateFromString, 2)  \
+	AGS_METHOD  (SockAddr, CreateFromStringAsync, 2) \
+	AGS_METHOD  (SockAddr, CreateFromData, 1)    \
+	AGS_METHOD  (SockAddr, CreateIP, 2)          \
+	AGS_METHOD  (SockAddr, CreateIPv6, 2)        \
+	AGS_METHOD  (SockAddr, CreateLocal, 1)       \
+	AGS_METHOD  (SockAddr, SetHostOverride, 2)   \
+	AGS_METHOD  (SockAddr, SetCacheTime, 2)      \
+	AGS_METHOD  (SockAddr, ClearCache, 0)        \
+	AGS_MEMBER  (SockAddr, Port)                 \
+	AGS_MEMBER  (SockAddr, Address)              \
+	AGS_MEMBER  (SockAddr, IP)                   \
+	AGS_READONLY(SockAddr, Status)               \
+	AGS_METHOD  (SockAddr, Equals, 1)            \
+	AGS_METHOD  (SockAddr, Hash, 0)              \
+	AGS_METHOD  (SockAddr, GetData, 0)
 
 //------------------------------------------------------------------------------
 
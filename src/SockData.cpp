@@ -2,11 +2,24 @@
  * Socket data interface -- See header file for more information. *
  ******************************************************************/
 
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
 #include "API.h"
+#include "Codec.h"
+#include "Compress.h"
 #include "SockData.h"
 
 namespace AGSSock {
 
+using AGSSockAPI::MappedFile;
+using AGSSockAPI::replace_file;
+
+// Registered preset compression dictionaries, zero means: no dictionary
+std::unordered_map<ags_t, std::unique_ptr<Dictionary>> dictionaries;
+
 //------------------------------------------------------------------------------
 
 int AGSSockData::Dispose(const char *data, bool force)
@@ -19,7 +32,10 @@ int AGSSockData::Dispose(const char *data, bool force)
 
 int AGSSockData::Serialize(const char *data, char *buffer, int size)
 {
-	return ((SockData *) data)->data.copy(buffer, size);
+	const SockData *sd = (const SockData *) data;
+	size_t count = MIN(sd->size(), (size_t) size);
+	memcpy(buffer, sd->bytes(), count);
+	return count;
 }
 
 //------------------------------------------------------------------------------
@@ -59,36 +75,52 @@ SockData *SockData_CreateFromString(const char *str)
 
 //------------------------------------------------------------------------------
 
+SockData *SockData_CreateFromFile(const char *path, ags_t offset, ags_t length)
+{
+	std::shared_ptr<MappedFile> file(new MappedFile(path, offset, length));
+	if (!file->valid())
+		return nullptr;
+
+	SockData *data = new SockData();
+	AGS_OBJECT(SockData, data);
+	data->file = file;
+	return data;
+}
+
+//------------------------------------------------------------------------------
+
 ags_t SockData_get_Size(SockData *sd)
 {
-	return sd->data.size();
+	return sd->size();
 }
 
 //------------------------------------------------------------------------------
 
 void SockData_set_Size(SockData *sd, ags_t size)
 {
-	sd->data.resize((size_t) size);
+	sd->modify().resize((size_t) size);
 }
 
 //------------------------------------------------------------------------------
 
 ags_t SockData_geti_Chars(SockData *sd, ags_t index)
 {
-	return sd->data[index];
+	return sd->bytes()[index];
 }
 
 //------------------------------------------------------------------------------
 
 void SockData_seti_Chars(SockData *sd, ags_t index, ags_t byte)
 {
-	sd->data[index] = (char) byte;
+	sd->modify()[index] = (char) byte;
 }
 
 //------------------------------------------------------------------------------
 
 const char *SockData_AsString(SockData *sd)
 {
+	if (sd->file) // Mapped data is not null terminated
+		return AGS_STRING(std::string(sd->bytes(), sd->size()).c_str());
 	return AGS_STRING(sd->data.c_str());
 }
 
@@ -96,11 +128,187 @@ const char *SockData_AsString(SockData *sd)
 
 void SockData_Clear(SockData *sd)
 {
+	sd->file.reset();
 	sd->data.clear();
 }
 
 //------------------------------------------------------------------------------
 
+// The data may be mapped from the very file it is written to, which must not
+// be emptied while it is read: the data goes to another file first, which then
+// takes the place of the old one.
+
+ags_t SockData_WriteToFile(SockData *sd, const char *path)
+{
+	std::string part = std::string(path) + ".part";
+	FILE *file = fopen(part.c_str(), "wb");
+	if (file == nullptr)
+		return 0;
+
+	bool success = fwrite(sd->bytes(), 1, sd->size(), file) == sd->size();
+	success = (fclose(file) == 0) && success
+		&& replace_file(part.c_str(), path);
+	if (!success)
+		remove(part.c_str());
+	return success;
+}
+
+//==============================================================================
+
+const char *SockData_ToBase64(SockData *sd)
+{
+	std::string str;
+	base64_encode(sd->bytes(), sd->size(), str);
+	return AGS_STRING(str.c_str());
+}
+
+//------------------------------------------------------------------------------
+
+SockData *SockData_FromBase64(const char *str)
+{
+	SockData *data = new SockData();
+	if (!base64_decode(str, strlen(str), data->data))
+	{
+		delete data;
+		return nullptr;
+	}
+	AGS_OBJECT(SockData, data);
+	return data;
+}
+
+//------------------------------------------------------------------------------
+
+const char *SockData_ToHex(SockData *sd)
+{
+	std::string str;
+	hex_encode(sd->bytes(), sd->size(), str);
+	return AGS_STRING(str.c_str());
+}
+
+//------------------------------------------------------------------------------
+
+SockData *SockData_FromHex(const char *str)
+{
+	SockData *data = new SockData();
+	if (!hex_decode(str, strlen(str), data->data))
+	{
+		delete data;
+		return nullptr;
+	}
+	AGS_OBJECT(SockData, data);
+	return data;
+}
+
+//==============================================================================
+
+void SockData_RegisterDictionary(ags_t id, const SockData *sd)
+{
+	if (id == 0)
+		return;
+
+	if (sd == nullptr)
+		dictionaries.erase(id);
+	else
+		dictionaries[id].reset(new Dictionary(sd->bytes(), sd->size()));
+}
+
+//------------------------------------------------------------------------------
+
+// Finds a dictionary by id; sets found to false if it does not exist
+inline const Dictionary *find_dictionary(ags_t id, bool &found)
+{
+	found = true;
+	if (id == 0)
+		return nullptr;
+
+	auto it = dictionaries.find(id);
+	if (it == dictionaries.end())
+	{
+		found = false;
+		return nullptr;
+	}
+	return it->second.get();
+}
+
+//------------------------------------------------------------------------------
+// Compressed data starts with the decompressed size so that decompression can
+// allocate exactly once and reject corrupted data early on.
+
+SockData *SockData_Compress(SockData *sd, ags_t id)
+{
+	bool found;
+	const Dictionary *dict = find_dictionary(id, found);
+	if (!found)
+		return nullptr;
+
+	SockData *data = new SockData();
+	AGS_OBJECT(SockData, data);
+	varint_encode(sd->size(), data->data);
+	compress(sd->bytes(), sd->size(), data->data, dict);
+	return data;
+}
+
+//------------------------------------------------------------------------------
+
+SockData *SockData_Decompress(SockData *sd, ags_t id)
+{
+	bool found;
+	const Dictionary *dict = find_dictionary(id, found);
+	if (!found)
+		return nullptr;
+
+	size_t pos = 0;
+	std::uint64_t size;
+	if (!varint_decode(sd->bytes(), sd->size(), pos, size)
+		|| size > decompress_bound(sd->size() - pos))
+		return nullptr;
+
+	SockData *data = new SockData();
+	if (!decompress(sd->bytes() + pos, sd->size() - pos, size,
+		data->data, dict))
+	{
+		delete data;
+		return nullptr;
+	}
+	AGS_OBJECT(SockData, data);
+	return data;
+}
+
+//==============================================================================
+// A missing previous or base object is treated as empty data
+
+SockData *SockData_Delta(SockData *sd, const SockData *previous)
+{
+	static const SockData empty;
+	const SockData &base = previous ? *previous : empty;
+
+	SockData *data = new SockData();
+	AGS_OBJECT(SockData, data);
+	delta_encode(base.bytes(), base.size(), sd->bytes(), sd->size(),
+		data->data);
+	return data;
+}
+
+//------------------------------------------------------------------------------
+
+SockData *SockData_ApplyDelta(SockData *sd, const SockData *base)
+{
+	static const SockData empty;
+	const SockData &prev = base ? *base : empty;
+
+	SockData *data = new SockData();
+	if (!delta_decode(prev.bytes(), prev.size(), sd->bytes(), sd->size(),
+		data->data))
+	{
+		delete data;
+		return nullptr;
+	}
+	AGS_OBJECT(SockData, data);
+	return data;
+}
+
+//------------------------------------------------------------------------------
+
 } /* namespace AGSSock */
 
 //..............................................................................
@@ -12,6 +12,7 @@
 #ifndef _SOCKDATA_H
 #define _SOCKDATA_H
 
+#include <memory>
 #include <string>
 
 namespace AGSSock {
@@ -21,6 +22,8 @@ namespace AGSSock {
 struct SockData
 {
 	std::string data; //!< internal data representation
+	//! read-only file mapping that replaces data while present
+	std::shared_ptr<AGSSockAPI::MappedFile> file;
 	
 	//! Creates an empty data object
 	SockData() {}
@@ -28,6 +31,22 @@ struct SockData
 	SockData(size_t size, char c = '\0') : data(std::string(size, c)) {}
 	//! Creates a data object from a string object
 	SockData(const std::string &D) : data(D) {}
+	
+	//! The bytes of the data object, whether mapped or not
+	const char *bytes() const { return file ? file->data() : data.data(); }
+	//! The size of the data object, whether mapped or not
+	size_t size() const { return file ? file->size() : data.size(); }
+	
+	//! Returns the data for modification, copying mapped data into memory first
+	std::string &modify()
+	{
+		if (file)
+		{
+			data.assign(file->data(), file->size());
+			file.reset();
+		}
+		return data;
+	}
 };
 
 AGS_DEFINE_CLASS(SockData)
@@ -37,6 +56,7 @@ AGS_DEFINE_CLASS(SockData)
 SockData *SockData_Create(ags_t, ags_t);
 SockData *SockData_CreateEmpty();
 SockData *SockData_CreateFromString(const char *);
+SockData *SockData_CreateFromFile(const char *, ags_t offset, ags_t length);
 
 ags_t SockData_get_Size(SockData *);
 void SockData_set_Size(SockData *, ags_t);
@@ -47,6 +67,19 @@ void SockData_seti_Chars(SockData *, ags_t, ags_t);
 
 const char *SockData_AsString(SockData *);
 void SockData_Clear(SockData *);
+ags_t SockData_WriteToFile(SockData *, const char *);
+
+const char *SockData_ToBase64(SockData *);
+SockData *SockData_FromBase64(const char *);
+const char *SockData_ToHex(SockData *);
+SockData *SockData_FromHex(const char *);
+
+void SockData_RegisterDictionary(ags_t id, const SockData *);
+SockData *SockData_Compress(SockData *, ags_t dictionary);
+SockData *SockData_Decompress(SockData *, ags_t dictionary);
+
+SockData *SockData_Delta(SockData *, const SockData *previous);
+SockData *SockData_ApplyDelta(SockData *, const SockData *base);
 
 //------------------------------------------------------------------------------
 
@@ -64,6 +97,14 @@ void SockData_Clear(SockData *);
 	"  import static SockData *CreateEmpty();                      // $AUTOCOMPLETESTATICONLY$\r\n" \
 	"  /// Creates a data container from a string.\r\n" \
 	"  import static SockData *CreateFromString(const string str); // $AUTOCOMPLETESTATICONLY$\r\n" \
+	"  /// Creates a data container that maps (part of) a file into memory, loading it as needed. Returns null if the file cannot be read.\r\n" \
+	"  import static SockData *CreateFromFile(const string path, int offset = 0, int length = -1); // $AUTOCOMPLETESTATICONLY$\r\n" \
+	"  /// Creates a data container from a Base64 encoded string. Returns null if the string is not valid Base64.\r\n" \
+	"  import static SockData *FromBase64(const string str);       // $AUTOCOMPLETESTATICONLY$\r\n" \
+	"  /// Creates a data container from a hexadecimal string. Returns null if the string is not valid hexadecimal.\r\n" \
+	"  import static SockData *FromHex(const string str);          // $AUTOCOMPLETESTATICONLY$\r\n" \
+	"  /// Registers a preset compression dictionary under a (non-zero) number. Both parties should register the same dictionary.\r\n" \
+	"  import static void RegisterDictionary(int id, SockData *dictionary); // $AUTOCOMPLETESTATICONLY$\r\n" \
 	"  \r\n" \
 	"  import attribute int Size;\r\n" \
 	"  import attribute char Chars[];\r\n" \
@@ -72,6 +113,20 @@ void SockData_Clear(SockData *);
 	"  import String AsString();\r\n" \
 	"  /// Removes all the data from a socket data object, reducing its size to zero.\r\n" \
 	"  import void Clear();\r\n" \
+	"  /// Writes the data to a file, replacing its content. Returns whether it succeeded.\r\n" \
+	"  import bool WriteToFile(const string path);\r\n" \
+	"  /// Returns the data encoded as a Base64 string. (safe for null characters)\r\n" \
+	"  import String ToBase64();\r\n" \
+	"  /// Returns the data encoded as a hexadecimal string. (safe for null characters)\r\n" \
+	"  import String ToHex();\r\n" \
+	"  /// Returns a compressed copy of the data, optionally using a registered dictionary.\r\n" \
+	"  import SockData *Compress(int dictionary = 0);\r\n" \
+	"  /// Returns a decompressed copy of compressed data. Returns null if the data is corrupt or the dictionary does not exist.\r\n" \
+	"  import SockData *Decompress(int dictionary = 0);\r\n" \
+	"  /// Returns the changes with respect to previous data, which is small when little has changed.\r\n" \
+	"  import SockData *Delta(SockData *previous);\r\n" \
+	"  /// Returns the data a delta was made from, given the same previous data. Returns null if the delta is corrupt.\r\n" \
+	"  import SockData *ApplyDelta(SockData *base);\r\n" \
 	"};\r\n" \
 	"\r\n"
 
@@ -80,10 +135,21 @@ void SockData_Clear(SockData *);
 	AGS_METHOD(SockData, Create, 2)              \
 	AGS_METHOD(SockData, CreateEmpty, 0)         \
 	AGS_METHOD(SockData, CreateFromString, 1)    \
+	AGS_METHOD(SockData, CreateFromFile, 3)      \
 	AGS_MEMBER(SockData, Size)                   \
 	AGS_ARRAY (SockData, Chars)                  \
 	AGS_METHOD(SockData, AsString, 0)            \
-	AGS_METHOD(SockData, Clear, 0)
+	AGS_METHOD(SockData, Clear, 0)               \
+	AGS_METHOD(SockData, WriteToFile, 1)         \
+	AGS_METHOD(SockData, ToBase64, 0)            \
+	AGS_METHOD(SockData, FromBase64, 1)          \
+	AGS_METHOD(SockData, ToHex, 0)               \
+	AGS_METHOD(SockData, FromHex, 1)             \
+	AGS_METHOD(SockData, RegisterDictionary, 2)  \
+	AGS_METHOD(SockData, Compress, 1)            \
+	AGS_METHOD(SockData, Decompress, 1)          \
+	AGS_METHOD(SockData, Delta, 1)               \
+	AGS_METHOD(SockData, ApplyDelta, 1)
 
 //------------------------------------------------------------------------------
 
@@ -0,0 +1,182 @@
+/*********************************************************************
+ * Socket session interface -- See header file for more information. *
+ *********************************************************************/
+
+#include <cstring>
+
+#include "SockSession.h"
+
+using namespace AGSSockAPI;
+
+namespace AGSSock {
+
+const size_t SockSession::COUNTER_SIZE;
+const size_t SockSession::OVERHEAD;
+const int SockSession::WINDOW;
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+void make_nonce(std::uint32_t side, std::uint64_t counter,
+	std::uint8_t nonce[CRYPTO_NONCE_SIZE])
+{
+	for (int i = 0; i < 4; ++i)
+		nonce[i] = (std::uint8_t) (side >> (8 * i));
+	for (int i = 0; i < 8; ++i)
+		nonce[4 + i] = (std::uint8_t) (counter >> (8 * i));
+}
+
+} /* namespace */
+
+//------------------------------------------------------------------------------
+
+SockSession::SockSession(const char *key, bool server) : valid(true),
+	side(server ? 1 : 0), sealed(0), newest(0), opened(0)
+{
+	memcpy(this->key, key, sizeof (this->key));
+}
+
+//------------------------------------------------------------------------------
+// Written through a volatile pointer so the compiler cannot leave it out
+
+SockSession::~SockSession()
+{
+	volatile std::uint8_t *bytes = key;
+	for (size_t i = 0; i < sizeof (key); ++i)
+		bytes[i] = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void SockSession::seal(const char *buf, size_t count, std::string &out)
+{
+	std::uint8_t nonce[CRYPTO_NONCE_SIZE];
+	make_nonce(side, sealed, nonce);
+	sealed++;
+
+	out.resize(OVERHEAD + count);
+	char *data = &out[0];
+	memcpy(data, nonce + 4, COUNTER_SIZE);
+	aead_seal(key, nonce, nullptr, 0, buf, count, data + COUNTER_SIZE,
+		reinterpret_cast<std::uint8_t *> (data + COUNTER_SIZE + count));
+}
+
+//------------------------------------------------------------------------------
+// The replay window is checked before and updated after authentication: a
+// forged counter cannot move it.
+
+bool SockSession::open(const char *buf, size_t count, std::string &out)
+{
+	if (count < OVERHEAD)
+		return false;
+
+	std::uint64_t counter = 0;
+	for (int i = 0; i < 8; ++i)
+		counter |= (std::uint64_t) (std::uint8_t) buf[i] << (8 * i);
+
+	std::uint64_t age = newest - counter;
+	bool fresh = !opened || counter > newest;
+	if (!fresh && (age >= (std::uint64_t) WINDOW || (opened >> age) & 1))
+		return false;
+
+	std::uint8_t nonce[CRYPTO_NONCE_SIZE];
+	make_nonce(!side, counter, nonce);
+
+	count -= OVERHEAD;
+	out.resize(count);
+	const char *cipher = buf + COUNTER_SIZE;
+	if (!aead_open(key, nonce, nullptr, 0, cipher, count, &out[0],
+		reinterpret_cast<const std::uint8_t *> (cipher + count)))
+		return false;
+
+	if (!fresh)
+		opened |= (std::uint64_t) 1 << age;
+	else
+	{
+		std::uint64_t shift = opened ? counter - newest : WINDOW;
+		opened = (shift >= (std::uint64_t) WINDOW ? 0 : opened << shift) | 1;
+		newest = counter;
+	}
+	return true;
+}
+
+//==============================================================================
+
+int AGSSockSession::Dispose(const char *ptr, bool force)
+{
+	delete (SockSession *) ptr;
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+// Note: the key is not written to saved games, and continuing the counter from
+// an older save would reuse nonces; the session comes back invalid.
+
+int AGSSockSession::Serialize(const char *ptr, char *buffer, int size)
+{
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+
+void AGSSockSession::Unserialize(int key, const char *buffer, int size)
+{
+	AGS_RESTORE(SockSession, new SockSession(), key);
+}
+
+//==============================================================================
+
+SockSession *SockSession_Create(const SockData *key, ags_t server)
+{
+	if (key == nullptr || key->size() != CRYPTO_KEY_SIZE)
+		return nullptr;
+
+	SockSession *session = new SockSession(key->bytes(), server != 0);
+	AGS_OBJECT(SockSession, session);
+	return session;
+}
+
+//------------------------------------------------------------------------------
+
+ags_t SockSession_get_Valid(SockSession *session)
+{
+	return session->valid ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
+
+SockData *SockSession_Seal(SockSession *session, const SockData *data)
+{
+	if (!session->valid || data == nullptr)
+		return nullptr;
+
+	SockData *sealed = new SockData();
+	AGS_OBJECT(SockData, sealed);
+	session->seal(data->bytes(), data->size(), sealed->data);
+	return sealed;
+}
+
+//------------------------------------------------------------------------------
+
+SockData *SockSession_Open(SockSession *session, const SockData *data)
+{
+	if (!session->valid || data == nullptr)
+		return nullptr;
+
+	SockData *opened = new SockData();
+	if (!session->open(data->bytes(), data->size(), opened->data))
+	{
+		delete opened;
+		return nullptr;
+	}
+
+	AGS_OBJECT(SockData, opened);
+	return opened;
+}
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+//..............................................................................
@@ -0,0 +1,101 @@
+/*******************************************************
+ * Socket session interface -- header file             *
+ *                                                     *
+ * Author: Ferry "Wyz" Timmers                         *
+ *                                                     *
+ * Date: 16:30 2026-10-18                              *
+ *                                                     *
+ * Description: Seals data for one other party with a  *
+ *              shared key, so that it cannot be read, *
+ *              changed or replayed on the way.        *
+ *******************************************************/
+
+#ifndef _SOCKSESSION_H
+#define _SOCKSESSION_H
+
+#include <cstdint>
+#include <string>
+
+#include "API.h"
+#include "Crypto.h"
+#include "SockData.h"
+
+namespace AGSSock {
+
+//------------------------------------------------------------------------------
+
+//! ChaCha20-Poly1305 with a message counter as nonce
+
+//! Sealed data is the counter (64 bits, little endian), the encrypted data and
+//! the tag. The nonce is the side that sealed it (32 bits) followed by the
+//! counter, so the two parties never use the same nonce with their shared key.
+//! Counters that were opened already, or that are more than a window older
+//! than the newest one, are refused: datagrams can be reordered, not replayed.
+struct SockSession
+{
+	static const size_t COUNTER_SIZE = 8;
+	static const size_t OVERHEAD = COUNTER_SIZE + CRYPTO_TAG_SIZE;
+	static const int WINDOW = 64;
+
+	std::uint8_t key[CRYPTO_KEY_SIZE];
+	bool valid;
+	std::uint32_t side;   // 0 for the client, 1 for the server
+	std::uint64_t sealed; // Counter of the next data to seal
+	std::uint64_t newest; // Newest counter opened
+	std::uint64_t opened; // Bit n: newest - n was opened
+
+	SockSession() : key(), valid(false), side(0), sealed(0), newest(0),
+		opened(0) {} //!< Cannot seal or open anything
+	SockSession(const char *key, bool server);
+	~SockSession(); //!< Wipes the key
+
+	void seal(const char *buf, size_t count, std::string &out);
+	//! \returns false if the data is not authentic or was opened before
+	bool open(const char *buf, size_t count, std::string &out);
+};
+
+AGS_DEFINE_CLASS(SockSession)
+
+//------------------------------------------------------------------------------
+
+SockSession *SockSession_Create(const SockData *key, ags_t server);
+
+ags_t SockSession_get_Valid(SockSession *);
+SockData *SockSession_Seal(SockSession *, const SockData *);
+SockData *SockSession_Open(SockSession *, const SockData *);
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+//------------------------------------------------------------------------------
+//                           Plugin interface
+
+#define SOCKSESSION_HEADER \
+	"\r\n" \
+	"managed struct SockSession\r\n" \
+	"{\r\n" \
+	"	/// Starts sealing data with a 32 byte key both parties share; one of them is the server. Returns null if the key is not 32 bytes.\r\n" \
+	"	import static SockSession *Create(SockData *key, bool server = false); // $AUTOCOMPLETESTATICONLY$\r\n" \
+	"	\r\n" \
+	"	/// Whether the session can be used. (not after restoring a saved game)\r\n" \
+	"	readonly import attribute bool Valid;\r\n" \
+	"	\r\n" \
+	"	/// Returns the data encrypted and signed for the other party. (24 bytes larger)\r\n" \
+	"	import SockData *Seal(SockData *data);\r\n" \
+	"	/// Returns the data the other party sealed. Returns null if it was changed, sealed by this side or opened before.\r\n" \
+	"	import SockData *Open(SockData *data);\r\n" \
+	"};\r\n"
+
+#define SOCKSESSION_ENTRY	                     \
+	AGS_CLASS   (SockSession)                    \
+	AGS_METHOD  (SockSession, Create, 2)         \
+	AGS_READONLY(SockSession, Valid)             \
+	AGS_METHOD  (SockSession, Seal, 1)           \
+	AGS_METHOD  (SockSession, Open, 1)
+
+//------------------------------------------------------------------------------
+
+#endif /* _SOCKSESSION_H */
+
+//..............................................................................
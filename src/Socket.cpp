@@ -4,8 +4,11 @@
 
 #include <cstdint>
 #include <cstring>
+#include <unordered_set>
+#include <utility>
 
 #include "Pool.h"
+#include "Resolver.h"
 #include "Socket.h"
 
 namespace AGSSock {
@@ -19,9 +22,14 @@ using std::int32_t;
 
 Pool *pool;
 
+// Sockets that send their batch at the end of every frame
+std::unordered_set<Socket *> auto_flushed;
+bool frame_hooked = false;
+
 void Initialize()
 {
 	pool = new Pool();
+	resolver = new Resolver();
 }
 
 void Terminate()
@@ -33,6 +41,12 @@ void Terminate()
 	
 	delete pool;
 	pool = nullptr;
+	
+	delete resolver;
+	resolver = nullptr;
+	
+	auto_flushed.clear();
+	frame_hooked = false; // The next engine has to be asked again
 }
 
 inline void CheckPoolInvariant()
@@ -48,13 +62,9 @@ int AGSSocket::Dispose(const char *ptr, bool force)
 {
 	Socket *sock = (Socket *) ptr;
 	
-	if (sock->id != SOCKET_ERROR)
-	{
-		// Invalidate socket, forced close.
-		pool->remove(sock);
-		closesocket(sock->id);
-		sock->id = SOCKET_ERROR;
-	}
+	if (sock->connector)
+		sock->connector->cancel();
+	auto_flushed.erase(sock);
 	
 	if (sock->local != nullptr)
 	{
@@ -67,7 +77,26 @@ int AGSSocket::Dispose(const char *ptr, bool force)
 		AGS_RELEASE(sock->remote);
 		sock->remote = nullptr;
 	}
-
+	
+	if (sock->pair != nullptr)
+	{
+		AGS_RELEASE(sock->pair);
+		sock->pair = nullptr;
+	}
+	
+	// A connection that is closing is finished and then deleted by the pool,
+	// which may happen right away: the socket must not be touched after this.
+	if (pool->orphan(sock))
+		return 1;
+	
+	if (sock->id != SOCKET_ERROR)
+	{
+		// Invalidate socket, forced close.
+		pool->remove(sock);
+		closesocket(sock->id);
+		sock->id = SOCKET_ERROR;
+	}
+	
 	delete sock;
 	return 1;
 }
@@ -130,18 +159,16 @@ void AGSSocket::Unserialize(int key, const char *buffer, int length)
 		AGS_FROM_KEY(SockAddr, serial.remote),
 		tag
 	};
+	sock->linger = Socket::DEFAULT_LINGER;
 	
 	AGS_RESTORE(Socket, sock, key);
 }
 
 //==============================================================================
 
-Socket *Socket_Create(ags_t domain, ags_t type, ags_t protocol)
+inline Socket *socket_object(SOCKET id, int domain, int type, int protocol,
+	int error)
 {
-	RESET_ERROR(); // Bug: errno is sometimes not reset on Linux
-	SOCKET id = socket(domain, type, protocol);
-	ags_t error = GET_ERROR();
-
 	// The entire plugin is nonblocking except for:
 	//     1. connections in sync mode (async = false)
 	//     2. address lookups
@@ -150,15 +177,27 @@ Socket *Socket_Create(ags_t domain, ags_t type, ags_t protocol)
 	Socket *sock = new Socket
 	{
 		id,
-		(int) domain, (int) type, (int) protocol,
-		(int) error,
+		domain, type, protocol,
+		error,
 		nullptr, nullptr
 	};
+	sock->linger = Socket::DEFAULT_LINGER;
 	AGS_OBJECT(Socket, sock);
 	
 	return sock;
 }
 
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
+
+Socket *Socket_Create(ags_t domain, ags_t type, ags_t protocol)
+{
+	RESET_ERROR(); // Bug: errno is sometimes not reset on Linux
+	SOCKET id = socket(domain, type, protocol);
+	ags_t error = GET_ERROR();
+
+	return socket_object(id, domain, type, protocol, error);
+}
+
 //------------------------------------------------------------------------------
 
 Socket *Socket_CreateUDP()
@@ -187,6 +226,39 @@ Socket *Socket_CreateTCPv6()
 	return Socket_Create(AF_INET6, SOCK_STREAM, IPPROTO_TCP);
 }
 
+//------------------------------------------------------------------------------
+
+Socket *Socket_CreateLocal(ags_t datagram)
+{
+	return Socket_Create(AF_UNIX, datagram ? SOCK_DGRAM : SOCK_STREAM, 0);
+}
+
+//------------------------------------------------------------------------------
+// Both ends are connected from the start, so they go straight into the pool.
+// The first end holds the second one, which the game finds in its Pair.
+
+Socket *Socket_CreatePair(ags_t datagram)
+{
+	int type = datagram ? SOCK_DGRAM : SOCK_STREAM;
+	SOCKET ids[2] = {INVALID_SOCKET, INVALID_SOCKET};
+	
+	RESET_ERROR();
+	int error = socket_pair(type, ids) == SOCKET_ERROR ? GET_ERROR() : 0;
+	
+	Socket *first = socket_object(ids[0], AF_UNIX, type, 0, error);
+	Socket *second = socket_object(ids[1], AF_UNIX, type, 0, error);
+	first->pair = second;
+	AGS_HOLD(second);
+	
+	if (!error)
+	{
+		pool->add(first);
+		pool->add(second);
+		CheckPoolInvariant();
+	}
+	return first;
+}
+
 //==============================================================================
 
 ags_t Socket_get_Valid(Socket *sock)
@@ -196,6 +268,13 @@ ags_t Socket_get_Valid(Socket *sock)
 
 //------------------------------------------------------------------------------
 
+Socket *Socket_get_Pair(Socket *sock)
+{
+	return sock->pair;
+}
+
+//------------------------------------------------------------------------------
+
 const char *Socket_get_Tag(Socket *sock)
 {
 	return AGS_STRING(sock->tag.c_str());
@@ -268,6 +347,104 @@ const char *Socket_ErrorString(Socket *sock)
 	return AGSFormatError(sock->error);
 }
 
+//------------------------------------------------------------------------------
+
+ags_t Socket_get_Compression(Socket *sock)
+{
+	return (sock->deflate ? 1 : 0);
+}
+
+//------------------------------------------------------------------------------
+// Note: compression is a property of the stream, enabling it halfway will
+// confuse the other party. The pool decompresses incoming data so we have to
+// lock it.
+
+void Socket_set_Compression(Socket *sock, ags_t enable)
+{
+	if (sock->type != SOCK_STREAM)
+		return;
+
+	Mutex::Lock lock(*pool);
+
+	if (!enable)
+	{
+		sock->deflate.reset();
+		sock->inflate.reset();
+	}
+	else if (!sock->deflate)
+	{
+		sock->deflate.reset(new StreamCompressor());
+		sock->inflate.reset(new StreamDecompressor());
+	}
+}
+
+//------------------------------------------------------------------------------
+
+ags_t Socket_get_Linger(Socket *sock)
+{
+	return sock->linger;
+}
+
+//------------------------------------------------------------------------------
+
+void Socket_set_Linger(Socket *sock, ags_t linger)
+{
+	Mutex::Lock lock(*pool);
+	
+	sock->linger = linger < 0 ? 0 : linger;
+}
+
+//------------------------------------------------------------------------------
+
+ags_t Socket_get_Reliable(Socket *sock)
+{
+	return sock->reliable ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
+// Note: the pool reads and resends through the layer so we have to lock it.
+// Disabling it forgets what was not acknowledged yet.
+
+void Socket_set_Reliable(Socket *sock, ags_t enable)
+{
+	if (sock->type != SOCK_DGRAM)
+	{
+		sock->error = NOT_SUPPORTED;
+		return;
+	}
+	
+	Mutex::Lock lock(*pool);
+	
+	if (!enable)
+		sock->reliable.reset();
+	else if (!sock->reliable)
+		sock->reliable.reset(new Reliable());
+	sock->error = 0;
+}
+
+//------------------------------------------------------------------------------
+
+static_assert(AGSSOCK_DELIVERY_RELIABLE_ORDERED == Reliable::ORDERED
+	&& AGSSOCK_DELIVERY_RELIABLE == Reliable::RELIABLE
+	&& AGSSOCK_DELIVERY_SEQUENCED == Reliable::SEQUENCED
+	&& AGSSOCK_DELIVERY_UNRELIABLE == Reliable::UNRELIABLE,
+	"delivery constants differ from the layer");
+
+ags_t Socket_SetDelivery(Socket *sock, ags_t delivery, ags_t channel)
+{
+	if (delivery < 0 || delivery >= Reliable::DELIVERIES
+		|| channel < 0 || channel >= Reliable::CHANNELS)
+	{
+		sock->error = INVALID_ARGUMENT;
+		return 0;
+	}
+	
+	sock->delivery = delivery;
+	sock->channel = channel;
+	sock->error = 0;
+	return 1;
+}
+
 //==============================================================================
 
 ags_t Socket_Bind(Socket *sock, const SockAddr *addr)
@@ -277,8 +454,8 @@ ags_t Socket_Bind(Socket *sock, const SockAddr *addr)
 	if (sock->local != nullptr)
 		Socket_update_Local(sock);
 
-	// Faux connection UDP support
-	if (ret != SOCKET_ERROR && sock->protocol == IPPROTO_UDP)
+	// Faux connection UDP support (and other datagram sockets)
+	if (ret != SOCKET_ERROR && sock->type == SOCK_DGRAM)
 	{
 		pool->add(sock);
 		CheckPoolInvariant();
@@ -301,22 +478,43 @@ ags_t Socket_Listen(Socket *sock, ags_t backlog)
 // This will also work for UDP since Berkeley sockets fake a connection for UDP
 // by binding a remote address to the socket. We will complete this illusion by
 // adding the socket to the pool.
+// In sync mode the connection is awaited for at most the timeout (zero waits as
+// long as the system does). On timeout the attempt continues: connecting again
+// in async mode tells if it succeeded after all.
 
-ags_t Socket_Connect(Socket *sock, const SockAddr *addr, ags_t async)
+ags_t Socket_Connect(Socket *sock, const SockAddr *addr, ags_t async,
+	ags_t timeout)
 {
-	int ret;
+	int ret = connect(sock->id, CONST_ADDR(addr), ADDR_SIZE(addr));
+	sock->error = GET_ERROR();
 	
-	if (!async) // Sync mode: do a blocking connect
+	if (!async && ret == SOCKET_ERROR && ALREADY(sock->error))
 	{
-		setblocking(sock->id, true);
-		ret = connect(sock->id, CONST_ADDR(addr), ADDR_SIZE(addr));
-		setblocking(sock->id, false);
+		// Sync mode: wait for the connection to be made or to fail
+		fd_set write, except;
+		FD_ZERO(&write);
+		FD_ZERO(&except);
+		FD_SET(sock->id, &write);
+		FD_SET(sock->id, &except);
+		timeval limit = {(long) (timeout / 1000), (long) (timeout % 1000) * 1000};
+		
+		int count = select(sock->id + 1, nullptr, &write, &except,
+			timeout > 0 ? &limit : nullptr);
+		if (count > 0)
+		{
+			int error = 0;
+			ADDRLEN size = sizeof (error);
+			if (getsockopt(sock->id, SOL_SOCKET, SO_ERROR,
+				reinterpret_cast<char *> (&error), &size))
+				error = GET_ERROR();
+			sock->error = error;
+			ret = error ? SOCKET_ERROR : 0;
+		}
+		else
+			sock->error = count == 0 ? TIMED_OUT : GET_ERROR();
 	}
-	else
-		ret = connect(sock->id, CONST_ADDR(addr), ADDR_SIZE(addr));
 	
 	// In async mode: returning false but with error == 0 is: try again
-	sock->error = GET_ERROR();
 	if (ALREADY(sock->error)) // If already trying to connect
 		sock->error = 0;
 
@@ -340,6 +538,100 @@ ags_t Socket_Connect(Socket *sock, const SockAddr *addr, ags_t async)
 	return (ret == SOCKET_ERROR ? 0 : 1);
 }
 
+//------------------------------------------------------------------------------
+
+ags_t Socket_Connect2(Socket *sock, const SockAddr *addr, ags_t async)
+{
+	return Socket_Connect(sock, addr, async, AGSSOCK_CONNECT_TIMEOUT);
+}
+
+//------------------------------------------------------------------------------
+
+int apply_option(SOCKET id, int domain, ags_t level, ags_t option,
+	ags_t value);
+
+// Whether the socket was bound to a local address, which gives it a port
+inline bool is_bound(const Socket *sock)
+{
+	SOCKADDR_STORAGE addr = {};
+	ADDRLEN size = sizeof (addr);
+	if (getsockname(sock->id, reinterpret_cast<sockaddr *> (&addr), &size))
+		return false;
+	if (addr.ss_family == AF_INET)
+		return reinterpret_cast<const sockaddr_in &> (addr).sin_port != 0;
+	if (addr.ss_family == AF_INET6)
+		return reinterpret_cast<const sockaddr_in6 &> (addr).sin6_port != 0;
+	return false;
+}
+
+//------------------------------------------------------------------------------
+// The race is run on its own socket descriptors; the winner replaces the one of
+// the socket, which may change its domain to that of the winning address. The
+// options the game set are applied to every attempt. A bound socket is refused:
+// its address cannot be carried over to the attempts of another domain.
+// In sync mode the race is awaited for at most the timeout, like Connect.
+
+ags_t Socket_ConnectByName(Socket *sock, const char *host, ags_t async,
+	ags_t timeout)
+{
+	if (!sock->connector)
+	{
+		if (is_bound(sock))
+		{
+			sock->error = INVALID_ARGUMENT;
+			return 0;
+		}
+		
+		Query query;
+		parse_address(host, AF_UNSPEC, query);
+		std::vector<SocketOption> options = sock->options;
+		sock->connector = std::make_shared<Connector>(query, sock->type,
+			sock->protocol, [options](SOCKET id, int domain)
+			{
+				for (const SocketOption &opt : options)
+					apply_option(id, domain, opt.level, opt.option, opt.value);
+			});
+		sock->connector->start();
+	}
+	
+	// Sync mode: wait for the race to be decided, or fail like Connect
+	if (!async && !sock->connector->wait(timeout))
+	{
+		sock->error = TIMED_OUT;
+		return 0;
+	}
+	
+	// In async mode: returning false but with error == 0 is: try again
+	if (!sock->connector->done())
+	{
+		sock->error = 0;
+		return 0;
+	}
+	
+	std::shared_ptr<Connector> connector;
+	connector.swap(sock->connector);
+	sock->error = connector->error();
+	if (sock->error)
+		return 0;
+	
+	int domain;
+	SOCKET id = connector->take(domain);
+	
+	pool->remove(sock);
+	closesocket(sock->id);
+	sock->id = id;
+	sock->domain = domain;
+	
+	if (sock->local != nullptr)
+		Socket_update_Local(sock);
+	if (sock->remote != nullptr)
+		Socket_update_Remote(sock);
+	pool->add(sock);
+	CheckPoolInvariant();
+	
+	return 1;
+}
+
 //------------------------------------------------------------------------------
 // Accept is nonblocking:
 // If it returns nullptr and the error is also 0: try again!
@@ -365,8 +657,13 @@ Socket *Socket_Accept(Socket *sock)
 		// I rather let the API re-resolve them when needed (less error prone).
 		nullptr, nullptr
 	};
+	sock2->linger = sock->linger;
 	AGS_OBJECT(Socket, sock2);
 	
+	// Accepted connections inherit the stream compression of the listener
+	if (sock->deflate)
+		Socket_set_Compression(sock2, 1);
+
 	setblocking(conn, false);
 	pool->add(sock2);
 	CheckPoolInvariant();
@@ -376,23 +673,21 @@ Socket *Socket_Accept(Socket *sock)
 
 //------------------------------------------------------------------------------
 
+// Connections are closed gracefully by the pool; this never waits. A batch
+// that is left is flushed first.
+
+inline ags_t flush_impl(Socket *sock);
+
 void Socket_Close(Socket *sock)
 {
-	if (sock->type == SOCK_STREAM)
+	sock->batching = false;
+	auto_flushed.erase(sock);
+	flush_impl(sock);
+	
+	if (sock->type == SOCK_STREAM && pool->finish(sock))
 	{
-		// Graceful shutdown, the poolthread will detect if it succeeded.
-		shutdown(sock->id, SD_SEND);
-		
-		// Wait for a response to prevent race conditions
-		fd_set read;
-		timeval timeout = {0, 500}; // Half a second fudge time
-		FD_ZERO(&read);
-		
-		FD_SET(sock->id, &read);
-		if (select(sock->id + 1, &read, nullptr, nullptr, &timeout) > 0)
-			return;
-			
-		// Select failed or timeout: we force close
+		sock->error = 0;
+		return;
 	}
 	
 	// Invalidate socket
@@ -407,79 +702,479 @@ void Socket_Close(Socket *sock)
 // Send is nonblocking:
 // If it returns 0 and the error is also 0: try again!
 
-inline ags_t send_impl(Socket *sock, const char *buf, size_t count)
+// A file that is being sent goes first: then it is always "try again". The
+// same goes for uncompressed streams while flushed data is still queued. Only
+// the pool sends these, so checking beforehand is enough.
+
+// Compressed streams cannot afford to lose part of a frame. Instead, the data
+// that is not accepted right away is queued and sent by the pool later on.
+
+inline bool sending_file(Socket *sock)
 {
-	long ret = 0;
-	
-	while (count > 0)
-	{
-		ret = send(sock->id, buf, count, 0);
-		if (ret == SOCKET_ERROR)
-			break;
-		buf += ret;
-		count -= ret;
-	}
+	Mutex::Lock lock(*pool);
 	
-	sock->error = GET_ERROR();
-	if (WOULD_BLOCK(sock->error))
-		sock->error = 0;
-
-	return (ret == SOCKET_ERROR ? 0 : 1);
+	return sock->sending.file != nullptr;
 }
 
-ags_t Socket_Send(Socket *sock, const char *str)
+inline bool send_pending(Socket *sock)
 {
-	return send_impl(sock, str, strlen(str));
+	Mutex::Lock lock(*pool);
+	
+	return sock->sending.file || (!sock->deflate && !sock->outgoing.empty());
 }
 
-ags_t Socket_SendData(Socket *sock, const SockData *data)
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
+
+inline ags_t send_queued(Socket *sock, const char *buf, size_t count)
 {
-	return send_impl(sock, data->data.data(), data->data.size());
+	bool pending;
+
+	{
+		Mutex::Lock lock(*pool);
+
+		if (sock->outgoing.empty())
+		{
+			// A peer that is gone is an error here, like in the pool, not a signal
+			long ret = send(sock->id, buf, count, MSG_NOSIGNAL);
+			sock->error = GET_ERROR();
+
+			if (ret == SOCKET_ERROR)
+			{
+				if (!WOULD_BLOCK(sock->error))
+					return 0;
+				ret = 0;
+			}
+
+			buf += ret;
+			count -= ret;
+		}
+
+		sock->error = 0;
+		sock->outgoing.append(buf, count);
+		pending = !sock->outgoing.empty();
+	}
+
+	if (pending)
+		pool->wake();
+	return 1;
 }
 
-//------------------------------------------------------------------------------
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
 
-inline ags_t sendto_impl(Socket *sock, const SockAddr *addr,
+// Messages of a reliable socket go through its layer, to the target or else
+// the connected host. A reliable message that is not accepted right away is
+// simply resent by the pool later on; only a full window says to try again.
+inline ags_t send_reliable(Socket *sock, const SockAddr *target,
 	const char *buf, size_t count)
 {
-	long ret = 0;
+	if (count > Reliable::MAX_MESSAGE)
+	{
+		sock->error = INVALID_ARGUMENT;
+		return 0;
+	}
+	
+	bool wake;
 	
-	while (count > 0)
 	{
-		ret = sendto(sock->id, buf, count, 0, CONST_ADDR(addr), ADDR_SIZE(addr));
-		if (ret == SOCKET_ERROR)
-			break;
-		buf += ret;
-		count -= ret;
+		Mutex::Lock lock(*pool);
+		
+		SOCKADDR_STORAGE peer = {};
+		ADDRLEN size = sizeof (peer);
+		if (target != nullptr)
+			memcpy(&peer, target, sizeof (peer));
+		else if (getpeername(sock->id, ADDR(&peer), &size) == SOCKET_ERROR)
+		{
+			sock->error = GET_ERROR();
+			return 0;
+		}
+		
+		Reliable::Clock::time_point now = Reliable::Clock::now();
+		Reliable::Clock::time_point deadline = sock->reliable->deadline();
+		string packet;
+		if (!sock->reliable->send(peer, sock->delivery, sock->channel, buf,
+			count, packet, now))
+		{
+			sock->error = 0;
+			return 0;
+		}
+		
+		sock->error = transmit(sock->id, peer, packet);
+		if (WOULD_BLOCK(sock->error) || (sock->error
+			&& sock->delivery <= Reliable::RELIABLE))
+			sock->error = 0;
+		wake = sock->reliable->deadline() < deadline;
 	}
 	
-	sock->error = GET_ERROR();
-	if (WOULD_BLOCK(sock->error))
-		sock->error = 0;
+	if (sock->error)
+		return 0;
 	
-	return (ret == SOCKET_ERROR ? 0 : 1);
+	// Sending binds the socket implicitly; the pool handles the replies
+	if (!pool->contains(sock))
+	{
+		pool->add(sock);
+		CheckPoolInvariant();
+	}
+	else if (wake)
+		pool->wake();
+	return 1;
 }
 
-ags_t Socket_SendTo(Socket *sock, const SockAddr *addr, const char *str)
-{
-	return sendto_impl(sock, addr, str, strlen(str));
-}
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
 
-ags_t Socket_SendDataTo(Socket *sock, const SockAddr *addr, const SockData *data)
+// Batched data is compressed right away, so the stream stays in order
+inline void batch_append(Socket *sock, const char *buf, size_t count)
 {
-	return sendto_impl(sock, addr, data->data.data(), data->data.size());
+	if (sock->deflate)
+		sock->deflate->compress(buf, count, sock->batch);
+	else
+		sock->batch.append(buf, count);
+	sock->error = 0;
 }
 
-//------------------------------------------------------------------------------
-
-// Receives and removes a chunk of data from a buffer and returns it
-// Comes in a AGS String and SockData flavour
-template <typename T> inline T *recv_extract(Buffer &buffer, bool stream);
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
 
-template <> inline const char *recv_extract(Buffer &buffer, bool stream)
+// Sends the batched data; what is not accepted right away is queued
+inline ags_t flush_impl(Socket *sock)
 {
-	// Get a truncated (zero terminated) version of the received data.
-	const char *data = AGS_STRING(buffer.front().c_str());
+	if (sock->batch.empty())
+	{
+		sock->error = 0;
+		return 1;
+	}
+	
+	if (sending_file(sock))
+	{
+		sock->error = 0;
+		return 0;
+	}
+	
+	if (!send_queued(sock, sock->batch.data(), sock->batch.size()))
+		return 0;
+	sock->batch.clear();
+	return 1;
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
+
+inline ags_t send_impl(Socket *sock, const char *buf, size_t count)
+{
+	long ret = 0;
+	
+	if (sock->reliable)
+		return send_reliable(sock, nullptr, buf, count);
+	
+	if (sock->batching)
+	{
+		batch_append(sock, buf, count);
+		return 1;
+	}
+	
+	// A batch that could not be flushed goes first
+	if (!flush_impl(sock))
+		return 0;
+	
+	if (send_pending(sock))
+	{
+		sock->error = 0;
+		return 0;
+	}
+	
+	if (sock->deflate)
+	{
+		string frames;
+		sock->deflate->compress(buf, count, frames);
+		return send_queued(sock, frames.data(), frames.size());
+	}
+	
+	while (count > 0)
+	{
+		ret = send(sock->id, buf, count, 0);
+		if (ret == SOCKET_ERROR)
+			break;
+		buf += ret;
+		count -= ret;
+	}
+	
+	sock->error = GET_ERROR();
+	if (WOULD_BLOCK(sock->error))
+		sock->error = 0;
+
+	return (ret == SOCKET_ERROR ? 0 : 1);
+}
+
+ags_t Socket_Send(Socket *sock, const char *str)
+{
+	return send_impl(sock, str, strlen(str));
+}
+
+ags_t Socket_SendData(Socket *sock, const SockData *data)
+{
+	return send_impl(sock, data->bytes(), data->size());
+}
+
+//------------------------------------------------------------------------------
+// The parts are handed to the system all at once instead of being joined
+// first. What was not sent is sent again from where it left off.
+
+template <size_t N> inline ags_t sendmany_impl(Socket *sock,
+	const SockData *const (&parts)[N])
+{
+	const char *data[N];
+	size_t size[N];
+	size_t count = 0;
+	long ret = 0;
+	
+	for (const SockData *part : parts)
+		if (part != nullptr && part->size() > 0)
+		{
+			data[count] = part->bytes();
+			size[count] = part->size();
+			++count;
+		}
+	
+	// The layer takes whole messages
+	if (sock->reliable)
+	{
+		string message;
+		for (size_t i = 0; i < count; ++i)
+			message.append(data[i], size[i]);
+		return send_reliable(sock, nullptr, message.data(), message.size());
+	}
+	
+	if (sock->batching)
+	{
+		for (size_t i = 0; i < count; ++i)
+			batch_append(sock, data[i], size[i]);
+		return 1;
+	}
+	
+	// A batch that could not be flushed goes first
+	if (!flush_impl(sock))
+		return 0;
+	
+	if (send_pending(sock))
+	{
+		sock->error = 0;
+		return 0;
+	}
+	
+	if (sock->deflate)
+	{
+		string frames;
+		for (size_t i = 0; i < count; ++i)
+			sock->deflate->compress(data[i], size[i], frames);
+		return send_queued(sock, frames.data(), frames.size());
+	}
+	
+	for (size_t first = 0; first < count;)
+	{
+		ret = sendv(sock->id, data + first, size + first, count - first);
+		if (ret == SOCKET_ERROR)
+			break;
+		
+		for (; first < count && (size_t) ret >= size[first]; ++first)
+			ret -= (long) size[first];
+		if (first < count)
+		{
+			data[first] += ret;
+			size[first] -= ret;
+		}
+	}
+	
+	sock->error = GET_ERROR();
+	if (WOULD_BLOCK(sock->error))
+		sock->error = 0;
+
+	return (ret == SOCKET_ERROR ? 0 : 1);
+}
+
+ags_t Socket_SendMany(Socket *sock, const SockData *part1,
+	const SockData *part2, const SockData *part3, const SockData *part4,
+	const SockData *part5, const SockData *part6, const SockData *part7,
+	const SockData *part8)
+{
+	const SockData *const parts[] =
+		{part1, part2, part3, part4, part5, part6, part7, part8};
+	return sendmany_impl(sock, parts);
+}
+
+//------------------------------------------------------------------------------
+// Unlike Send this never asks to try again, which suits sending to many
+// sockets at once; datagrams that do not fit are lost instead.
+
+int send_whole(Socket *sock, const char *buf, size_t count)
+{
+	if (sock->reliable)
+	{
+		if (!send_reliable(sock, nullptr, buf, count))
+			return sock->error ? sock->error : WOULD_BLOCK_ERROR;
+		return 0;
+	}
+	
+	if (sock->type != SOCK_STREAM)
+	{
+		if (send(sock->id, buf, count, MSG_NOSIGNAL) == SOCKET_ERROR)
+			return GET_ERROR();
+		return 0;
+	}
+	
+	if (sock->batching)
+	{
+		batch_append(sock, buf, count);
+		return 0;
+	}
+	
+	// Nothing can go ahead of a file, so there is no queueing then
+	if (!flush_impl(sock) || sending_file(sock))
+		return sock->error ? sock->error : WOULD_BLOCK_ERROR;
+	
+	if (sock->deflate)
+	{
+		string frames;
+		sock->deflate->compress(buf, count, frames);
+		send_queued(sock, frames.data(), frames.size());
+	}
+	else
+		send_queued(sock, buf, count);
+	return sock->error;
+}
+
+//------------------------------------------------------------------------------
+
+inline ags_t sendto_impl(Socket *sock, const SockAddr *addr,
+	const char *buf, size_t count)
+{
+	long ret = 0;
+	
+	if (sock->reliable)
+		return send_reliable(sock, addr, buf, count);
+	
+	while (count > 0)
+	{
+		ret = sendto(sock->id, buf, count, 0, CONST_ADDR(addr), ADDR_SIZE(addr));
+		if (ret == SOCKET_ERROR)
+			break;
+		buf += ret;
+		count -= ret;
+	}
+	
+	sock->error = GET_ERROR();
+	if (WOULD_BLOCK(sock->error))
+		sock->error = 0;
+	
+	// Sending binds the socket implicitly; replies are read by the pool
+	if (ret != SOCKET_ERROR && sock->type != SOCK_STREAM
+		&& !pool->contains(sock))
+	{
+		pool->add(sock);
+		CheckPoolInvariant();
+	}
+	
+	return (ret == SOCKET_ERROR ? 0 : 1);
+}
+
+ags_t Socket_SendTo(Socket *sock, const SockAddr *addr, const char *str)
+{
+	return sendto_impl(sock, addr, str, strlen(str));
+}
+
+ags_t Socket_SendDataTo(Socket *sock, const SockAddr *addr, const SockData *data)
+{
+	return sendto_impl(sock, addr, data->bytes(), data->size());
+}
+
+//------------------------------------------------------------------------------
+// Files are sent by the pool, which hands them to the system directly (where
+// supported) so their contents never pass through the game.
+
+ags_t Socket_SendFile(Socket *sock, const char *path, ags_t offset,
+	ags_t length)
+{
+	if (sock->type != SOCK_STREAM)
+	{
+		sock->error = NOT_SUPPORTED;
+		return 0;
+	}
+	
+	if (!pool->contains(sock))
+	{
+		sock->error = NOT_CONNECTED;
+		return 0;
+	}
+	
+	std::unique_ptr<File> file(new File(path));
+	if (!file->valid())
+	{
+		sock->error = GET_ERROR();
+		return 0;
+	}
+	
+	std::int64_t size = file->size();
+	if (offset < 0 || offset > size)
+	{
+		sock->error = INVALID_ARGUMENT;
+		return 0;
+	}
+	if (length < 0 || length > size - offset)
+		length = (ags_t) (size - offset);
+	
+	{
+		Mutex::Lock lock(*pool);
+		
+		if (sock->sending.file)
+		{
+			sock->error = 0;
+			return 0;
+		}
+		
+		if (sock->closing != Socket::OPEN)
+		{
+			sock->error = NOT_CONNECTED;
+			return 0;
+		}
+		
+		// Batched data was sent before the file
+		sock->outgoing.append(sock->batch);
+		sock->batch.clear();
+		
+		sock->sending.offset = offset;
+		sock->sending.remaining = length;
+		sock->sending.done = 0;
+		if (length > 0)
+			sock->sending.file = std::move(file);
+	}
+	
+	pool->wake();
+	sock->error = 0;
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+
+ags_t Socket_get_SendingFile(Socket *sock)
+{
+	return (sending_file(sock) ? 1 : 0);
+}
+
+//------------------------------------------------------------------------------
+
+ags_t Socket_get_SendFileProgress(Socket *sock)
+{
+	Mutex::Lock lock(*pool);
+	
+	return (ags_t) sock->sending.done;
+}
+
+//------------------------------------------------------------------------------
+
+// Receives and removes a chunk of data from a buffer and returns it
+// Comes in a AGS String and SockData flavour
+template <typename T> inline T *recv_extract(Buffer &buffer, bool stream);
+
+template <> inline const char *recv_extract(Buffer &buffer, bool stream)
+{
+	// Get a truncated (zero terminated) version of the received data.
+	const char *data = AGS_STRING(buffer.front().c_str());
 
 	// If the connection is streaming we clear the buffer till the first
 	// zero-character; otherwise we are dealing with packets: we remove the
@@ -521,7 +1216,11 @@ template <> inline bool recv_empty(SockData *data)
 
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
 
-template <typename T> inline T *recv_impl(Socket *sock)
+// When a source is given the address a datagram was received from is stored in
+// it; an empty buffer is then reported as an error that says to try again.
+
+template <typename T> inline T *recv_impl(Socket *sock,
+	SockAddr *source = nullptr)
 {
 	T *data;
 	
@@ -537,27 +1236,33 @@ template <typename T> inline T *recv_impl(Socket *sock)
 			if (sock->error)
 			{
 				// Invalidate socket in case of error
-				closesocket(sock->id);
+				if (sock->id != INVALID_SOCKET)
+					closesocket(sock->id);
 				sock->id = INVALID_SOCKET;
 				// The read loop itself will remove it from the pool
 			}
+			else if (source != nullptr)
+				sock->error = WOULD_BLOCK_ERROR;
 			
 			return nullptr;
 		}
 		
+		if (source != nullptr && sock->type != SOCK_STREAM)
+			memcpy(source, &sock->incoming.source(), sizeof (SOCKADDR_STORAGE));
 		data = recv_extract<T>(sock->incoming, sock->type == SOCK_STREAM);
+		
+		// Note: the pool closes connections that were closed locally itself
+		if (recv_empty(data) && sock->type == SOCK_STREAM
+			&& sock->id != INVALID_SOCKET)
+		{
+			// TCP socket was closed, invalidate it.
+			closesocket(sock->id);
+			sock->id = INVALID_SOCKET;
+			// The read loop itself will remove it from the pool
+		}
 	}
 	
 	sock->error = 0;
-
-	if (recv_empty(data) && sock->type == SOCK_STREAM)
-	{
-		// TCP socket was closed, invalidate it.
-		closesocket(sock->id);
-		sock->id = INVALID_SOCKET;
-		// The read loop itself will remove it from the pool
-	}
-	
 	return data;
 }
 
@@ -578,62 +1283,397 @@ SockData *Socket_RecvData(Socket *sock)
 
 //------------------------------------------------------------------------------
 
-template <typename T> inline T *recvfrom_return(const char *buf, size_t count);
+// Datagrams are read by the pool, like all other data: RecvFrom is merely
+// a buffer read that also reports the source.
 
-template <> inline const char *recvfrom_return(const char *buf, size_t count)
+const char *Socket_RecvFrom(Socket *sock, SockAddr *addr)
 {
-	return AGS_STRING(buf);
+	return recv_impl<const char>(sock, addr);
 }
 
-template <> inline SockData *recvfrom_return(const char *buf, size_t count)
+SockData *Socket_RecvDataFrom(Socket *sock, SockAddr *addr)
 {
-	SockData *data = new SockData();
-	AGS_OBJECT(SockData, data);
-	data->data = string(buf, count);
-	return data;
+	return recv_impl<SockData>(sock, addr);
 }
 
-//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
+//------------------------------------------------------------------------------
+// Incoming data is written to the file by the pool as it arrives. What was
+// received before is written first so the file does not miss the beginning.
 
-template <typename T> inline T *recvfrom_impl(Socket *sock, SockAddr *addr)
+ags_t Socket_RecvToFile(Socket *sock, const char *path, ags_t length)
 {
-	char buffer[65536];
-	buffer[sizeof (buffer) - 1] = 0;
+	if (sock->type != SOCK_STREAM)
+	{
+		sock->error = NOT_SUPPORTED;
+		return 0;
+	}
+	
+	// Only the pool lets go of the file, so it cannot become busy meanwhile
+	if (Socket_get_ReceivingFile(sock))
+	{
+		sock->error = 0;
+		return 0;
+	}
+	
+	// Like SendFile: the pool has to carry out the transfer
+	if (!pool->contains(sock))
+	{
+		sock->error = NOT_CONNECTED;
+		return 0;
+	}
+	
+	std::unique_ptr<File> file(new File(path, true));
+	if (!file->valid())
+	{
+		sock->error = GET_ERROR();
+		return 0;
+	}
+	
+	{
+		Mutex::Lock lock(*pool);
+		
+		FileTransfer &transfer = sock->receiving;
+		std::int64_t remaining = length < 0 ? INT64_MAX : length;
+		std::int64_t written = 0;
+		
+		// What arrived already goes to the file first. It is taken from the
+		// buffer only once all of it is written, so that a failure loses none.
+		Buffer &incoming = sock->incoming;
+		for (size_t i = 0; i < incoming.size() && written < remaining; ++i)
+		{
+			const string &data = incoming.at(i);
+			if (data.empty())
+				break;
+			
+			size_t part = (size_t) MIN((std::int64_t) data.size(),
+				remaining - written);
+			if (file->write(written, data.data(), part) < 0)
+			{
+				sock->error = GET_ERROR();
+				return 0;
+			}
+			written += part;
+		}
+		
+		for (std::int64_t left = written; left > 0;)
+		{
+			string &data = incoming.front();
+			size_t part = (size_t) MIN((std::int64_t) data.size(), left);
+			data.erase(0, part);
+			if (data.empty())
+				incoming.pop();
+			left -= part;
+		}
+		
+		transfer.offset = written;
+		transfer.remaining = remaining - written;
+		transfer.done = written;
+		
+		// The pool takes over unless the stream has ended already
+		bool ended = incoming.error
+			|| (!incoming.empty() && incoming.front().empty());
+		if (transfer.remaining > 0 && !ended)
+			transfer.file = std::move(file);
+	}
+	
+	sock->error = 0;
+	return 1;
+}
 
-	ADDRLEN addrlen = sizeof (SockAddr);
-	long ret = recvfrom(sock->id, buffer, sizeof (buffer) - 1, 0,
-		ADDR(addr), &addrlen);
-	sock->error = GET_ERROR();
+//------------------------------------------------------------------------------
+
+ags_t Socket_get_ReceivingFile(Socket *sock)
+{
+	Mutex::Lock lock(*pool);
 	
-	if (ret == SOCKET_ERROR)
-		return nullptr;
+	return (sock->receiving.file ? 1 : 0);
+}
+
+//------------------------------------------------------------------------------
+
+ags_t Socket_get_RecvFileProgress(Socket *sock)
+{
+	Mutex::Lock lock(*pool);
 	
-	return recvfrom_return<T>(buffer, ret);
+	return (ags_t) sock->receiving.done;
 }
 
-const char *Socket_RecvFrom(Socket *sock, SockAddr *addr)
+//==============================================================================
+
+// Batches are kept by the socket itself until they are flushed. Auto flushing
+// sockets are also flushed when the engine has drawn a frame.
+
+ags_t Socket_BeginBatch(Socket *sock, ags_t auto_flush)
 {
-	return recvfrom_impl<const char>(sock, addr);
+	if (sock->type != SOCK_STREAM)
+	{
+		sock->error = NOT_SUPPORTED;
+		return 0;
+	}
+	
+	sock->batching = true;
+	if (!auto_flush)
+		auto_flushed.erase(sock);
+	else
+	{
+		auto_flushed.insert(sock);
+		if (!frame_hooked)
+		{
+			engine->RequestEventHook(AGSE_FINALSCREENDRAW);
+			frame_hooked = true;
+		}
+	}
+	
+	sock->error = 0;
+	return 1;
 }
 
-SockData *Socket_RecvDataFrom(Socket *sock, SockAddr *addr)
+//------------------------------------------------------------------------------
+
+ags_t Socket_Flush(Socket *sock)
 {
-	return recvfrom_impl<SockData>(sock, addr);
+	sock->batching = false;
+	auto_flushed.erase(sock);
+	return flush_impl(sock);
+}
+
+//------------------------------------------------------------------------------
+
+void FlushBatches()
+{
+	for (Socket *sock : auto_flushed)
+		flush_impl(sock);
 }
 
 //==============================================================================
 
-// Unimplemented, there is probably no use for this
+// Translates a script option to the level and option values of the platform.
+// Returns an error code when the option does not exist (on this platform) or
+// does not belong to the given level.
+
+int translate_option(int domain, ags_t level, ags_t option,
+	int &native_level, int &native_option)
+{
+	ags_t expected = AGSSOCK_LEVEL_SOCKET;
+	native_level = SOL_SOCKET;
+	
+	switch (option)
+	{
+		case AGSSOCK_OPTION_REUSE_ADDRESS:
+			native_option = SO_REUSEADDR;
+			break;
+#ifdef SO_REUSEPORT
+		case AGSSOCK_OPTION_REUSE_PORT:
+			native_option = SO_REUSEPORT;
+			break;
+#endif
+		case AGSSOCK_OPTION_KEEP_ALIVE:
+			native_option = SO_KEEPALIVE;
+			break;
+		case AGSSOCK_OPTION_RECEIVE_BUFFER:
+			native_option = SO_RCVBUF;
+			break;
+		case AGSSOCK_OPTION_SEND_BUFFER:
+			native_option = SO_SNDBUF;
+			break;
+		case AGSSOCK_OPTION_NO_DELAY:
+			expected = AGSSOCK_LEVEL_TCP;
+			native_level = IPPROTO_TCP;
+			native_option = TCP_NODELAY;
+			break;
+#ifdef TCP_QUICKACK
+		case AGSSOCK_OPTION_QUICK_ACK:
+			expected = AGSSOCK_LEVEL_TCP;
+			native_level = IPPROTO_TCP;
+			native_option = TCP_QUICKACK;
+			break;
+#endif
+		case AGSSOCK_OPTION_BROADCAST:
+			native_option = SO_BROADCAST;
+			break;
+		case AGSSOCK_OPTION_TYPE_OF_SERVICE:
+			expected = AGSSOCK_LEVEL_IP;
+#ifdef IPV6_TCLASS
+			if (domain == AF_INET6)
+			{
+				native_level = IPPROTO_IPV6;
+				native_option = IPV6_TCLASS;
+				break;
+			}
+#endif
+			native_level = IPPROTO_IP;
+			native_option = IP_TOS;
+			break;
+#ifdef UDP_SEGMENT
+		case AGSSOCK_OPTION_SEGMENT_SIZE:
+			expected = AGSSOCK_LEVEL_UDP;
+			native_level = IPPROTO_UDP;
+			native_option = UDP_SEGMENT;
+			break;
+#endif
+#ifdef UDP_GRO
+		case AGSSOCK_OPTION_COALESCE:
+			expected = AGSSOCK_LEVEL_UDP;
+			native_level = IPPROTO_UDP;
+			native_option = UDP_GRO;
+			break;
+#endif
+		case AGSSOCK_OPTION_MULTICAST_TTL:
+			expected = AGSSOCK_LEVEL_IP;
+			if (domain == AF_INET6)
+			{
+				native_level = IPPROTO_IPV6;
+				native_option = IPV6_MULTICAST_HOPS;
+				break;
+			}
+			native_level = IPPROTO_IP;
+			native_option = IP_MULTICAST_TTL;
+			break;
+		case AGSSOCK_OPTION_MULTICAST_LOOP:
+			expected = AGSSOCK_LEVEL_IP;
+			if (domain == AF_INET6)
+			{
+				native_level = IPPROTO_IPV6;
+				native_option = IPV6_MULTICAST_LOOP;
+				break;
+			}
+			native_level = IPPROTO_IP;
+			native_option = IP_MULTICAST_LOOP;
+			break;
+		default:
+			return OPTION_UNSUPPORTED;
+	}
+	
+	return level == expected ? 0 : INVALID_ARGUMENT;
+}
+
+//------------------------------------------------------------------------------
+
+ags_t Socket_GetOption(Socket *sock, ags_t level, ags_t option)
+{
+	int native_level, native_option;
+	sock->error = translate_option(sock->domain, level, option, native_level,
+		native_option);
+	if (sock->error)
+		return 0;
+	
+	int value = 0;
+	ADDRLEN size = sizeof (value);
+	int ret = getsockopt(sock->id, native_level, native_option,
+		reinterpret_cast<char *> (&value), &size);
+	sock->error = ret == SOCKET_ERROR ? GET_ERROR() : 0;
+	
+	// Flags may be reported as any non-zero value
+	switch (option)
+	{
+		case AGSSOCK_OPTION_REUSE_ADDRESS:
+		case AGSSOCK_OPTION_REUSE_PORT:
+		case AGSSOCK_OPTION_KEEP_ALIVE:
+		case AGSSOCK_OPTION_NO_DELAY:
+		case AGSSOCK_OPTION_QUICK_ACK:
+		case AGSSOCK_OPTION_COALESCE:
+		case AGSSOCK_OPTION_BROADCAST:
+		case AGSSOCK_OPTION_MULTICAST_LOOP:
+			value = value != 0;
+	}
+	
+	return ret == SOCKET_ERROR ? 0 : value;
+}
+
+//------------------------------------------------------------------------------
+
+// Sets an option of a socket descriptor of the given domain.
+// Returns an error code, or zero when successful.
+
+int apply_option(SOCKET id, int domain, ags_t level, ags_t option, ags_t value)
+{
+	int native_level, native_option;
+	int error = translate_option(domain, level, option, native_level,
+		native_option);
+	if (error)
+		return error;
+	
+	int native_value = value;
+	int ret = setsockopt(id, native_level, native_option,
+		reinterpret_cast<const char *> (&native_value), sizeof (native_value));
+	return ret == SOCKET_ERROR ? GET_ERROR() : 0;
+}
+
+//------------------------------------------------------------------------------
+
+ags_t Socket_SetOption(Socket *sock, ags_t level, ags_t option, ags_t value)
+{
+	sock->error = apply_option(sock->id, sock->domain, level, option, value);
+	if (sock->error)
+		return 0;
+	
+	// The pool has to split what the system coalesced
+	if (option == AGSSOCK_OPTION_COALESCE)
+	{
+		Mutex::Lock lock(*pool);
+		sock->coalesced = value != 0;
+	}
+	
+	// Remembered for the sockets that race to connect by name
+	for (SocketOption &opt : sock->options)
+		if (opt.level == level && opt.option == option)
+		{
+			opt.value = value;
+			return 1;
+		}
+	sock->options.push_back(SocketOption {level, option, value});
+	return 1;
+}
+
+//==============================================================================
+
+// Joins or leaves a multicast group on the default interface. What arrives for
+// the group is read by the pool like any other datagram.
+
+inline ags_t membership(Socket *sock, const SockAddr *group, bool join)
+{
+	if (group == nullptr)
+	{
+		sock->error = INVALID_ARGUMENT;
+		return 0;
+	}
+	
+	int ret;
+	if (group->ss_family == AF_INET6)
+	{
+		ipv6_mreq request;
+		request.ipv6mr_multiaddr = ((const sockaddr_in6 *) group)->sin6_addr;
+		request.ipv6mr_interface = 0;
+		ret = setsockopt(sock->id, IPPROTO_IPV6,
+			join ? IPV6_JOIN_GROUP : IPV6_LEAVE_GROUP,
+			reinterpret_cast<const char *> (&request), sizeof (request));
+	}
+	else
+	{
+		ip_mreq request;
+		request.imr_multiaddr = ((const sockaddr_in *) group)->sin_addr;
+		request.imr_interface.s_addr = htonl(INADDR_ANY);
+		ret = setsockopt(sock->id, IPPROTO_IP,
+			join ? IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP,
+			reinterpret_cast<const char *> (&request), sizeof (request));
+	}
+	
+	sock->error = ret == SOCKET_ERROR ? GET_ERROR() : 0;
+	return ret == SOCKET_ERROR ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
 
-ags_t Socket_GetOption(Socket *, ags_t level, ags_t option)
+ags_t Socket_JoinGroup(Socket *sock, const SockAddr *group)
 {
-	return 0;
+	return membership(sock, group, true);
 }
 
 //------------------------------------------------------------------------------
 
-void Socket_SetOption(Socket *, ags_t level, ags_t option, ags_t value)
+ags_t Socket_LeaveGroup(Socket *sock, const SockAddr *group)
 {
+	return membership(sock, group, false);
 }
 
 //------------------------------------------------------------------------------
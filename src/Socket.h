@@ -12,10 +12,17 @@
 #ifndef _SOCKET_H
 #define _SOCKET_H
 
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "API.h"
 #include "Buffer.h"
+#include "Compress.h"
+#include "Connector.h"
+#include "Reliable.h"
 #include "SockAddr.h"
 #include "SockData.h"
 #include "version.h"
@@ -28,9 +35,25 @@ namespace AGSSock {
 
 void Initialize(); //!< Initializes the interface so it is ready to be used
 void Terminate();  //!< Resets the interface to its initial state
+void FlushBatches(); //!< Sends the data batched by auto flushing sockets
 
 //------------------------------------------------------------------------------
 
+//! A file that is sent or received by the pool
+struct FileTransfer
+{
+	std::unique_ptr<AGSSockAPI::File> file; // Unset when there is none (left)
+	std::int64_t offset;    // Position in the file of the next part to send
+	std::int64_t remaining; // Number of bytes that are left to transfer
+	std::int64_t done;      // Number of bytes that were transferred
+};
+
+//! An option the game set, as it was passed to SetOption
+struct SocketOption
+{
+	ags_t level, option, value;
+};
+
 struct Socket
 {
 	// Exposed: <<<DO NOT CHANGE THE ORDER!!!>>>
@@ -41,11 +64,53 @@ struct Socket
 	// Internal:
 	SockAddr *local, *remote;
 	std::string tag;
-	Buffer incoming; // This design does not feature an outgoing buffer
+	Buffer incoming;
+	std::string outgoing; // Sent by the pool once the socket is writable
+
+	// Stream compression (both or neither are set)
+	std::unique_ptr<StreamCompressor> deflate;
+	std::unique_ptr<StreamDecompressor> inflate;
+
+	// Connecting by host name, while racing the addresses
+	std::shared_ptr<Connector> connector;
+	std::vector<SocketOption> options; // Set again on the racing sockets
+
+	// Graceful close, carried out by the pool
+	enum Closing { OPEN = 0, FLUSHING, DRAINING };
+	static const int DEFAULT_LINGER = 2000;
+	
+	int linger;       // Milliseconds a closed connection has to finish
+	Closing closing;  // Stage of closing: sending what is left, awaiting the end
+	bool orphaned;    // Disposed while closing: the pool deletes it
+	std::chrono::steady_clock::time_point deadline; // End of the linger time
+
+	// Sent by the pool once the outgoing data is sent
+	FileTransfer sending;
+	// Written by the pool instead of the incoming buffer, as data arrives
+	FileTransfer receiving;
+
+	// Datagrams may arrive coalesced by the system (UDP_GRO)
+	bool coalesced;
+
+	// Data held back to be sent at once (only used by the game)
+	bool batching;
+	std::string batch;
+
+	// The other end of a pair, held until this end is disposed
+	Socket *pair;
+
+	// Acknowledges, resends and orders datagrams (unset when not enabled)
+	std::unique_ptr<Reliable> reliable;
+	int delivery, channel; // Of the messages the game sends (only used by it)
 };
 
 AGS_DEFINE_CLASS(Socket)
 
+//! Sends all of the data to a connected socket, or none of it: what a stream
+//! does not accept right away is queued for the pool.
+//! \returns an error code, or zero when successful
+int send_whole(Socket *, const char *buf, size_t count);
+
 //------------------------------------------------------------------------------
 
 Socket *Socket_Create(ags_t domain, ags_t type, ags_t protocol);
@@ -53,38 +118,97 @@ Socket *Socket_CreateUDP();
 Socket *Socket_CreateTCP();
 Socket *Socket_CreateUDPv6();
 Socket *Socket_CreateTCPv6();
+Socket *Socket_CreateLocal(ags_t datagram);
+Socket *Socket_CreatePair(ags_t datagram);
 
 ags_t Socket_get_Valid(Socket *);
+Socket *Socket_get_Pair(Socket *);
 const char *Socket_get_Tag(Socket *);
 void Socket_set_Tag(Socket *, const char *);
 SockAddr *Socket_get_Local(Socket *);
 SockAddr *Socket_get_Remote(Socket *);
 ags_t Socket_ErrorValue(Socket *sock);
 const char *Socket_ErrorString(Socket *);
+ags_t Socket_get_Compression(Socket *);
+void Socket_set_Compression(Socket *, ags_t);
+ags_t Socket_get_Linger(Socket *);
+void Socket_set_Linger(Socket *, ags_t);
+ags_t Socket_get_Reliable(Socket *);
+void Socket_set_Reliable(Socket *, ags_t);
+ags_t Socket_SetDelivery(Socket *, ags_t delivery, ags_t channel);
 
 ags_t Socket_Bind(Socket *, const SockAddr *);
 ags_t Socket_Listen(Socket *, ags_t backlog);
-ags_t Socket_Connect(Socket *, const SockAddr *, ags_t async);
+ags_t Socket_Connect(Socket *, const SockAddr *, ags_t async, ags_t timeout);
+ags_t Socket_Connect2(Socket *, const SockAddr *, ags_t async);
+ags_t Socket_ConnectByName(Socket *, const char *host, ags_t async,
+	ags_t timeout);
 Socket *Socket_Accept(Socket *);
 void Socket_Close(Socket *);
 
 ags_t Socket_Send(Socket *, const char *);
 ags_t Socket_SendData(Socket *, const SockData *);
+ags_t Socket_SendMany(Socket *, const SockData *, const SockData *,
+	const SockData *, const SockData *, const SockData *, const SockData *,
+	const SockData *, const SockData *);
 ags_t Socket_SendTo(Socket *, const SockAddr *, const char *);
 ags_t Socket_SendDataTo(Socket *, const SockAddr *, const SockData *);
+ags_t Socket_SendFile(Socket *, const char *path, ags_t offset, ags_t length);
+ags_t Socket_get_SendingFile(Socket *);
+ags_t Socket_get_SendFileProgress(Socket *);
 const char *Socket_Recv(Socket *);
 SockData *Socket_RecvData(Socket *);
 const char *Socket_RecvFrom(Socket *, SockAddr *);
 SockData *Socket_RecvDataFrom(Socket *, SockAddr *);
+ags_t Socket_RecvToFile(Socket *, const char *path, ags_t length);
+ags_t Socket_get_ReceivingFile(Socket *);
+ags_t Socket_get_RecvFileProgress(Socket *);
+
+ags_t Socket_BeginBatch(Socket *, ags_t auto_flush);
+ags_t Socket_Flush(Socket *);
 
 ags_t Socket_GetOption(Socket *, ags_t level, ags_t option);
-void Socket_SetOption(Socket *, ags_t level, ags_t option, ags_t value);
+ags_t Socket_SetOption(Socket *, ags_t level, ags_t option, ags_t value);
+
+ags_t Socket_JoinGroup(Socket *, const SockAddr *);
+ags_t Socket_LeaveGroup(Socket *, const SockAddr *);
 
 //------------------------------------------------------------------------------
 
 } /* namespace AGSSock */
 
 //------------------------------------------------------------------------------
+//                           Plugin interface
+
+// Milliseconds a connection in sync mode may take by default
+#define AGSSOCK_CONNECT_TIMEOUT 5000
+
+// Option level constant values, translated to the platform values
+#define AGSSOCK_LEVEL_SOCKET 1
+#define AGSSOCK_LEVEL_TCP    2
+#define AGSSOCK_LEVEL_IP     3
+#define AGSSOCK_LEVEL_UDP    4
+
+// Option constant values, translated to the platform values
+#define AGSSOCK_OPTION_REUSE_ADDRESS   1
+#define AGSSOCK_OPTION_REUSE_PORT      2
+#define AGSSOCK_OPTION_KEEP_ALIVE      3
+#define AGSSOCK_OPTION_RECEIVE_BUFFER  4
+#define AGSSOCK_OPTION_SEND_BUFFER     5
+#define AGSSOCK_OPTION_NO_DELAY        6
+#define AGSSOCK_OPTION_QUICK_ACK       7
+#define AGSSOCK_OPTION_TYPE_OF_SERVICE 8
+#define AGSSOCK_OPTION_SEGMENT_SIZE    9
+#define AGSSOCK_OPTION_COALESCE       10
+#define AGSSOCK_OPTION_BROADCAST      11
+#define AGSSOCK_OPTION_MULTICAST_TTL  12
+#define AGSSOCK_OPTION_MULTICAST_LOOP 13
+
+// Delivery constant values, the same as those of the reliability layer
+#define AGSSOCK_DELIVERY_RELIABLE_ORDERED 0
+#define AGSSOCK_DELIVERY_RELIABLE         1
+#define AGSSOCK_DELIVERY_SEQUENCED        2
+#define AGSSOCK_DELIVERY_UNRELIABLE       3
 
 #define SOCKET_HEADER \
 	"#define AGSSOCK " RELEASE_DATE "\r\n\r\n" \
@@ -104,6 +228,36 @@ void Socket_SetOption(Socket *, ags_t level, ags_t option, ags_t value);
 	"	eSockNetworkNotAvailable = " STRINGIFY(AGSSOCK_NETWORK_NOT_AVAILABLE) ",\r\n" \
 	"	eSockNotConnected        = " STRINGIFY(AGSSOCK_NOT_CONNECTED) "\r\n" \
 	"};\r\n\r\n" \
+	"enum SockLevel\r\n" \
+	"{\r\n" \
+	"	eSockLevelSocket = " STRINGIFY(AGSSOCK_LEVEL_SOCKET) ",\r\n" \
+	"	eSockLevelTCP    = " STRINGIFY(AGSSOCK_LEVEL_TCP) ",\r\n" \
+	"	eSockLevelIP     = " STRINGIFY(AGSSOCK_LEVEL_IP) ",\r\n" \
+	"	eSockLevelUDP    = " STRINGIFY(AGSSOCK_LEVEL_UDP) "\r\n" \
+	"};\r\n\r\n" \
+	"enum SockOption\r\n" \
+	"{\r\n" \
+	"	eSockOptionReuseAddress  = " STRINGIFY(AGSSOCK_OPTION_REUSE_ADDRESS) ",  // eSockLevelSocket\r\n" \
+	"	eSockOptionReusePort     = " STRINGIFY(AGSSOCK_OPTION_REUSE_PORT) ",  // eSockLevelSocket, not on Windows\r\n" \
+	"	eSockOptionKeepAlive     = " STRINGIFY(AGSSOCK_OPTION_KEEP_ALIVE) ",  // eSockLevelSocket\r\n" \
+	"	eSockOptionReceiveBuffer = " STRINGIFY(AGSSOCK_OPTION_RECEIVE_BUFFER) ",  // eSockLevelSocket\r\n" \
+	"	eSockOptionSendBuffer    = " STRINGIFY(AGSSOCK_OPTION_SEND_BUFFER) ",  // eSockLevelSocket\r\n" \
+	"	eSockOptionNoDelay       = " STRINGIFY(AGSSOCK_OPTION_NO_DELAY) ",  // eSockLevelTCP\r\n" \
+	"	eSockOptionQuickAck      = " STRINGIFY(AGSSOCK_OPTION_QUICK_ACK) ",  // eSockLevelTCP, Linux only\r\n" \
+	"	eSockOptionTypeOfService = " STRINGIFY(AGSSOCK_OPTION_TYPE_OF_SERVICE) ",  // eSockLevelIP\r\n" \
+	"	eSockOptionSegmentSize   = " STRINGIFY(AGSSOCK_OPTION_SEGMENT_SIZE) ",  // eSockLevelUDP, Linux only\r\n" \
+	"	eSockOptionCoalesce      = " STRINGIFY(AGSSOCK_OPTION_COALESCE) ", // eSockLevelUDP, Linux only\r\n" \
+	"	eSockOptionBroadcast     = " STRINGIFY(AGSSOCK_OPTION_BROADCAST) ", // eSockLevelSocket\r\n" \
+	"	eSockOptionMulticastTTL  = " STRINGIFY(AGSSOCK_OPTION_MULTICAST_TTL) ", // eSockLevelIP\r\n" \
+	"	eSockOptionMulticastLoop = " STRINGIFY(AGSSOCK_OPTION_MULTICAST_LOOP) "  // eSockLevelIP\r\n" \
+	"};\r\n\r\n" \
+	"enum SockDelivery\r\n" \
+	"{\r\n" \
+	"	eSockReliableOrdered = " STRINGIFY(AGSSOCK_DELIVERY_RELIABLE_ORDERED) ", // resent until it arrives, in the order it was sent\r\n" \
+	"	eSockReliable        = " STRINGIFY(AGSSOCK_DELIVERY_RELIABLE) ", // resent until it arrives, in any order\r\n" \
+	"	eSockSequenced       = " STRINGIFY(AGSSOCK_DELIVERY_SEQUENCED) ", // may be lost, older ones than the last are dropped\r\n" \
+	"	eSockUnreliable      = " STRINGIFY(AGSSOCK_DELIVERY_UNRELIABLE) "  // may be lost, duplicated or arrive out of order\r\n" \
+	"};\r\n\r\n" \
 	"managed struct Socket\r\n" \
 	"{\r\n" \
 	"	/// Creates a socket for the specified protocol. (advanced)\r\n" \
@@ -116,6 +270,10 @@ void Socket_SetOption(Socket *, ags_t level, ags_t option, ags_t value);
 	"	import static Socket *CreateUDPv6();         // $AUTOCOMPLETESTATICONLY$\r\n" \
 	"	/// Creates a TCP socket for IPv6. (when in doubt use CreateTCP)\r\n" \
 	"	import static Socket *CreateTCPv6();         // $AUTOCOMPLETESTATICONLY$\r\n" \
+	"	/// Creates a local socket for other programs on the same machine. (datagram: message based instead of streaming)\r\n" \
+	"	import static Socket *CreateLocal(bool datagram = false); // $AUTOCOMPLETESTATICONLY$\r\n" \
+	"	/// Creates two local sockets connected to each other; the other one is in Pair. (not on Windows)\r\n" \
+	"	import static Socket *CreatePair(bool datagram = false);  // $AUTOCOMPLETESTATICONLY$\r\n" \
 	"	\r\n" \
 	"	readonly int ID;                             // $AUTOCOMPLETEIGNORE$\r\n" \
 	"	readonly int Domain;                         // $AUTOCOMPLETEIGNORE$\r\n" \
@@ -127,6 +285,14 @@ void Socket_SetOption(Socket *, ags_t level, ags_t option, ags_t value);
 	"	readonly import attribute SockAddr *Local;\r\n" \
 	"	readonly import attribute SockAddr *Remote;\r\n" \
 	"	readonly import attribute bool Valid;\r\n" \
+	"	/// The other socket of a pair made by CreatePair.\r\n" \
+	"	readonly import attribute Socket *Pair;\r\n" \
+	"	/// Compresses the data stream in both directions. (TCP only) Both parties need to enable it before connecting or listening.\r\n" \
+	"	         import attribute bool Compression;\r\n" \
+	"	/// Milliseconds a closed connection gets to send what is left and hear the remote host close. (default 2000)\r\n" \
+	"	         import attribute int Linger;\r\n" \
+	"	/// Acknowledges and resends the messages of this socket as set by SetDelivery. (UDP only) Both parties need to enable it before sending.\r\n" \
+	"	         import attribute bool Reliable;\r\n" \
 	"	\r\n" \
 	"	/// Returns the last error observed from this socket as an enumerated value.\r\n" \
 	"	import SockError ErrorValue();\r\n" \
@@ -136,11 +302,13 @@ void Socket_SetOption(Socket *, ags_t level, ags_t option, ags_t value);
 	"	import bool Bind(SockAddr *local);\r\n" \
 	"	/// Makes a socket listen for incoming connection requests. (TCP only) Backlog specifies how many requests can be queued. (optional)\r\n" \
 	"	import bool Listen(int backlog = 10);\r\n" \
-	"	/// Makes a socket connect to a remote host. (for UDP it will simply bind to a remote address) Defaults to sync which makes it wait; see the manual for async use.\r\n" \
-	"	import bool Connect(SockAddr *host, bool async = false);\r\n" \
+	"	/// Makes a socket connect to a remote host. (for UDP it will simply bind to a remote address) Defaults to sync which makes it wait up to timeout milliseconds; see the manual for async use.\r\n" \
+	"	import bool Connect(SockAddr *host, bool async = false, int timeout = " STRINGIFY(AGSSOCK_CONNECT_TIMEOUT) ");\r\n" \
+	"	/// Connects to a host by name, trying all of its addresses at once. (for example: \"localhost:8080\") Works like Connect; the socket must not be bound.\r\n" \
+	"	import bool ConnectByName(const string host, bool async = false, int timeout = " STRINGIFY(AGSSOCK_CONNECT_TIMEOUT) ");\r\n" \
 	"	/// Accepts a connection request and returns the resulting socket when successful. (TCP only)\r\n" \
 	"	import Socket *Accept();\r\n" \
-	"	/// Closes the socket. (you can still receive until socket is marked invalid)\r\n" \
+	"	/// Closes the socket without waiting; queued data is still sent. (you can still receive what arrived before the socket is marked invalid)\r\n" \
 	"	import void Close();\r\n" \
 	"	\r\n" \
 	"	/// Sends a string to the remote host. Returns whether successful. (no error means: try again later)\r\n" \
@@ -152,8 +320,13 @@ void Socket_SetOption(Socket *, ags_t level, ags_t option, ags_t value);
 	"	/// Receives a string from an unspecified host. The given address object will contain the remote address. (UDP only)\r\n" \
 	"	import String RecvFrom(SockAddr *source);\r\n" \
 	"	\r\n" \
+	"	/// How the messages sent from now on are delivered when Reliable, and on which of the 16 channels; a channel never waits for another.\r\n" \
+	"	import bool SetDelivery(SockDelivery delivery, int channel = 0);\r\n" \
+	"	\r\n" \
 	"	/// Sends raw data to the remote host. Returns whether successful. (no error means: try again later\r\n" \
 	"	import bool SendData(SockData *data);\r\n" \
+	"	/// Sends up to eight pieces of raw data to the remote host as one, without joining them first. Returns whether successful. (no error means: try again later)\r\n" \
+	"	import bool SendMany(SockData *part1, SockData *part2, SockData *part3 = 0, SockData *part4 = 0, SockData *part5 = 0, SockData *part6 = 0, SockData *part7 = 0, SockData *part8 = 0);\r\n" \
 	"	/// Sends raw data to the specified remote host. (UDP only)\r\n" \
 	"	import bool SendDataTo(SockAddr *target, SockData *data);\r\n" \
 	"	/// Receives raw data from the remote host. (no error means: try again later)\r\n" \
@@ -161,10 +334,32 @@ void Socket_SetOption(Socket *, ags_t level, ags_t option, ags_t value);
 	"	/// Receives raw data from an unspecified host. The given address object will contain the remote address. (UDP only)\r\n" \
 	"	import SockData *RecvDataFrom(SockAddr *source);\r\n" \
 	"	\r\n" \
-	"	/// Gets a socket option. (advanced)\r\n" \
-	"	import long GetOption(int level, int option);             // $AUTOCOMPLETEIGNORE$\r\n" \
-	"	/// Sets a socket option. (advanced)\r\n" \
-	"	import bool SetOption(int level, int option, long value); // $AUTOCOMPLETEIGNORE$\r\n" \
+	"	/// Sends (part of) a file to the remote host in the background. (TCP only) A negative length sends the rest of the file.\r\n" \
+	"	import bool SendFile(const string path, int offset = 0, int length = -1);\r\n" \
+	"	/// Whether a file is still being sent; other data can only be sent once it is done.\r\n" \
+	"	readonly import attribute bool SendingFile;\r\n" \
+	"	/// The number of bytes of the last file that were sent so far.\r\n" \
+	"	readonly import attribute int SendFileProgress;\r\n" \
+	"	/// Writes the data that arrives to a file in the background instead. (TCP only) A negative length receives until the connection is closed.\r\n" \
+	"	import bool RecvToFile(const string path, int length = -1);\r\n" \
+	"	/// Whether a file is still being received; afterwards the data arrives as usual.\r\n" \
+	"	readonly import attribute bool ReceivingFile;\r\n" \
+	"	/// The number of bytes written to the last file so far.\r\n" \
+	"	readonly import attribute int RecvFileProgress;\r\n" \
+	"	\r\n" \
+	"	/// Holds back the data that is sent so it goes out at once on Flush; auto flush sends it at the end of every frame as well. (TCP only)\r\n" \
+	"	import bool BeginBatch(bool auto_flush = false);\r\n" \
+	"	/// Sends the data that was held back and ends the batch. (no error means: try again later)\r\n" \
+	"	import bool Flush();\r\n" \
+	"	\r\n" \
+	"	/// Gets a socket option; flags are 0 or 1. (advanced)\r\n" \
+	"	import int GetOption(SockLevel level, SockOption option);\r\n" \
+	"	/// Sets a socket option; for example eSockOptionNoDelay lowers the latency of small messages. (advanced)\r\n" \
+	"	import bool SetOption(SockLevel level, SockOption option, int value);\r\n" \
+	"	/// Receives the datagrams sent to a multicast group address from now on. (UDP only)\r\n" \
+	"	import bool JoinGroup(SockAddr *group);\r\n" \
+	"	/// Stops receiving the datagrams sent to a multicast group address. (UDP only)\r\n" \
+	"	import bool LeaveGroup(SockAddr *group);\r\n" \
 	"};\r\n"
 
 #define SOCKET_ENTRY    	                     \
@@ -174,15 +369,23 @@ void Socket_SetOption(Socket *, ags_t level, ags_t option, ags_t value);
 	AGS_METHOD  (Socket, CreateTCP, 0)           \
 	AGS_METHOD  (Socket, CreateUDPv6, 0)         \
 	AGS_METHOD  (Socket, CreateTCPv6, 0)         \
+	AGS_METHOD  (Socket, CreateLocal, 1)         \
+	AGS_METHOD  (Socket, CreatePair, 1)          \
 	AGS_MEMBER  (Socket, Tag)                    \
 	AGS_READONLY(Socket, Local)                  \
 	AGS_READONLY(Socket, Remote)                 \
 	AGS_READONLY(Socket, Valid)                  \
+	AGS_READONLY(Socket, Pair)                   \
+	AGS_MEMBER  (Socket, Compression)            \
+	AGS_MEMBER  (Socket, Linger)                 \
+	AGS_MEMBER  (Socket, Reliable)               \
 	AGS_METHOD  (Socket, ErrorValue, 0)          \
 	AGS_METHOD  (Socket, ErrorString, 0)         \
 	AGS_METHOD  (Socket, Bind, 1)                \
 	AGS_METHOD  (Socket, Listen, 1)              \
-	AGS_METHOD  (Socket, Connect, 2)             \
+	AGS_METHOD  (Socket, Connect, 3)             \
+	AGS_LEGACY  (Socket, Connect, 2)             \
+	AGS_METHOD  (Socket, ConnectByName, 3)       \
 	AGS_METHOD  (Socket, Accept, 0)              \
 	AGS_METHOD  (Socket, Close, 0)               \
 	AGS_METHOD  (Socket, Send, 1)                \
@@ -190,11 +393,23 @@ void Socket_SetOption(Socket *, ags_t level, ags_t option, ags_t value);
 	AGS_METHOD  (Socket, Recv, 0)                \
 	AGS_METHOD  (Socket, RecvFrom, 1)            \
 	AGS_METHOD  (Socket, SendData, 1)            \
+	AGS_METHOD  (Socket, SendMany, 8)            \
 	AGS_METHOD  (Socket, SendDataTo, 2)          \
 	AGS_METHOD  (Socket, RecvData, 0)            \
 	AGS_METHOD  (Socket, RecvDataFrom, 1)        \
+	AGS_METHOD  (Socket, SetDelivery, 2)         \
+	AGS_METHOD  (Socket, SendFile, 3)            \
+	AGS_READONLY(Socket, SendingFile)            \
+	AGS_READONLY(Socket, SendFileProgress)       \
+	AGS_METHOD  (Socket, RecvToFile, 2)          \
+	AGS_READONLY(Socket, ReceivingFile)          \
+	AGS_READONLY(Socket, RecvFileProgress)       \
+	AGS_METHOD  (Socket, BeginBatch, 1)          \
+	AGS_METHOD  (Socket, Flush, 0)               \
 	AGS_METHOD  (Socket, GetOption, 2)           \
-	AGS_METHOD  (Socket, SetOption, 3)
+	AGS_METHOD  (Socket, SetOption, 3)           \
+	AGS_METHOD  (Socket, JoinGroup, 1)           \
+	AGS_METHOD  (Socket, LeaveGroup, 1)
 
 //------------------------------------------------------------------------------
 
@@ -0,0 +1,192 @@
+/*******************************************************************
+ * Socket group interface -- See header file for more information. *
+ *******************************************************************/
+
+#include <algorithm>
+#include <cstring>
+
+#include "SocketGroup.h"
+
+using namespace AGSSockAPI;
+
+namespace AGSSock {
+
+//------------------------------------------------------------------------------
+// Every member gets the same buffer, the payload is never copied per member.
+// A member that fails only has its error recorded; the rest still get sent to.
+
+ags_t SocketGroup::broadcast(const char *buf, size_t count)
+{
+	ags_t sent = 0;
+	errors.assign(members.size(), 0);
+
+	for (size_t i = 0; i < members.size(); ++i)
+	{
+		errors[i] = send_whole(members[i], buf, count);
+		if (!errors[i])
+			sent++;
+	}
+
+	return sent;
+}
+
+//==============================================================================
+
+int AGSSocketGroup::Dispose(const char *ptr, bool force)
+{
+	SocketGroup *group = (SocketGroup *) ptr;
+
+	for (Socket *sock : group->members)
+		AGS_RELEASE(sock);
+
+	delete group;
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+// Note: the members are stored by key; like the addresses of a socket they
+// are only found back when they were unserialized before the group.
+
+int AGSSocketGroup::Serialize(const char *ptr, char *buffer, int size)
+{
+	const SocketGroup *group = (const SocketGroup *) ptr;
+	int pos = 0;
+
+	for (const Socket *sock : group->members)
+	{
+		if (pos + (int) sizeof (int32_t) > size)
+			break;
+
+		int32_t key = AGS_TO_KEY(sock);
+		memcpy(buffer + pos, &key, sizeof (key));
+		pos += sizeof (key);
+	}
+
+	return pos;
+}
+
+//------------------------------------------------------------------------------
+
+void AGSSocketGroup::Unserialize(int key, const char *buffer, int size)
+{
+	SocketGroup *group = new SocketGroup();
+
+	for (int pos = 0; pos + (int) sizeof (int32_t) <= size; pos += sizeof (int32_t))
+	{
+		int32_t member;
+		memcpy(&member, buffer + pos, sizeof (member));
+
+		Socket *sock = AGS_FROM_KEY(Socket, member);
+		if (sock != nullptr)
+		{
+			AGS_HOLD(sock);
+			group->members.push_back(sock);
+		}
+	}
+
+	AGS_RESTORE(SocketGroup, group, key);
+}
+
+//==============================================================================
+
+SocketGroup *SocketGroup_Create()
+{
+	SocketGroup *group = new SocketGroup();
+	AGS_OBJECT(SocketGroup, group);
+	return group;
+}
+
+//------------------------------------------------------------------------------
+
+ags_t SocketGroup_Add(SocketGroup *group, Socket *sock)
+{
+	if (sock == nullptr)
+		return 0;
+
+	auto &members = group->members;
+	if (std::find(members.begin(), members.end(), sock) != members.end())
+		return 0;
+
+	AGS_HOLD(sock);
+	members.push_back(sock);
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+
+ags_t SocketGroup_Remove(SocketGroup *group, Socket *sock)
+{
+	auto &members = group->members;
+	auto it = std::find(members.begin(), members.end(), sock);
+	if (it == members.end())
+		return 0;
+
+	// Keep the errors of the other members where they were
+	if (group->errors.size() == members.size())
+		group->errors.erase(group->errors.begin() + (it - members.begin()));
+
+	members.erase(it);
+	AGS_RELEASE(sock);
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+
+void SocketGroup_Clear(SocketGroup *group)
+{
+	for (Socket *sock : group->members)
+		AGS_RELEASE(sock);
+
+	group->members.clear();
+	group->errors.clear();
+}
+
+//------------------------------------------------------------------------------
+
+ags_t SocketGroup_get_Count(SocketGroup *group)
+{
+	return group->members.size();
+}
+
+//------------------------------------------------------------------------------
+
+Socket *SocketGroup_geti_Members(SocketGroup *group, ags_t index)
+{
+	if (index < 0 || (size_t) index >= group->members.size())
+		return nullptr;
+
+	return group->members[index];
+}
+
+//------------------------------------------------------------------------------
+
+ags_t SocketGroup_geti_Errors(SocketGroup *group, ags_t index)
+{
+	if (index < 0 || (size_t) index >= group->errors.size())
+		return AGSSOCK_NO_ERROR;
+
+	return AGSEnumerateError(group->errors[index]);
+}
+
+//------------------------------------------------------------------------------
+
+ags_t SocketGroup_Broadcast(SocketGroup *group, const char *str)
+{
+	return group->broadcast(str, strlen(str));
+}
+
+//------------------------------------------------------------------------------
+
+ags_t SocketGroup_BroadcastData(SocketGroup *group, const SockData *data)
+{
+	if (data == nullptr)
+		return 0;
+
+	return group->broadcast(data->bytes(), data->size());
+}
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+//..............................................................................
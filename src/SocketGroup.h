@@ -0,0 +1,104 @@
+/*******************************************************
+ * Socket group interface -- header file               *
+ *                                                     *
+ * Author: Ferry "Wyz" Timmers                         *
+ *                                                     *
+ * Date: 11:42 2026-10-18                              *
+ *                                                     *
+ * Description: Sends the same data to many sockets    *
+ *              with a single script call.             *
+ *******************************************************/
+
+#ifndef _SOCKETGROUP_H
+#define _SOCKETGROUP_H
+
+#include <vector>
+
+#include "API.h"
+#include "SockData.h"
+#include "Socket.h"
+
+namespace AGSSock {
+
+//------------------------------------------------------------------------------
+
+//! A set of sockets that data is broadcast to
+
+//! The group holds a reference to each member. The errors of the last
+//! broadcast are kept per member, in the same order.
+struct SocketGroup
+{
+	std::vector<Socket *> members;
+	std::vector<int> errors;
+
+	//! Sends the data to every member; returns the number that succeeded
+	ags_t broadcast(const char *buf, size_t count);
+};
+
+AGS_DEFINE_CLASS(SocketGroup)
+
+//------------------------------------------------------------------------------
+
+SocketGroup *SocketGroup_Create();
+
+ags_t SocketGroup_Add(SocketGroup *, Socket *);
+ags_t SocketGroup_Remove(SocketGroup *, Socket *);
+void SocketGroup_Clear(SocketGroup *);
+ags_t SocketGroup_get_Count(SocketGroup *);
+Socket *SocketGroup_geti_Members(SocketGroup *, ags_t index);
+ags_t SocketGroup_geti_Errors(SocketGroup *, ags_t index);
+
+ags_t SocketGroup_Broadcast(SocketGroup *, const char *);
+ags_t SocketGroup_BroadcastData(SocketGroup *, const SockData *);
+
+//------------------------------------------------------------------------------
+
+} /* namespace AGSSock */
+
+//------------------------------------------------------------------------------
+//                           Plugin interface
+
+#define SOCKETGROUP_HEADER \
+	"\r\n" \
+	"managed struct SocketGroup\r\n" \
+	"{\r\n" \
+	"	/// Creates an empty group of sockets to send the same data to.\r\n" \
+	"	import static SocketGroup *Create(); // $AUTOCOMPLETESTATICONLY$\r\n" \
+	"	\r\n" \
+	"	/// Adds a socket to the group. Returns false if it already is a member.\r\n" \
+	"	import bool Add(Socket *sock);\r\n" \
+	"	/// Removes a socket from the group. Returns whether it was a member.\r\n" \
+	"	import bool Remove(Socket *sock);\r\n" \
+	"	/// Removes all sockets from the group.\r\n" \
+	"	import void Clear();\r\n" \
+	"	\r\n" \
+	"	/// The number of sockets in the group.\r\n" \
+	"	readonly import attribute int Count;\r\n" \
+	"	/// The sockets in the group.\r\n" \
+	"	readonly import attribute Socket *Members[];\r\n" \
+	"	/// The error of each member during the last broadcast. (eSockNoError when it succeeded)\r\n" \
+	"	readonly import attribute SockError Errors[];\r\n" \
+	"	\r\n" \
+	"	/// Sends a string to all members. Returns the number of members that got it; a failing member does not stop the rest.\r\n" \
+	"	import int Broadcast(const string msg);\r\n" \
+	"	/// Sends raw data to all members. Returns the number of members that got it; a failing member does not stop the rest.\r\n" \
+	"	import int BroadcastData(SockData *data);\r\n" \
+	"};\r\n"
+
+#define SOCKETGROUP_ENTRY	                     \
+	AGS_CLASS   (SocketGroup)                    \
+	AGS_METHOD  (SocketGroup, Create, 0)         \
+	AGS_METHOD  (SocketGroup, Add, 1)            \
+	AGS_METHOD  (SocketGroup, Remove, 1)         \
+	AGS_METHOD  (SocketGroup, Clear, 0)          \
+	AGS_READONLY(SocketGroup, Count)             \
+	AGS_INDEXED (SocketGroup, Members)           \
+	AGS_INDEXED (SocketGroup, Errors)            \
+	AGS_METHOD  (SocketGroup, Broadcast, 1)      \
+	AGS_METHOD  (SocketGroup, BroadcastData, 1)
+
+//------------------------------------------------------------------------------
+
+#endif /* _SOCKETGROUP_H */
+
+//..............................................................................
@@ -20,9 +20,13 @@
 #define AGSMAIN
 
 #include "API.h"
+#include "PeerTable.h"
+#include "SharedRing.h"
 #include "SockData.h"
+#include "SockSession.h"
 #include "SockAddr.h"
 #include "Socket.h"
+#include "SocketGroup.h"
 #include "agsplugin.h"
 #include "version.h"
 
@@ -66,7 +70,9 @@ BOOL APIENTRY DllMain(HINSTANCE hInst, DWORD reason, LPVOID reserved)
 
 IAGSEditor *editor; // Editor interface
 
-const char *ourScriptHeader = SOCKDATA_HEADER SOCKADDR_HEADER SOCKET_HEADER;
+const char *ourScriptHeader = SOCKDATA_HEADER SOCKADDR_HEADER PEERTABLE_HEADER
+	SOCKET_HEADER
+	SOCKETGROUP_HEADER SHAREDRING_HEADER SOCKSESSION_HEADER;
 
 //------------------------------------------------------------------------------
 
@@ -138,7 +144,11 @@ void AGS_EngineStartup(IAGSEngine *lpEngine)
 	// Register functions
 	SOCKDATA_ENTRY
 	SOCKADDR_ENTRY
+	PEERTABLE_ENTRY
 	SOCKET_ENTRY
+	SOCKETGROUP_ENTRY
+	SHAREDRING_ENTRY
+	SOCKSESSION_ENTRY
 }
 
 //------------------------------------------------------------------------------
@@ -150,29 +160,17 @@ void AGS_EngineShutdown()
 }
 
 //------------------------------------------------------------------------------
-/*
+// Note: the engine only calls this for the events requested by the plugin.
+
 int AGS_EngineOnEvent(int event, int data)
 {
 	switch (event)
 	{
-		case AGSE_KEYPRESS:
-		case AGSE_MOUSECLICK:
-		case AGSE_POSTSCREENDRAW:
-		case AGSE_PRESCREENDRAW:
-		case AGSE_SAVEGAME:
-		case AGSE_RESTOREGAME:
-		case AGSE_PREGUIDRAW:
-		case AGSE_LEAVEROOM:
-		case AGSE_ENTERROOM:
-		case AGSE_TRANSITIONIN:
-		case AGSE_TRANSITIONOUT:
 		case AGSE_FINALSCREENDRAW:
-		case AGSE_TRANSLATETEXT:
-		case AGSE_SCRIPTDEBUG:
-		case AGSE_SPRITELOAD:
-		case AGSE_PRERENDER:
-		case AGSE_PRESAVEGAME:
-		case AGSE_POSTRESTOREGAME:
+			// The frame is done: send what it batched
+			FlushBatches();
+			break;
+		
 		default:
 			break;
 	}
@@ -180,7 +178,7 @@ int AGS_EngineOnEvent(int event, int data)
 	// Return 1 to stop event from processing further (when needed)
 	return (0);
 }
-*/
+
 //------------------------------------------------------------------------------
 /*
 int AGS_EngineDebugHook(const char *scriptName, int lineNum, int reserved) {}
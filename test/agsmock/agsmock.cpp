@@ -84,6 +84,22 @@ void UnloadPlugins()
 	plugins.clear();
 }
 
+void SendEvent(int event, int data)
+{
+	if (!engine->hooked(event))
+		return;
+
+	// A plugin that returns non-zero stops the event from going further
+	for (unique_ptr<Library> &plugin : plugins)
+	{
+		int (*EngineOnEvent)(int, int);
+
+		if (plugin->bind(&EngineOnEvent, "AGS_EngineOnEvent")
+			&& EngineOnEvent(event, data))
+			break;
+	}
+}
+
 //------------------------------------------------------------------------------
 
 void *GetFunction(const char *name)
@@ -57,6 +57,8 @@ void Terminate();
 
 void LoadPlugin(const char *name);
 void UnloadPlugins();
+//! Lets the plugins that requested an engine event (AGSE_*) handle it
+void SendEvent(int event, int data = 0);
 
 void *GetFunction(const char *name);
 template <typename T, typename... Args> T Call(const char *name, Args... args)
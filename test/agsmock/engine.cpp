@@ -57,6 +57,7 @@ struct MockEngine::Data
 	unordered_map<string, IAGSManagedObjectReader *> readers;
 	unordered_map<string, void *> functions;
 	unordered_map<void *, Resource> objects;
+	int events = 0;
 
 	static int get_unique_key()
 	{
@@ -127,6 +128,11 @@ void MockEngine::free_all()
 	data_->objects.clear();
 }
 
+bool MockEngine::hooked(int event) const
+{
+	return (data_->events & event) != 0;
+}
+
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
 
 void MockEngine::AbortGame(const char *reason)
@@ -134,6 +140,11 @@ void MockEngine::AbortGame(const char *reason)
 	throw GameAborted(reason);
 }
 
+void MockEngine::RequestEventHook(int32 event)
+{
+	data_->events |= event;
+}
+
 void MockEngine::RegisterScriptFunction(const char *name, void *address)
 {
 	data_->functions[name] = address;
@@ -41,6 +41,9 @@ class MockEngine : public IAGSEngine
 	void *get_function(const char *);
 	void free(void *object, bool force = false);
 	void free_all();
+	bool hooked(int event) const; //!< Whether a plugin requested the event
+
+	AGSIFUNC(void) RequestEventHook(int32 event);
 
 	AGSIFUNC(void) AbortGame(const char *reason);
 	AGSIFUNC(void) RegisterScriptFunction(const char *name, void *address);
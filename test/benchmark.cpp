@@ -0,0 +1,348 @@
+/*******************************************************
+ * Benchmarks -- header file                           *
+ *                                                     *
+ * Author: Ferry "Wyz" Timmers                         *
+ *                                                     *
+ * Date: 11:31 2026-10-18                              *
+ *                                                     *
+ * Description: Measures the throughput of the data    *
+ *              processing functions and the local     *
+ *              transports of the plugin.              *
+ *              Not part of the test suite; run it     *
+ *              manually on a release build.           *
+ *******************************************************/
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The plugin entry is not linked in, so the script classes are defined here
+#define AGSMAIN
+
+#include "Codec.h"
+#include "Compress.h"
+#include "SharedRing.h"
+#include "SockSession.h"
+
+using namespace AGSSock;
+
+using std::string;
+
+//------------------------------------------------------------------------------
+
+string binary_sample(size_t size)
+{
+	string data(size, '\0');
+	for (size_t i = 0; i < size; ++i)
+		data[i] = (char) ((i * 167 + 13) ^ (i >> 8));
+	return data;
+}
+
+//------------------------------------------------------------------------------
+
+//! Runs a function repeatedly for about half a second and prints the
+//! throughput in megabytes per second with respect to the given size.
+void measure(const char *description, size_t size, std::function<void()> func)
+{
+	using clock = std::chrono::steady_clock;
+	using namespace std;
+
+	size_t runs = 0;
+	clock::time_point start = clock::now(), now;
+	do
+	{
+		for (int i = 0; i < 16; ++i)
+			func();
+		runs += 16;
+		now = clock::now();
+	} while (now - start < chrono::milliseconds(500));
+
+	double seconds = chrono::duration<double>(now - start).count();
+	cout << left << setw(40) << description << right << fixed
+		<< setprecision(1) << setw(10) << (runs * size / seconds / 1e6)
+		<< " MB/s" << setw(10) << (seconds / runs * 1e9) << " ns/op" << endl;
+}
+
+//==============================================================================
+
+void bench_codecs()
+{
+	for (size_t size : {64, 1024, 1 << 20})
+	{
+		string data = binary_sample(size), base64, hex, out;
+		base64_encode(data.data(), data.size(), base64);
+		hex_encode(data.data(), data.size(), hex);
+
+		std::cout << std::endl << "Codecs, " << size << " bytes:" << std::endl;
+
+		measure("base64 encode", size, [&]()
+			{ out.clear(); base64_encode(data.data(), data.size(), out); });
+		measure("base64 decode", size, [&]()
+			{ out.clear(); base64_decode(base64.data(), base64.size(), out); });
+		measure("hex encode", size, [&]()
+			{ out.clear(); hex_encode(data.data(), data.size(), out); });
+		measure("hex decode", size, [&]()
+			{ out.clear(); hex_decode(hex.data(), hex.size(), out); });
+	}
+}
+
+//------------------------------------------------------------------------------
+
+// Generates a game state like message: a list of records that mostly differ
+// in a few fields.
+string snapshot_sample(int entities, int frame)
+{
+	string data;
+	for (int i = 0; i < entities; ++i)
+	{
+		char record[] = "ENT\0\0\0\0\0\0\0\0\0idle";
+		record[3] = (char) i;
+		record[4] = (char) (i * 3 + frame / 8);
+		record[6] = (char) (100 + (i % 5));
+		data.append(record, sizeof (record) - 1);
+	}
+	return data;
+}
+
+void bench_compression()
+{
+	using namespace std;
+
+	string reference = snapshot_sample(64, 0);
+	Dictionary dict(reference.data(), reference.size());
+
+	for (size_t entities : {8, 64, 1024})
+	{
+		string data = snapshot_sample(entities, 40), plain, packed, out;
+		compress(data.data(), data.size(), plain);
+		compress(data.data(), data.size(), packed, &dict);
+
+		cout << endl << "Compression, " << data.size() << " byte snapshot ("
+			<< plain.size() << " bytes, " << packed.size()
+			<< " with dictionary):" << endl;
+
+		measure("compress", data.size(), [&]()
+			{ out.clear(); compress(data.data(), data.size(), out); });
+		measure("compress with dictionary", data.size(), [&]()
+			{ out.clear(); compress(data.data(), data.size(), out, &dict); });
+		measure("decompress", data.size(), [&]()
+		{
+			out.clear();
+			decompress(plain.data(), plain.size(), data.size(), out);
+		});
+		measure("decompress with dictionary", data.size(), [&]()
+		{
+			out.clear();
+			decompress(packed.data(), packed.size(), data.size(), out, &dict);
+		});
+	}
+}
+
+//------------------------------------------------------------------------------
+
+void bench_delta()
+{
+	using namespace std;
+
+	for (size_t entities : {64, 1024, 65536})
+	{
+		string previous = snapshot_sample(entities, 0);
+		string data = snapshot_sample(entities, 40), delta, out;
+		delta_encode(previous.data(), previous.size(), data.data(), data.size(),
+			delta);
+
+		cout << endl << "Delta, " << data.size() << " byte snapshot ("
+			<< delta.size() << " bytes):" << endl;
+
+		measure("delta encode", data.size(), [&]()
+		{
+			out.clear();
+			delta_encode(previous.data(), previous.size(), data.data(),
+				data.size(), out);
+		});
+		measure("delta encode, unchanged", data.size(), [&]()
+		{
+			out.clear();
+			delta_encode(data.data(), data.size(), data.data(), data.size(), out);
+		});
+		measure("delta decode", data.size(), [&]()
+		{
+			out.clear();
+			delta_decode(previous.data(), previous.size(), delta.data(),
+				delta.size(), out);
+		});
+	}
+}
+
+//------------------------------------------------------------------------------
+
+// Messages go to a thread that takes them out as fast as it can (throughput)
+// or that sends each one straight back (round trip). A local socket pair does
+// the same for comparison; it costs a system call on either side.
+void bench_local()
+{
+	using namespace std;
+
+	string name = "agssock-bench-"
+		+ to_string(chrono::steady_clock::now().time_since_epoch().count());
+
+	for (size_t size : {64, 1024, 16384})
+	{
+		string message = binary_sample(size), out(size, '\0');
+		cout << endl << "Local transport, " << size << " byte messages:" << endl;
+
+		{
+			SharedRing sender(name.c_str(), 1 << 20);
+			SharedRing receiver(name.c_str());
+			if (!receiver.valid())
+			{
+				cout << "shared memory is not available" << endl;
+				return;
+			}
+
+			atomic<bool> done(false);
+			thread reader([&]()
+			{
+				string data;
+				while (!done)
+					if (!receiver.receive(data))
+						this_thread::yield();
+			});
+			measure("shared ring", size, [&]()
+			{
+				while (!sender.send(message.data(), size))
+					this_thread::yield();
+			});
+			done = true;
+			reader.join();
+
+			done = false;
+			thread echo([&]()
+			{
+				string data;
+				while (!done)
+					if (receiver.receive(data))
+						receiver.send(data.data(), data.size());
+					else
+						this_thread::yield();
+			});
+			measure("shared ring, round trip", size, [&]()
+			{
+				string data;
+				sender.send(message.data(), size);
+				while (!sender.receive(data))
+					this_thread::yield();
+			});
+			done = true;
+			echo.join();
+		}
+
+#ifndef _WIN32
+		SOCKET pair[2];
+		if (socket_pair(SOCK_DGRAM, pair) == SOCKET_ERROR)
+			continue;
+		int buffer = 1 << 20;
+		setsockopt(pair[0], SOL_SOCKET, SO_SNDBUF, &buffer, sizeof (buffer));
+		setsockopt(pair[1], SOL_SOCKET, SO_RCVBUF, &buffer, sizeof (buffer));
+
+		// The last message lets the other thread see that it is done
+		atomic<bool> done(false);
+		thread reader([&]()
+		{
+			vector<char> data(size);
+			do
+				recv(pair[1], data.data(), size, 0);
+			while (!done);
+		});
+		measure("socket pair", size, [&]()
+			{ send(pair[0], message.data(), size, 0); });
+		done = true;
+		send(pair[0], message.data(), size, 0);
+		reader.join();
+
+		done = false;
+		thread echo([&]()
+		{
+			vector<char> data(size);
+			do
+			{
+				long ret = recv(pair[1], data.data(), size, 0);
+				send(pair[1], data.data(), ret, 0);
+			} while (!done);
+		});
+		measure("socket pair, round trip", size, [&]()
+		{
+			send(pair[0], message.data(), size, 0);
+			recv(pair[0], &out[0], size, 0);
+		});
+		done = true;
+		send(pair[0], message.data(), size, 0);
+		recv(pair[0], &out[0], size, 0);
+		echo.join();
+
+		closesocket(pair[0]);
+		closesocket(pair[1]);
+#endif
+	}
+}
+
+//------------------------------------------------------------------------------
+
+// Per packet cost of sealing game sized datagrams. Every opened packet has to
+// be new to the session, so opening is measured together with sealing.
+void bench_crypto()
+{
+	using namespace std;
+
+	string key = binary_sample(CRYPTO_KEY_SIZE);
+	SockSession client(key.data(), false), server(key.data(), true);
+
+	for (size_t size : {100, 300, 500})
+	{
+		string data = binary_sample(size), sealed, out;
+
+		cout << endl << "Sealing, " << size << " bytes:" << endl;
+
+		measure("seal", size, [&]()
+			{ client.seal(data.data(), data.size(), sealed); });
+		measure("seal and open", size, [&]()
+		{
+			client.seal(data.data(), data.size(), sealed);
+			server.open(sealed.data(), sealed.size(), out);
+		});
+	}
+
+	const std::uint8_t *bytes =
+		reinterpret_cast<const std::uint8_t *> (key.data());
+	string data = binary_sample(1 << 16), out(data.size(), '\0');
+
+	cout << endl << "ChaCha20, " << data.size() << " bytes:" << endl;
+
+	measure(chacha20_implementation(), data.size(), [&]()
+		{ chacha20_xor(bytes, bytes, 0, data.data(), &out[0], data.size()); });
+	measure("scalar", data.size(), [&]()
+	{
+		chacha20_xor_scalar(bytes, bytes, 0, data.data(), &out[0],
+			data.size());
+	});
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char const *argv[])
+{
+	bench_codecs();
+	bench_compression();
+	bench_delta();
+	bench_local();
+	bench_crypto();
+	return EXIT_SUCCESS;
+}
+
+//..............................................................................
@@ -87,6 +87,65 @@ Test test2("buffers with stream inputs", []()
 	return true;
 });
 
+//------------------------------------------------------------------------------
+
+Test test3("buffers with datagram sources", []()
+{
+	Buffer buffer;
+
+	SOCKADDR_STORAGE first = {}, second = {};
+	first.ss_family = AF_INET;
+	second.ss_family = AF_INET6;
+
+	buffer.push("ABC", 3, first);
+	buffer.push("DEF", 3, second);
+	buffer.push("XYZ", 3);
+
+	EXPECT(buffer.front() == "ABC");
+	EXPECT(buffer.source().ss_family == AF_INET);
+	buffer.pop();
+
+	EXPECT(buffer.front() == "DEF");
+	EXPECT(buffer.source().ss_family == AF_INET6);
+	buffer.pop();
+
+	// Data without a source has an empty address
+	EXPECT(buffer.front() == "XYZ");
+	EXPECT(buffer.source().ss_family == 0);
+	buffer.pop();
+	EXPECT(buffer.empty());
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test4("buffers with coalesced datagrams", []()
+{
+	Buffer buffer;
+
+	SOCKADDR_STORAGE source = {};
+	source.ss_family = AF_INET;
+
+	buffer.split("AAABBBCC", 8, 3, source);
+	buffer.split("XYZ", 3, 0, source);
+	buffer.split("", 0, 3, source);
+
+	const char *expected[] = {"AAA", "BBB", "CC", "XYZ", ""};
+	for (const char *datagram : expected)
+	{
+		EXPECT(!buffer.empty());
+		EXPECT(buffer.front() == datagram);
+		EXPECT(buffer.source().ss_family == AF_INET);
+		buffer.pop();
+	}
+	EXPECT(buffer.empty());
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
 int main(int argc, char const *argv[])
 {
 	return Test::run_tests() ? EXIT_SUCCESS : EXIT_FAILURE;
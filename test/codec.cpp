@@ -0,0 +1,519 @@
+/*******************************************************
+ * Data codec tests -- header file                     *
+ *                                                     *
+ * Author: Ferry "Wyz" Timmers                         *
+ *                                                     *
+ * Date: 11:05 2026-10-18                              *
+ *                                                     *
+ * Description: Testing the data codec functions       *
+ *******************************************************/
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "Codec.h"
+#include "Compress.h"
+#include "Crypto.h"
+#include "Test.h"
+
+using namespace AGSSock;
+
+using std::string;
+
+//------------------------------------------------------------------------------
+
+#define SUNSCREEN "Ladies and Gentlemen of the class of '99: If I could " \
+	"offer you only one tip for the future, sunscreen would be it."
+
+string from_hex(const char *str)
+{
+	string data;
+	hex_decode(str, strlen(str), data);
+	return data;
+}
+
+const std::uint8_t *bytes(const string &data)
+{
+	return reinterpret_cast<const std::uint8_t *> (data.data());
+}
+
+//------------------------------------------------------------------------------
+
+string binary_sample(size_t size)
+{
+	string data(size, '\0');
+	for (size_t i = 0; i < size; ++i)
+		data[i] = (char) ((i * 167 + 13) ^ (i >> 8));
+	return data;
+}
+
+//------------------------------------------------------------------------------
+
+Test test1("base64 test vectors", []()
+{
+	// RFC 4648 section 10
+	const char *vectors[][2] =
+	{
+		{"", ""}, {"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"},
+		{"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"}
+	};
+
+	for (auto &vector : vectors)
+	{
+		string str, data;
+		base64_encode(vector[0], strlen(vector[0]), str);
+		EXPECT(str == vector[1]);
+		EXPECT(base64_decode(str.data(), str.size(), data));
+		EXPECT(data == vector[0]);
+	}
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test2("base64 validation", []()
+{
+	const char *invalid[] =
+	{
+		"Z", "Zg", "Zg=", "Zg===", "Z===", "Zh==", "Zm9=", "Zm=v", "Zg==Zg==",
+		"Zm9v\n", "Zm 9v", "Zm9-", "Zm9_", "====", "Zm9v\xC3\xA9=="
+	};
+
+	for (const char *str : invalid)
+	{
+		string data;
+		EXPECT(!base64_decode(str, strlen(str), data));
+	}
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test3("hex test vectors", []()
+{
+	{
+		string str;
+		hex_encode("\x00\x01\x7F\x80\xFF", 5, str);
+		EXPECT(str == "00017f80ff");
+	}
+
+	{
+		string data;
+		EXPECT(hex_decode("DEADbeef", 8, data));
+		EXPECT(data == "\xDE\xAD\xBE\xEF");
+	}
+
+	const char *invalid[] =
+	{
+		"0", "0g", "g0", "0x00", " 0", "0:", "0@", "0`", "0G",
+		"000000000000000000000000000000000000000000000000000000000000000G",
+		// Digits with the lower case bit cleared are control characters
+		"\x10\x11", "0\x19",
+		"\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19\x10\x11\x12\x13\x14\x15"
+		"\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19\x10\x11\x12\x13\x14\x15"
+	};
+
+	for (const char *str : invalid)
+	{
+		string data;
+		EXPECT(!hex_decode(str, strlen(str), data));
+	}
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test4("codec round trips", []()
+{
+	// Cover both the vectorised and the scalar (tail) code paths
+	for (size_t size = 0; size < 300; ++size)
+	{
+		string data = binary_sample(size), str, copy;
+
+		base64_encode(data.data(), data.size(), str);
+		EXPECT(str.size() == (size + 2) / 3 * 4);
+		EXPECT(base64_decode(str.data(), str.size(), copy));
+		EXPECT(copy == data);
+
+		str.clear();
+		copy.clear();
+
+		hex_encode(data.data(), data.size(), str);
+		EXPECT(str.size() == size * 2);
+		EXPECT(hex_decode(str.data(), str.size(), copy));
+		EXPECT(copy == data);
+
+		// Upper case input is accepted as well
+		for (char &c : str)
+			if (c >= 'a' && c <= 'f')
+				c -= 'a' - 'A';
+		copy.clear();
+		EXPECT(hex_decode(str.data(), str.size(), copy));
+		EXPECT(copy == data);
+	}
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+// Generates a game state like message: a list of records that mostly differ
+// in a few fields.
+string snapshot_sample(int entities, int frame)
+{
+	string data;
+	for (int i = 0; i < entities; ++i)
+	{
+		char record[] = "ENT\0\0\0\0\0\0\0\0\0idle";
+		record[3] = (char) i;
+		record[4] = (char) (i * 3 + frame / 8);
+		record[6] = (char) (100 + (i % 5));
+		data.append(record, sizeof (record) - 1);
+	}
+	return data;
+}
+
+//------------------------------------------------------------------------------
+
+Test test5("compression round trips", []()
+{
+	string samples[] =
+	{
+		string(), string("a"), string("abcdefghijkl"), string(1000, 'x'),
+		binary_sample(100), binary_sample(70000), snapshot_sample(64, 0),
+		string(200000, '\0') + binary_sample(100)
+	};
+
+	for (string &data : samples)
+	{
+		string packed, copy;
+		compress(data.data(), data.size(), packed);
+		EXPECT(packed.size() <= data.size() + data.size() / 255 + 16);
+		EXPECT(decompress(packed.data(), packed.size(), data.size(), copy));
+		EXPECT(copy == data);
+
+		// The size must match exactly
+		copy.clear();
+		EXPECT(!decompress(packed.data(), packed.size(), data.size() + 1, copy));
+		if (data.size() > 0)
+		{
+			copy.clear();
+			EXPECT(!decompress(packed.data(), packed.size(), data.size() - 1,
+				copy));
+		}
+	}
+
+	// Repetitive data should compress well
+	{
+		string data(1000, 'x'), packed;
+		compress(data.data(), data.size(), packed);
+		EXPECT(packed.size() < 20);
+	}
+
+	// A single match may be as long as the output (here over 64 MiB)
+	{
+		string data((size_t) 68 << 20, '\0'), packed, copy;
+		compress(data.data(), data.size(), packed);
+		EXPECT(decompress(packed.data(), packed.size(), data.size(), copy));
+		EXPECT(copy == data);
+	}
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test6("compression with dictionaries", []()
+{
+	string reference = snapshot_sample(64, 0);
+	Dictionary dict(reference.data(), reference.size());
+
+	string data = snapshot_sample(64, 40), plain, packed, copy;
+	compress(data.data(), data.size(), plain);
+	compress(data.data(), data.size(), packed, &dict);
+
+	EXPECT(packed.size() < plain.size());
+	EXPECT(decompress(packed.data(), packed.size(), data.size(), copy, &dict));
+	EXPECT(copy == data);
+
+	// Without or with a different dictionary the data cannot be recovered
+	copy.clear();
+	EXPECT(!decompress(packed.data(), packed.size(), data.size(), copy)
+		|| copy != data);
+
+	string other = binary_sample(reference.size());
+	Dictionary wrong(other.data(), other.size());
+	copy.clear();
+	EXPECT(!decompress(packed.data(), packed.size(), data.size(), copy, &wrong)
+		|| copy != data);
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test7("decompressing corrupted data", []()
+{
+	string data = snapshot_sample(64, 0), packed;
+	compress(data.data(), data.size(), packed);
+
+	// Every truncation and a selection of bit flips must fail cleanly
+	for (size_t size = 0; size < packed.size(); ++size)
+	{
+		string copy;
+		EXPECT(!decompress(packed.data(), size, data.size(), copy));
+	}
+
+	for (size_t i = 0; i < packed.size() * 8; i += 3)
+	{
+		string corrupt = packed, copy;
+		corrupt[i / 8] ^= 1 << (i % 8);
+		decompress(corrupt.data(), corrupt.size(), data.size(), copy);
+	}
+
+	// Matches referring before the start of the data are rejected
+	{
+		const char bad[] = "\x10" "a" "\x02\x00";
+		string copy;
+		EXPECT(!decompress(bad, 4, 5, copy));
+	}
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test8("stream compression", []()
+{
+	StreamCompressor deflate;
+	StreamDecompressor inflate;
+
+	// Messages that resemble earlier ones compress well
+	string stream, packed;
+	for (int frame = 0; frame < 64; ++frame)
+	{
+		string data = snapshot_sample(64, frame);
+		size_t before = packed.size();
+		deflate.compress(data.data(), data.size(), packed);
+		if (frame > 0)
+			EXPECT(packed.size() - before < data.size() / 2);
+		stream += data;
+	}
+
+	// Large parts are split into several frames
+	string large = binary_sample(200000);
+	deflate.compress(large.data(), large.size(), packed);
+	stream += large;
+
+	// The compressed stream may arrive in parts of any size
+	string copy;
+	for (size_t pos = 0, step = 1; pos < packed.size(); pos += step, step += 7)
+	{
+		step = std::min(step, packed.size() - pos);
+		EXPECT(inflate.decompress(packed.data() + pos, step, copy));
+	}
+	EXPECT(copy == stream);
+
+	// A corrupted stream is detected
+	StreamDecompressor corrupted;
+	string garbage(64, '\xFF');
+	EXPECT(!corrupted.decompress(garbage.data(), garbage.size(), copy));
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test9("variable length integers", []()
+{
+	std::uint64_t values[] = {0, 1, 127, 128, 300, 65535, 1ULL << 32, ~0ULL};
+
+	for (std::uint64_t value : values)
+	{
+		string str;
+		varint_encode(value, str);
+
+		size_t pos = 0;
+		std::uint64_t result;
+		EXPECT(varint_decode(str.data(), str.size(), pos, result));
+		EXPECT(result == value && pos == str.size());
+
+		pos = 0;
+		EXPECT(!varint_decode(str.data(), str.size() - 1, pos, result));
+	}
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test10("delta encoding", []()
+{
+	string previous = snapshot_sample(64, 0);
+	string samples[] =
+	{
+		string(), previous, snapshot_sample(64, 40), snapshot_sample(32, 40),
+		snapshot_sample(80, 40), binary_sample(previous.size()),
+		previous.substr(0, 100) + "x" + previous.substr(101)
+	};
+
+	for (string &data : samples)
+	{
+		string delta, copy;
+		delta_encode(previous.data(), previous.size(), data.data(), data.size(),
+			delta);
+		EXPECT(delta_decode(previous.data(), previous.size(), delta.data(),
+			delta.size(), copy));
+		EXPECT(copy == data);
+
+		// Truncated deltas never produce the data
+		for (size_t size = 0; size < delta.size(); ++size)
+		{
+			copy.clear();
+			EXPECT(!delta_decode(previous.data(), previous.size(), delta.data(),
+				size, copy) || copy != data || data.empty());
+		}
+	}
+
+	// Only the changes are stored
+	{
+		string data = previous, delta;
+		data[100] = 'x';
+		delta_encode(previous.data(), previous.size(), data.data(), data.size(),
+			delta);
+		EXPECT(delta.size() < 8);
+
+		delta.clear();
+		data = snapshot_sample(64, 40);
+		delta_encode(previous.data(), previous.size(), data.data(), data.size(),
+			delta);
+		EXPECT(delta.size() < data.size() / 2);
+	}
+
+	// Deltas cannot claim more data than they and their base hold
+	{
+		const char bad[] = "\xFF\x01";
+		string copy;
+		EXPECT(!delta_decode(previous.data(), 100, bad, 2, copy));
+	}
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test11("chacha20 test vectors", []()
+{
+	// RFC 8439 section 2.4.2
+	string key = from_hex("000102030405060708090a0b0c0d0e0f"
+		"101112131415161718191a1b1c1d1e1f");
+	string nonce = from_hex("000000000000004a00000000");
+	string text = SUNSCREEN;
+	string cipher = from_hex("6e2e359a2568f98041ba0728dd0d6981e97e7aec1d4360c2"
+		"0a27afccfd9fae0bf91b65c5524733ab8f593dabcd62b3571639d624e65152ab8f53"
+		"0c359f0861d807ca0dbf500d6a6156a38e088a22b65e52bc514d16ccf806818ce91a"
+		"b77937365af90bbf74a35be6b40b8eedf2785e42874d");
+
+	string out(text.size(), '\0');
+	chacha20_xor(bytes(key), bytes(nonce), 1, text.data(), &out[0],
+		text.size());
+	EXPECT(out == cipher);
+	chacha20_xor_scalar(bytes(key), bytes(nonce), 1, out.data(), &out[0],
+		out.size());
+	EXPECT(out == text);
+
+	// Both implementations agree on every length around the block sizes
+	string data = binary_sample(1100);
+	for (size_t size = 0; size <= data.size(); size += size < 300 ? 1 : 61)
+	{
+		string vector(size, '\0'), scalar(size, '\0');
+		chacha20_xor(bytes(key), bytes(nonce), 7, data.data(), &vector[0],
+			size);
+		chacha20_xor_scalar(bytes(key), bytes(nonce), 7, data.data(),
+			&scalar[0], size);
+		EXPECT(vector == scalar);
+	}
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test12("poly1305 test vectors", []()
+{
+	// RFC 8439 section 2.5.2
+	string key = from_hex("85d6be7857556d337f4452fe42d506a8"
+		"0103808afb0db2fd4abff6af4149f51b");
+	string tag = from_hex("a8061dc1305136c6c22b8baf0c0127a9");
+	string text = "Cryptographic Forum Research Group";
+
+	std::uint8_t out[16];
+	Poly1305 whole(bytes(key));
+	whole.update(text.data(), text.size());
+	whole.finish(out);
+	EXPECT(string((char *) out, 16) == tag);
+
+	// Split over several updates
+	Poly1305 parts(bytes(key));
+	parts.update(text.data(), 5);
+	parts.update(text.data() + 5, 20);
+	parts.update(text.data() + 25, text.size() - 25);
+	parts.finish(out);
+	EXPECT(string((char *) out, 16) == tag);
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test13("aead test vectors", []()
+{
+	// RFC 8439 section 2.8.2
+	string key = from_hex("808182838485868788898a8b8c8d8e8f"
+		"909192939495969798999a9b9c9d9e9f");
+	string nonce = from_hex("070000004041424344454647");
+	string aad = from_hex("50515253c0c1c2c3c4c5c6c7");
+	string text = SUNSCREEN;
+	string cipher = from_hex("d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fe"
+		"a9e2b5a736ee62d63dbea45e8ca9671282fafb69da92728b1a71de0a9e060b2905d6"
+		"a5b67ecd3b3692ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b"
+		"4831d7bc3ff4def08e4b7a9de576d26586cec64b6116");
+	string tag = from_hex("1ae10b594f09e26a7e902ecbd0600691");
+
+	string out(text.size(), '\0');
+	std::uint8_t mac[16];
+	aead_seal(bytes(key), bytes(nonce), aad.data(), aad.size(), text.data(),
+		text.size(), &out[0], mac);
+	EXPECT(out == cipher);
+	EXPECT(string((char *) mac, 16) == tag);
+
+	string plain(cipher.size(), '\0');
+	EXPECT(aead_open(bytes(key), bytes(nonce), aad.data(), aad.size(),
+		cipher.data(), cipher.size(), &plain[0], bytes(tag)));
+	EXPECT(plain == text);
+
+	// Any change is caught, and nothing is decrypted then
+	string tampered = cipher;
+	tampered[40] ^= 1;
+	plain.assign(cipher.size(), '\0');
+	EXPECT(!aead_open(bytes(key), bytes(nonce), aad.data(), aad.size(),
+		tampered.data(), tampered.size(), &plain[0], bytes(tag)));
+	EXPECT(plain == string(cipher.size(), '\0'));
+	EXPECT(!aead_open(bytes(key), bytes(nonce), aad.data(), aad.size() - 1,
+		cipher.data(), cipher.size(), &plain[0], bytes(tag)));
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char const *argv[])
+{
+	return Test::run_tests() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//..............................................................................
@@ -11,6 +11,9 @@
 #include <algorithm>
 #include <iostream>
 
+// The plugin entry is not linked in, so the script classes are defined here
+#define AGSMAIN
+
 #include "Socket.h"
 #include "Pool.h"
 #include "API.h"
@@ -0,0 +1,365 @@
+/*******************************************************
+ * Reliable channel tests -- header file               *
+ *                                                     *
+ * Author: Ferry "Wyz" Timmers                         *
+ *                                                     *
+ * Date: 15:20 2026-10-18                              *
+ *                                                     *
+ * Description: Testing the reliability layer over a   *
+ *              simulated link that loses, reorders    *
+ *              and delays packets                     *
+ *******************************************************/
+
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// The plugin entry is not linked in, so the script classes are defined here
+#define AGSMAIN
+
+#include "Buffer.h"
+#include "Reliable.h"
+#include "Test.h"
+
+using namespace AGSSock;
+
+using std::string;
+using std::vector;
+using Clock = Reliable::Clock;
+using std::chrono::milliseconds;
+
+//------------------------------------------------------------------------------
+
+struct Host
+{
+	Reliable layer;
+	SOCKADDR_STORAGE addr;
+	Buffer incoming;
+
+	explicit Host(unsigned short port) : addr()
+	{
+		sockaddr_in &in = reinterpret_cast<sockaddr_in &> (addr);
+		in.sin_family = AF_INET;
+		in.sin_port = htons(port);
+		in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	}
+
+	//! Takes all messages that were handed over
+	vector<string> take()
+	{
+		vector<string> messages;
+		for (; !incoming.empty(); incoming.pop())
+			messages.push_back(incoming.front());
+		return messages;
+	}
+};
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+// Carries packets between two hosts after a delay; lose may drop any of them
+struct Link
+{
+	struct Flight
+	{
+		Clock::time_point arrival;
+		Host *to;
+		const Host *from;
+		string data;
+	};
+
+	Host a {1}, b {2};
+	Clock::time_point now;
+	Clock::duration delay = milliseconds(10);
+	std::function<bool()> lose = []() { return false; };
+	vector<Flight> flights;
+	bool answered = true;
+
+	void post(const Host &from, Host &to, const string &packet)
+	{
+		if (!lose())
+			flights.push_back(Flight {now + delay, &to, &from, packet});
+	}
+
+	bool send(Host &from, Host &to, int delivery, int channel,
+		const string &message)
+	{
+		string packet;
+		if (!from.layer.send(to.addr, delivery, channel, message.data(),
+			message.size(), packet, now))
+			return false;
+		post(from, to, packet);
+		return true;
+	}
+
+	//! Moves time forward, handing over what arrived and sending what is due
+	void step(Clock::duration time = milliseconds(1))
+	{
+		now += time;
+
+		vector<Flight> landed;
+		for (auto it = flights.begin(); it != flights.end();)
+			if (it->arrival <= now)
+			{
+				landed.push_back(*it);
+				it = flights.erase(it);
+			}
+			else
+				++it;
+
+		for (Flight &flight : landed)
+			flight.to->layer.receive(flight.data.data(), flight.data.size(), 0,
+				flight.from->addr, flight.to->incoming, now);
+
+		for (Host *host : {&a, &b})
+		{
+			Host &other = host == &a ? b : a;
+			vector<Reliable::Packet> packets;
+			if (now < host->layer.deadline())
+				continue;
+			if (!host->layer.poll(now, packets))
+				answered = false;
+			for (Reliable::Packet &packet : packets)
+				post(*host, other, packet.data);
+		}
+	}
+
+	void run(Clock::duration time)
+	{
+		for (Clock::time_point end = now + time; now < end;)
+			step();
+	}
+};
+
+//------------------------------------------------------------------------------
+
+Test test1("ordered messages over a lossy link", []()
+{
+	Link link;
+	int count = 0;
+	link.lose = [&count]() { return ++count % 3 == 0; };
+
+	for (int i = 0; i < 200; ++i)
+	{
+		EXPECT(link.send(link.a, link.b, Reliable::ORDERED, 0,
+			std::to_string(i)));
+		link.step();
+	}
+	link.run(milliseconds(20000));
+
+	vector<string> messages = link.b.take();
+	EXPECT(messages.size() == 200);
+	for (int i = 0; i < 200; ++i)
+		EXPECT(messages[i] == std::to_string(i));
+
+	// Everything was acknowledged: nothing is left to resend
+	EXPECT(link.answered);
+	EXPECT(link.a.layer.deadline() - link.now > Reliable::MAX_TIMEOUT);
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test2("unordered messages arrive once", []()
+{
+	Link link;
+
+	for (int i = 0; i < 50; ++i)
+		EXPECT(link.send(link.a, link.b, Reliable::RELIABLE, 0,
+			std::to_string(i)));
+
+	// Reverse and duplicate every packet
+	vector<Link::Flight> flights(link.flights.rbegin(), link.flights.rend());
+	link.flights = flights;
+	link.flights.insert(link.flights.end(), flights.begin(), flights.end());
+	link.run(milliseconds(1000));
+
+	vector<string> messages = link.b.take();
+	EXPECT(messages.size() == 50);
+	EXPECT(messages.front() == "49");
+	vector<bool> seen(50);
+	for (const string &message : messages)
+	{
+		int i = std::atoi(message.c_str());
+		EXPECT(!seen[i]);
+		seen[i] = true;
+	}
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test3("sequenced messages drop older ones", []()
+{
+	Link link;
+
+	for (int i = 0; i < 4; ++i)
+		EXPECT(link.send(link.a, link.b, Reliable::SEQUENCED, 0,
+			std::to_string(i)));
+	std::swap(link.flights[1], link.flights[2]);
+	link.flights.erase(link.flights.begin() + 3);
+	link.run(milliseconds(1000));
+
+	// 0 and 2 arrive, 1 is too late and 3 is lost for good
+	vector<string> messages = link.b.take();
+	EXPECT(messages.size() == 2);
+	EXPECT(messages[0] == "0" && messages[1] == "2");
+
+	// Unreliable messages are handed over as they are
+	EXPECT(link.send(link.a, link.b, Reliable::UNRELIABLE, 0, "x"));
+	EXPECT(link.send(link.a, link.b, Reliable::UNRELIABLE, 0, "y"));
+	std::swap(link.flights[0], link.flights[1]);
+	link.run(milliseconds(100));
+	messages = link.b.take();
+	EXPECT(messages.size() == 2);
+	EXPECT(messages[0] == "y" && messages[1] == "x");
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test4("channels do not wait for each other", []()
+{
+	Link link;
+
+	EXPECT(link.send(link.a, link.b, Reliable::ORDERED, 0, "first"));
+	link.flights.clear();
+	EXPECT(link.send(link.a, link.b, Reliable::ORDERED, 0, "second"));
+	EXPECT(link.send(link.a, link.b, Reliable::ORDERED, 1, "other"));
+	link.run(milliseconds(20));
+
+	// Channel 0 waits for the lost message, channel 1 does not
+	vector<string> messages = link.b.take();
+	EXPECT(messages.size() == 1 && messages[0] == "other");
+
+	link.run(milliseconds(1000));
+	messages = link.b.take();
+	EXPECT(messages.size() == 2);
+	EXPECT(messages[0] == "first" && messages[1] == "second");
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test5("timeout follows the round trip time", []()
+{
+	Link link;
+	link.delay = milliseconds(40);
+
+	EXPECT(link.a.layer.round_trip(link.b.addr) == Clock::duration::zero());
+	for (int i = 0; i < 20; ++i)
+	{
+		EXPECT(link.send(link.a, link.b, Reliable::ORDERED, 0, "ping"));
+		link.run(milliseconds(100));
+	}
+
+	// Twice the delay, plus at most the delay of the acknowledgement
+	Clock::duration rtt = link.a.layer.round_trip(link.b.addr);
+	EXPECT(rtt >= milliseconds(80));
+	EXPECT(rtt <= milliseconds(80) + Reliable::ACK_DELAY + milliseconds(2));
+
+	// A lost message is resent once the timeout passes, not before
+	Clock::time_point sent = link.now;
+	EXPECT(link.send(link.a, link.b, Reliable::ORDERED, 0, "lost"));
+	link.flights.clear();
+	while (link.flights.empty())
+		link.step();
+	EXPECT(link.now - sent >= Reliable::MIN_TIMEOUT);
+	EXPECT(link.now - sent < milliseconds(200));
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test6("full window and silent peer", []()
+{
+	Link link;
+	link.lose = []() { return true; };
+
+	for (int i = 0; i < Reliable::WINDOW; ++i)
+		EXPECT(link.send(link.a, link.b, Reliable::RELIABLE, 0, "x"));
+	EXPECT(!link.send(link.a, link.b, Reliable::RELIABLE, 0, "x"));
+	// Other channels still have room
+	EXPECT(link.send(link.a, link.b, Reliable::RELIABLE, 1, "x"));
+
+	link.run(milliseconds(30000));
+	EXPECT(!link.answered);
+
+	// The peer was forgotten, so there is room again
+	EXPECT(link.send(link.a, link.b, Reliable::RELIABLE, 0, "x"));
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test7("a full window in one burst", []()
+{
+	Link link;
+
+	// Far more than the bitfield of a single acknowledgement covers
+	for (int delivery : {Reliable::ORDERED, Reliable::RELIABLE})
+	{
+		for (int i = 0; i < Reliable::WINDOW; ++i)
+			EXPECT(link.send(link.a, link.b, delivery, 0, std::to_string(i)));
+		link.run(milliseconds(5000));
+
+		vector<string> messages = link.b.take();
+		EXPECT(messages.size() == Reliable::WINDOW);
+		for (int i = 0; i < Reliable::WINDOW; ++i)
+			EXPECT(messages[i] == std::to_string(i));
+
+		EXPECT(link.answered);
+		EXPECT(link.a.layer.deadline() - link.now > Reliable::MAX_TIMEOUT);
+	}
+
+	// And over a lossy link, in the other direction
+	int count = 0;
+	link.lose = [&count]() { return ++count % 4 == 0; };
+	for (int i = 0; i < Reliable::WINDOW; ++i)
+		EXPECT(link.send(link.b, link.a, Reliable::ORDERED, 3, "x"));
+	link.run(milliseconds(20000));
+	EXPECT(link.a.take().size() == Reliable::WINDOW);
+	EXPECT(link.answered);
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test8("idle peers are forgotten", []()
+{
+	Link link;
+
+	EXPECT(link.send(link.a, link.b, Reliable::ORDERED, 0, "first"));
+	link.run(milliseconds(1000));
+	EXPECT(link.b.take().size() == 1);
+	EXPECT(link.a.layer.peers() == 1 && link.b.layer.peers() == 1);
+
+	link.run(Reliable::IDLE_TIMEOUT);
+	EXPECT(link.a.layer.peers() == 0 && link.b.layer.peers() == 0);
+	EXPECT(link.a.layer.deadline() == Clock::time_point::max());
+
+	// Both start over, so messages keep flowing
+	EXPECT(link.send(link.a, link.b, Reliable::ORDERED, 0, "second"));
+	link.run(milliseconds(1000));
+	vector<string> messages = link.b.take();
+	EXPECT(messages.size() == 1 && messages[0] == "second");
+
+	// Acknowledgements from an unknown address are ignored
+	Host stranger {3};
+	string ack("\x40\0\0\0\0\0\0\0\0", 9);
+	link.b.layer.receive(ack.data(), ack.size(), 0, stranger.addr,
+		link.b.incoming, link.now);
+	EXPECT(link.b.layer.peers() == 1);
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char const *argv[])
+{
+	return Test::run_tests() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//..............................................................................
@@ -17,14 +17,23 @@
 
 #ifdef _WIN32
 	#include <windows.h>
+	#define m_sleep(x) Sleep(x)
 #else
 	#include <sys/socket.h>
+	#include <unistd.h>
+	#define m_sleep(x) usleep(x * 1000)
 #endif
 
 using std::string;
 
+// Status constant values of address resolution, copy from SockAddr.h
+#define AGSSOCK_ADDR_RESOLVED 0
+#define AGSSOCK_ADDR_PENDING  1
+#define AGSSOCK_ADDR_FAILED   2
+
 struct SockAddr {};
 struct SockData {};
+struct PeerTable {};
 
 //------------------------------------------------------------------------------
 
@@ -137,7 +146,229 @@ Test test4("resolving addresses", []()
 
 //------------------------------------------------------------------------------
 
-Test test5("reverse resolving **internet access required**", []()
+Test test5("asynchronous resolving", []()
+{
+	using namespace AGSMock;
+
+	// Several lookups proceed at the same time
+	Handle<SockAddr> addrs[] =
+	{
+		Call<SockAddr *>("SockAddr::CreateFromStringAsync^2",
+			"http://localhost", (ags_t) AF_INET),
+		Call<SockAddr *>("SockAddr::CreateFromStringAsync^2",
+			"localhost:6667", (ags_t) AF_INET),
+		Call<SockAddr *>("SockAddr::CreateFromStringAsync^2",
+			"127.0.0.1:8080", (ags_t) AF_INET),
+		Call<SockAddr *>("SockAddr::CreateFromStringAsync^2",
+			"invalid.invalid", (ags_t) AF_INET)
+	};
+	ags_t ports[] = {80, 6667, 8080, 0};
+	ags_t expected[] = {AGSSOCK_ADDR_RESOLVED, AGSSOCK_ADDR_RESOLVED,
+		AGSSOCK_ADDR_RESOLVED, AGSSOCK_ADDR_FAILED};
+
+	for (int i = 0; i < 4; ++i)
+	{
+		ags_t status = AGSSOCK_ADDR_PENDING;
+		for (int j = 0; j < 500 && status == AGSSOCK_ADDR_PENDING; ++j)
+		{
+			status = Call<ags_t>("SockAddr::get_Status", addrs[i].get());
+			if (status == AGSSOCK_ADDR_PENDING)
+				m_sleep(10);
+		}
+		EXPECT(status == expected[i]);
+
+		int port = Call<ags_t>("SockAddr::get_Port", addrs[i].get());
+		EXPECT(port == ports[i]);
+		if (status == AGSSOCK_ADDR_RESOLVED)
+		{
+			Handle<const char> ip = Call<const char *>("SockAddr::get_IP",
+				addrs[i].get());
+			EXPECT(string("127.0.0.1") == ip.get());
+		}
+	}
+
+	// Ordinary addresses are always resolved
+	Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateIP^2",
+		"127.0.0.1", (ags_t) 80);
+	EXPECT(Call<ags_t>("SockAddr::get_Status", addr.get())
+		== AGSSOCK_ADDR_RESOLVED);
+
+	// Lookups that are abandoned do not cause trouble
+	for (int i = 0; i < 16; ++i)
+		Handle<SockAddr> addr = Call<SockAddr *>(
+			"SockAddr::CreateFromStringAsync^2", "localhost", (ags_t) AF_INET);
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test6("host overrides and caching", []()
+{
+	using namespace AGSMock;
+
+	Call<void>("SockAddr::SetHostOverride^2", "Match.Test", "127.0.0.2");
+
+	{
+		Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateFromString^2",
+			"match.test:1234", (ags_t) AF_INET);
+		EXPECT(Call<ags_t>("SockAddr::get_Port", addr.get()) == 1234);
+		Handle<const char> ip = Call<const char *>("SockAddr::get_IP", &*addr);
+		EXPECT(string("127.0.0.2") == ip.get());
+	}
+
+	{
+		// Overridden addresses are known right away
+		Handle<SockAddr> addr = Call<SockAddr *>(
+			"SockAddr::CreateFromStringAsync^2", "http://match.test",
+			(ags_t) AF_INET);
+		EXPECT(Call<ags_t>("SockAddr::get_Status", addr.get())
+			== AGSSOCK_ADDR_RESOLVED);
+		EXPECT(Call<ags_t>("SockAddr::get_Port", addr.get()) == 80);
+	}
+
+	Call<void>("SockAddr::SetHostOverride^2", "match.test", nullptr);
+
+	{
+		Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateFromString^2",
+			"match.test:1234", (ags_t) AF_INET);
+		EXPECT(Call<ags_t>("SockAddr::get_Port", addr.get()) == 0);
+	}
+
+	// Cached results are returned right away, also for failures
+	Call<void>("SockAddr::SetCacheTime^2", (ags_t) 60, (ags_t) 60);
+	{
+		Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateFromString^2",
+			"localhost:80", (ags_t) AF_INET);
+		Handle<SockAddr> again = Call<SockAddr *>(
+			"SockAddr::CreateFromStringAsync^2", "LOCALHOST:80", (ags_t) AF_INET);
+		EXPECT(Call<ags_t>("SockAddr::get_Status", again.get())
+			== AGSSOCK_ADDR_RESOLVED);
+		Handle<const char> ip = Call<const char *>("SockAddr::get_IP", &*again);
+		EXPECT(string("127.0.0.1") == ip.get());
+
+		addr = Call<SockAddr *>("SockAddr::CreateFromString^2",
+			"match.test:1234", (ags_t) AF_INET);
+		again = Call<SockAddr *>("SockAddr::CreateFromStringAsync^2",
+			"match.test:1234", (ags_t) AF_INET);
+		EXPECT(Call<ags_t>("SockAddr::get_Status", again.get())
+			== AGSSOCK_ADDR_FAILED);
+	}
+
+	Call<void>("SockAddr::ClearCache^0");
+	Call<void>("SockAddr::SetCacheTime^2", (ags_t) 60, (ags_t) 10);
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test7("reverse resolving in the background", []()
+{
+	using namespace AGSMock;
+
+	Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateIP^2",
+		"127.0.0.1", (ags_t) 80);
+
+	// The numeric form is returned until the name has been resolved
+	string str;
+	{
+		Handle<const char> first = Call<const char *>("SockAddr::get_Address",
+			addr.get());
+		str = first.get();
+		EXPECT(str == "http://127.0.0.1" || str == "http://localhost");
+	}
+
+	for (int i = 0; i < 500 && str != "http://localhost"; ++i)
+	{
+		m_sleep(10);
+		Handle<const char> next = Call<const char *>("SockAddr::get_Address",
+			addr.get());
+		str = next.get();
+	}
+	EXPECT(str == "http://localhost");
+
+	// Addresses without a port leave out the service
+	Call<void>("SockAddr::set_Port", addr.get(), (ags_t) 0);
+	{
+		Handle<const char> str = Call<const char *>("SockAddr::get_Address",
+			addr.get());
+		EXPECT(string("localhost") == str.get());
+	}
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test8("address equality and peer tables", []()
+{
+	using namespace AGSMock;
+
+	Handle<SockAddr> a = Call<SockAddr *>("SockAddr::CreateIP^2",
+		"10.0.0.1", (ags_t) 5000);
+	Handle<SockAddr> b = Call<SockAddr *>("SockAddr::CreateIP^2",
+		"10.0.0.1", (ags_t) 5000);
+	Handle<SockAddr> c = Call<SockAddr *>("SockAddr::CreateIP^2",
+		"10.0.0.1", (ags_t) 5001);
+	Handle<SockAddr> d = Call<SockAddr *>("SockAddr::CreateIPv6^2",
+		"::ffff:10.0.0.1", (ags_t) 5000);
+
+	EXPECT(Call<ags_t>("SockAddr::Equals^1", a.get(), b.get()));
+	EXPECT(!Call<ags_t>("SockAddr::Equals^1", a.get(), c.get()));
+	EXPECT(!Call<ags_t>("SockAddr::Equals^1", a.get(), d.get()));
+	EXPECT(!Call<ags_t>("SockAddr::Equals^1", a.get(), (SockAddr *) nullptr));
+
+	ags_t hash = Call<ags_t>("SockAddr::Hash^0", a.get());
+	EXPECT(hash >= 0);
+	EXPECT(hash == Call<ags_t>("SockAddr::Hash^0", b.get()));
+	EXPECT(hash != Call<ags_t>("SockAddr::Hash^0", c.get()));
+
+	Handle<PeerTable> table = Call<PeerTable *>("PeerTable::Create^0");
+	EXPECT(Call<ags_t>("PeerTable::Find^1", table.get(), a.get()) == -1);
+
+	// Enough peers to make the table grow a few times
+	for (ags_t port = 1; port <= 1000; ++port)
+	{
+		Call<void>("SockAddr::set_Port", c.get(), port);
+		Call<void>("PeerTable::Set^2", table.get(), c.get(), port * 2);
+	}
+	Call<void>("PeerTable::Set^2", table.get(), d.get(), (ags_t) 7);
+	EXPECT(Call<ags_t>("PeerTable::get_Count", table.get()) == 1001);
+	EXPECT(Call<ags_t>("PeerTable::Find^1", table.get(), a.get()) == -1);
+	EXPECT(Call<ags_t>("PeerTable::Find^1", table.get(), d.get()) == 7);
+
+	// Removing every other peer leaves the rest reachable
+	for (ags_t port = 1; port <= 1000; port += 2)
+	{
+		Call<void>("SockAddr::set_Port", c.get(), port);
+		EXPECT(Call<ags_t>("PeerTable::Remove^1", table.get(), c.get()));
+		EXPECT(!Call<ags_t>("PeerTable::Remove^1", table.get(), c.get()));
+	}
+	EXPECT(Call<ags_t>("PeerTable::get_Count", table.get()) == 501);
+	for (ags_t port = 1; port <= 1000; ++port)
+	{
+		Call<void>("SockAddr::set_Port", c.get(), port);
+		EXPECT(Call<ags_t>("PeerTable::Find^1", table.get(), c.get())
+			== (port % 2 ? -1 : port * 2));
+	}
+
+	// Setting an existing peer replaces its id
+	Call<void>("SockAddr::set_Port", c.get(), (ags_t) 2);
+	Call<void>("PeerTable::Set^2", table.get(), c.get(), (ags_t) 42);
+	EXPECT(Call<ags_t>("PeerTable::Find^1", table.get(), c.get()) == 42);
+	EXPECT(Call<ags_t>("PeerTable::get_Count", table.get()) == 501);
+
+	Call<void>("PeerTable::Clear^0", table.get());
+	EXPECT(Call<ags_t>("PeerTable::get_Count", table.get()) == 0);
+	EXPECT(Call<ags_t>("PeerTable::Find^1", table.get(), d.get()) == -1);
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test9("reverse resolving **internet access required**", []()
 {
 	using namespace AGSMock;
 
@@ -153,9 +384,17 @@ Test test5("reverse resolving **internet access required**", []()
 		Handle<const char> ip = Call<const char *>("SockAddr::get_IP", &*addr);
 		EXPECT(string("8.8.8.8") == ip.get());
 
-		Handle<const char> str = Call<const char *>("SockAddr::get_Address",
-			addr.get());
-		EXPECT(string("domain://dns.google") == str.get());
+		// The name becomes available once it has been resolved
+		string str;
+		for (int i = 0; i < 500 && str != "domain://dns.google"; ++i)
+		{
+			Handle<const char> next = Call<const char *>("SockAddr::get_Address",
+				addr.get());
+			str = next.get();
+			if (str != "domain://dns.google")
+				m_sleep(10);
+		}
+		EXPECT(str == "domain://dns.google");
 	}
 
 	return true;
@@ -8,7 +8,10 @@
  * Description: Testing the Socket AGS struct          *
  *******************************************************/
 
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
 
@@ -38,6 +41,9 @@ struct Socket
 };
 struct SockAddr {};
 struct SockData {};
+struct SocketGroup {};
+struct SharedRing {};
+struct SockSession {};
 
 // Error constant values returned by AGSEnumerateError, copy from API.h
 #define AGSSOCK_NO_ERROR               0
@@ -54,6 +60,34 @@ struct SockData {};
 #define AGSSOCK_NETWORK_NOT_AVAILABLE 11
 #define AGSSOCK_NOT_CONNECTED         12
 
+// Option constant values, copy from Socket.h
+#define AGSSOCK_LEVEL_SOCKET 1
+#define AGSSOCK_LEVEL_TCP    2
+#define AGSSOCK_LEVEL_IP     3
+#define AGSSOCK_LEVEL_UDP    4
+
+#define AGSSOCK_OPTION_REUSE_ADDRESS   1
+#define AGSSOCK_OPTION_REUSE_PORT      2
+#define AGSSOCK_OPTION_KEEP_ALIVE      3
+#define AGSSOCK_OPTION_RECEIVE_BUFFER  4
+#define AGSSOCK_OPTION_SEND_BUFFER     5
+#define AGSSOCK_OPTION_NO_DELAY        6
+#define AGSSOCK_OPTION_QUICK_ACK       7
+#define AGSSOCK_OPTION_TYPE_OF_SERVICE 8
+#define AGSSOCK_OPTION_SEGMENT_SIZE    9
+#define AGSSOCK_OPTION_COALESCE       10
+#define AGSSOCK_OPTION_BROADCAST      11
+#define AGSSOCK_OPTION_MULTICAST_TTL  12
+#define AGSSOCK_OPTION_MULTICAST_LOOP 13
+
+#define AGSSOCK_DELIVERY_RELIABLE_ORDERED 0
+#define AGSSOCK_DELIVERY_RELIABLE         1
+#define AGSSOCK_DELIVERY_SEQUENCED        2
+#define AGSSOCK_DELIVERY_UNRELIABLE       3
+
+// Engine event values, copy from agsplugin.h
+#define AGSE_FINALSCREENDRAW 0x800
+
 //------------------------------------------------------------------------------
 
 #define REPORT(x, sock) do { \
@@ -74,6 +108,42 @@ void print_socket_error(Socket *sock)
 
 //------------------------------------------------------------------------------
 
+// Makes a TCP connection over the loopback interface, optionally compressed;
+// the listening socket is closed once the connection is accepted.
+bool connected_pair(bool compressed, AGSMock::Handle<Socket> &client,
+	AGSMock::Handle<Socket> &conn)
+{
+	using namespace AGSMock;
+
+	Handle<Socket> server = Call<Socket *>("Socket::CreateTCP^0");
+	Call<void>("Socket::set_Compression", server.get(), (ags_t) compressed);
+	Handle<SockAddr> serv_addr;
+	{
+		Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateIP^2",
+			"127.0.0.1", (ags_t) 0);
+		EXPECT(Call<ags_t>("Socket::Bind^1", server.get(), addr.get()));
+		EXPECT(Call<ags_t>("Socket::Listen^1", server.get(), (ags_t) 10));
+		serv_addr = Call<SockAddr *>("Socket::get_Local", server.get());
+	}
+
+	client = Call<Socket *>("Socket::CreateTCP^0");
+	Call<void>("Socket::set_Compression", client.get(), (ags_t) compressed);
+	EXPECT(Call<ags_t>("Socket::Connect^2", client.get(), serv_addr.get(),
+		(ags_t) 0));
+	for (int i = 0; i < 100 && !conn; ++i)
+	{
+		conn = Call<Socket *>("Socket::Accept^0", server.get());
+		if (!conn)
+			m_sleep(10);
+	}
+	EXPECT(!!conn);
+
+	Call<void>("Socket::Close^0", server.get());
+	return true;
+}
+
+//------------------------------------------------------------------------------
+
 Test test1("loading the plugin", []()
 {
 	using namespace AGSMock;
@@ -280,7 +350,82 @@ Test test3("local TCP connection", []()
 
 //------------------------------------------------------------------------------
 
-Test test4("error values", []()
+Test test4("compressed TCP connection", []()
+{
+	using namespace AGSMock;
+
+	cout << endl;
+
+	Handle<Socket> server = Call<Socket *>("Socket::CreateTCP^0");
+	Call<void>("Socket::set_Compression", server.get(), (ags_t) 1);
+	EXPECT(Call<ags_t>("Socket::get_Compression", server.get()));
+
+	Handle<SockAddr> serv_addr;
+	{
+		Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateIP^2",
+			"127.0.0.1", (ags_t) 0);
+		EXPECT(Call<ags_t>("Socket::Bind^1", server.get(), addr.get()));
+		EXPECT(Call<ags_t>("Socket::Listen^1", server.get(), (ags_t) 10));
+
+		Handle<SockAddr> local = Call<SockAddr *>("Socket::get_Local",
+			server.get());
+		ags_t port = Call<ags_t>("SockAddr::get_Port", local.get());
+		serv_addr = Call<SockAddr *>("SockAddr::CreateIP^2", "127.0.0.1", port);
+	}
+
+	Handle<Socket> client = Call<Socket *>("Socket::CreateTCP^0");
+	Call<void>("Socket::set_Compression", client.get(), (ags_t) 1);
+	{
+		ags_t ret = Call<ags_t>("Socket::Connect^2", client.get(),
+			serv_addr.get(), (ags_t) 0);
+		REPORT(ret, client);
+		EXPECT(ret);
+	}
+
+	Handle<Socket> conn;
+	for (int i = 0; i < 100 && !conn; ++i)
+	{
+		conn = Call<Socket *>("Socket::Accept^0", server.get());
+		if (!conn)
+			m_sleep(10);
+	}
+	EXPECT(!!conn);
+	EXPECT(Call<ags_t>("Socket::get_Compression", conn.get()));
+
+	// Send a lot of repetitive text, more than fits in a single frame
+	string message;
+	for (int i = 0; i < 20000; ++i)
+		message += "Hello compressed world! ";
+
+	{
+		ags_t ret = Call<ags_t>("Socket::Send^1", client.get(),
+			message.c_str());
+		REPORT(ret, client);
+		EXPECT(ret);
+	}
+
+	string received;
+	for (int i = 0; i < 500 && received.size() < message.size(); ++i)
+	{
+		Handle<const char> data = Call<const char *>("Socket::Recv^0", &*conn);
+		REPORT(!!data, conn);
+		EXPECT(data || conn->error == 0);
+		if (data)
+			received += data.get();
+		else
+			m_sleep(10);
+	}
+	EXPECT(received == message);
+
+	Call<void>("Socket::Close^0", client.get());
+	Call<void>("Socket::Close^0", server.get());
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test5("error values", []()
 {
 	using namespace AGSMock;
 
@@ -389,6 +534,1279 @@ Test test4("error values", []()
 
 //------------------------------------------------------------------------------
 
+Test test6("file backed data", []()
+{
+	using namespace AGSMock;
+
+	const char *path = "agssock-test.bin";
+
+	{
+		Handle<SockData> data = Call<SockData *>("SockData::CreateFromString^1",
+			"0123456789");
+		EXPECT(Call<ags_t>("SockData::WriteToFile^1", data.get(), path));
+	}
+
+	{
+		Handle<SockData> data = Call<SockData *>("SockData::CreateFromFile^3",
+			path, (ags_t) 2, (ags_t) 5);
+		EXPECT(!!data);
+		EXPECT(Call<ags_t>("SockData::get_Size", data.get()) == 5);
+		EXPECT(Call<ags_t>("SockData::geti_Chars", data.get(), (ags_t) 0) == '2');
+
+		Handle<const char> str = Call<const char *>("SockData::AsString^0",
+			data.get());
+		EXPECT(string("23456") == str.get());
+
+		// Changing the data leaves the file untouched
+		Call<void>("SockData::seti_Chars", data.get(), (ags_t) 0, (ags_t) 'x');
+		EXPECT(Call<ags_t>("SockData::geti_Chars", data.get(), (ags_t) 0) == 'x');
+	}
+
+	{
+		// The length is clamped to the end of the file
+		Handle<SockData> data = Call<SockData *>("SockData::CreateFromFile^3",
+			path, (ags_t) 0, (ags_t) -1);
+		EXPECT(Call<ags_t>("SockData::get_Size", data.get()) == 10);
+		EXPECT(Call<ags_t>("SockData::geti_Chars", data.get(), (ags_t) 2) == '2');
+
+		Handle<SockData> tail = Call<SockData *>("SockData::CreateFromFile^3",
+			path, (ags_t) 10, (ags_t) 100);
+		EXPECT(Call<ags_t>("SockData::get_Size", tail.get()) == 0);
+	}
+
+	{
+		Handle<SockData> data = Call<SockData *>("SockData::CreateFromFile^3",
+			path, (ags_t) 11, (ags_t) -1);
+		EXPECT(!data);
+		data = Call<SockData *>("SockData::CreateFromFile^3",
+			"agssock-missing.bin", (ags_t) 0, (ags_t) -1);
+		EXPECT(!data);
+	}
+
+	{
+		// Written to the file it maps: the file is replaced, not emptied first
+		string content(65536, 'z');
+		for (size_t i = 0; i < content.size(); i += 7)
+			content[i] = (char) ('a' + i % 26);
+		Handle<SockData> data = Call<SockData *>("SockData::CreateFromString^1",
+			content.c_str());
+		EXPECT(Call<ags_t>("SockData::WriteToFile^1", data.get(), path));
+
+		Handle<SockData> mapped = Call<SockData *>("SockData::CreateFromFile^3",
+			path, (ags_t) 0, (ags_t) -1);
+		EXPECT(Call<ags_t>("SockData::WriteToFile^1", mapped.get(), path));
+		Handle<const char> str = Call<const char *>("SockData::AsString^0",
+			mapped.get());
+		EXPECT(content == str.get());
+
+		Handle<SockData> copy = Call<SockData *>("SockData::CreateFromFile^3",
+			path, (ags_t) 0, (ags_t) -1);
+		str = Call<const char *>("SockData::AsString^0", copy.get());
+		EXPECT(content == str.get());
+	}
+
+	std::remove(path);
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test7("connecting by host name", []()
+{
+	using namespace AGSMock;
+
+	Handle<Socket> server = Call<Socket *>("Socket::CreateTCP^0");
+	ags_t port;
+	{
+		Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateIP^2",
+			"127.0.0.1", (ags_t) 0);
+		EXPECT(Call<ags_t>("Socket::Bind^1", server.get(), addr.get()));
+		EXPECT(Call<ags_t>("Socket::Listen^1", server.get(), (ags_t) 10));
+
+		Handle<SockAddr> local = Call<SockAddr *>("Socket::get_Local",
+			server.get());
+		port = Call<ags_t>("SockAddr::get_Port", local.get());
+	}
+	string host = "localhost:" + std::to_string(port);
+
+	// Localhost may resolve to ::1 first, which refuses; the race moves on
+	for (ags_t async = 0; async < 2; ++async)
+	{
+		Handle<Socket> client = Call<Socket *>("Socket::CreateTCPv6^0");
+		EXPECT(Call<ags_t>("Socket::SetOption^3", client.get(),
+			(ags_t) AGSSOCK_LEVEL_TCP, (ags_t) AGSSOCK_OPTION_NO_DELAY, (ags_t) 1));
+		ags_t ret = 0;
+		for (int i = 0; i < 300 && !ret; ++i)
+		{
+			ret = Call<ags_t>("Socket::ConnectByName^3", client.get(),
+				host.c_str(), async, (ags_t) 0);
+			REPORT(ret, client);
+			EXPECT(ret || (async && client->error == 0));
+			if (!ret)
+				m_sleep(10);
+		}
+		EXPECT(ret);
+		{
+			// The socket took over the IPv4 connection
+			Handle<SockAddr> local = Call<SockAddr *>("Socket::get_Local",
+				client.get());
+			Handle<const char> ip = Call<const char *>("SockAddr::get_IP",
+				local.get());
+			EXPECT(ip && string("127.0.0.1") == ip.get());
+		}
+		// And the options that were set on it
+		EXPECT(Call<ags_t>("Socket::GetOption^2", client.get(),
+			(ags_t) AGSSOCK_LEVEL_TCP, (ags_t) AGSSOCK_OPTION_NO_DELAY) == 1);
+
+		Handle<Socket> conn;
+		for (int i = 0; i < 100 && !conn; ++i)
+		{
+			conn = Call<Socket *>("Socket::Accept^0", server.get());
+			if (!conn)
+				m_sleep(10);
+		}
+		EXPECT(!!conn);
+
+		EXPECT(Call<ags_t>("Socket::Send^1", client.get(), "Eyeballs"));
+		Handle<const char> data;
+		for (int i = 0; i < 100 && !data; ++i)
+		{
+			data = Call<const char *>("Socket::Recv^0", conn.get());
+			if (!data)
+				m_sleep(10);
+		}
+		EXPECT(data && string("Eyeballs") == data.get());
+	}
+
+	// Names that do not resolve fail
+	{
+		Handle<Socket> client = Call<Socket *>("Socket::CreateTCP^0");
+		EXPECT(!Call<ags_t>("Socket::ConnectByName^3", client.get(),
+			"host.invalid:80", (ags_t) 0, (ags_t) 5000));
+		EXPECT(Call<ags_t>("Socket::ErrorValue^0", client.get())
+			!= AGSSOCK_NO_ERROR);
+	}
+
+	// A bound socket is refused, its address would not be used
+	{
+		Handle<Socket> client = Call<Socket *>("Socket::CreateTCP^0");
+		Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateIP^2",
+			"127.0.0.1", (ags_t) 0);
+		EXPECT(Call<ags_t>("Socket::Bind^1", client.get(), addr.get()));
+		EXPECT(!Call<ags_t>("Socket::ConnectByName^3", client.get(),
+			host.c_str(), (ags_t) 0, (ags_t) 5000));
+		EXPECT(Call<ags_t>("Socket::ErrorValue^0", client.get())
+			== AGSSOCK_INVALID);
+	}
+
+	Call<void>("Socket::Close^0", server.get());
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test8("datagram sources", []()
+{
+	using namespace AGSMock;
+
+	Handle<Socket> server = Call<Socket *>("Socket::CreateUDP^0");
+	Handle<SockAddr> serv_addr;
+	{
+		Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateIP^2",
+			"127.0.0.1", (ags_t) 0);
+		EXPECT(Call<ags_t>("Socket::Bind^1", server.get(), addr.get()));
+		serv_addr = Call<SockAddr *>("Socket::get_Local", server.get());
+	}
+
+	// The clients are bound implicitly by sending
+	Handle<Socket> clients[2] =
+	{
+		Call<Socket *>("Socket::CreateUDP^0"),
+		Call<Socket *>("Socket::CreateUDP^0")
+	};
+	const char *messages[2] = {"first", "second"};
+	for (int i = 0; i < 2; ++i)
+		EXPECT(Call<ags_t>("Socket::SendTo^2", clients[i].get(),
+			serv_addr.get(), messages[i]));
+
+	Handle<SockAddr> source = Call<SockAddr *>("SockAddr::Create^1",
+		(ags_t) -1);
+	int received = 0;
+	for (int i = 0; i < 100 && received < 2; ++i)
+	{
+		Handle<const char> data = Call<const char *>("Socket::RecvFrom^1",
+			server.get(), source.get());
+		if (!data)
+		{
+			EXPECT(Call<ags_t>("Socket::ErrorValue^0", server.get())
+				== AGSSOCK_PLEASE_TRY_AGAIN);
+			m_sleep(10);
+			continue;
+		}
+
+		// Each datagram comes with the address of its sender
+		int index = string(messages[0]) == data.get() ? 0 : 1;
+		EXPECT(string(messages[index]) == data.get());
+		Handle<SockAddr> local = Call<SockAddr *>("Socket::get_Local",
+			clients[index].get());
+		EXPECT(Call<ags_t>("SockAddr::get_Port", source.get())
+			== Call<ags_t>("SockAddr::get_Port", local.get()));
+		received++;
+
+		// Replies reach the client through its pool buffer as well
+		EXPECT(Call<ags_t>("Socket::SendTo^2", server.get(), source.get(),
+			"reply"));
+	}
+	EXPECT(received == 2);
+
+	for (int i = 0; i < 2; ++i)
+	{
+		Handle<SockData> data;
+		for (int j = 0; j < 100 && !data; ++j)
+		{
+			data = Call<SockData *>("Socket::RecvDataFrom^1", clients[i].get(),
+				source.get());
+			if (!data)
+				m_sleep(10);
+		}
+		EXPECT(!!data);
+		EXPECT(Call<ags_t>("SockAddr::Equals^1", source.get(), serv_addr.get()));
+	}
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test9("socket options", []()
+{
+	using namespace AGSMock;
+
+	Handle<Socket> sock = Call<Socket *>("Socket::CreateTCP^0");
+
+	auto get = [&](ags_t level, ags_t option)
+	{
+		return Call<ags_t>("Socket::GetOption^2", sock.get(), level, option);
+	};
+	auto set = [&](ags_t level, ags_t option, ags_t value)
+	{
+		return Call<ags_t>("Socket::SetOption^3", sock.get(), level, option,
+			value);
+	};
+	auto error = [&]()
+	{
+		return Call<ags_t>("Socket::ErrorValue^0", sock.get());
+	};
+
+	// Flags read back as 0 or 1
+	ags_t flags[][2] =
+	{
+		{AGSSOCK_LEVEL_TCP, AGSSOCK_OPTION_NO_DELAY},
+		{AGSSOCK_LEVEL_SOCKET, AGSSOCK_OPTION_KEEP_ALIVE},
+		{AGSSOCK_LEVEL_SOCKET, AGSSOCK_OPTION_REUSE_ADDRESS}
+	};
+	for (auto &flag : flags)
+	{
+		EXPECT(set(flag[0], flag[1], 1));
+		EXPECT(get(flag[0], flag[1]) == 1);
+		EXPECT(error() == AGSSOCK_NO_ERROR);
+		EXPECT(set(flag[0], flag[1], 0));
+		EXPECT(get(flag[0], flag[1]) == 0);
+	}
+
+	// The system may round buffer sizes but not below the request
+	EXPECT(set(AGSSOCK_LEVEL_SOCKET, AGSSOCK_OPTION_RECEIVE_BUFFER, 65536));
+	EXPECT(get(AGSSOCK_LEVEL_SOCKET, AGSSOCK_OPTION_RECEIVE_BUFFER) >= 65536);
+	EXPECT(set(AGSSOCK_LEVEL_SOCKET, AGSSOCK_OPTION_SEND_BUFFER, 65536));
+	EXPECT(get(AGSSOCK_LEVEL_SOCKET, AGSSOCK_OPTION_SEND_BUFFER) >= 65536);
+
+	EXPECT(set(AGSSOCK_LEVEL_IP, AGSSOCK_OPTION_TYPE_OF_SERVICE, 0x10));
+	EXPECT(get(AGSSOCK_LEVEL_IP, AGSSOCK_OPTION_TYPE_OF_SERVICE) == 0x10);
+
+	// Options at the wrong level or unknown options are rejected
+	EXPECT(!set(AGSSOCK_LEVEL_SOCKET, AGSSOCK_OPTION_NO_DELAY, 1));
+	EXPECT(error() == AGSSOCK_INVALID);
+	EXPECT(get(AGSSOCK_LEVEL_TCP, 99) == 0);
+	EXPECT(error() == AGSSOCK_UNSUPPORTED);
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test10("graceful close", []()
+{
+	using namespace AGSMock;
+
+	Handle<Socket> server = Call<Socket *>("Socket::CreateTCP^0");
+	Call<void>("Socket::set_Compression", server.get(), (ags_t) 1);
+	Handle<SockAddr> serv_addr;
+	{
+		Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateIP^2",
+			"127.0.0.1", (ags_t) 0);
+		EXPECT(Call<ags_t>("Socket::Bind^1", server.get(), addr.get()));
+		EXPECT(Call<ags_t>("Socket::Listen^1", server.get(), (ags_t) 10));
+		serv_addr = Call<SockAddr *>("Socket::get_Local", server.get());
+	}
+
+	auto connect = [&](Handle<Socket> &client, Handle<Socket> &conn)
+	{
+		client = Call<Socket *>("Socket::CreateTCP^0");
+		Call<void>("Socket::set_Compression", client.get(), (ags_t) 1);
+		EXPECT(Call<ags_t>("Socket::Connect^2", client.get(), serv_addr.get(),
+			(ags_t) 0));
+		for (int i = 0; i < 100 && !conn; ++i)
+		{
+			conn = Call<Socket *>("Socket::Accept^0", server.get());
+			if (!conn)
+				m_sleep(10);
+		}
+		EXPECT(!!conn);
+		return true;
+	};
+
+	// Incompressible data that does not fit the system buffers is queued
+	string message(8 << 20, '\0');
+	unsigned int seed = 1;
+	for (char &c : message)
+	{
+		seed = seed * 1103515245 + 12345;
+		c = 'A' + (seed >> 16) % 26;
+	}
+
+	{
+		Handle<Socket> client, conn;
+		EXPECT(connect(client, conn));
+		EXPECT(Call<ags_t>("Socket::get_Linger", client.get()) == 2000);
+		Call<void>("Socket::set_Linger", client.get(), (ags_t) 10000);
+		EXPECT(Call<ags_t>("Socket::Send^1", client.get(), message.c_str()));
+
+		// Closing returns right away, the data still arrives
+		auto start = std::chrono::steady_clock::now();
+		Call<void>("Socket::Close^0", client.get());
+		EXPECT(std::chrono::steady_clock::now() - start
+			< std::chrono::milliseconds(100));
+		EXPECT(Call<ags_t>("Socket::get_Valid", client.get()));
+
+		string received;
+		bool ended = false;
+		for (int i = 0; i < 1000 && !ended; ++i)
+		{
+			Handle<const char> data = Call<const char *>("Socket::Recv^0",
+				conn.get());
+			if (!data)
+				m_sleep(10);
+			else if (!data.get()[0])
+				ended = true;
+			else
+				received += data.get();
+		}
+		EXPECT(ended);
+		EXPECT(received == message);
+
+		// Both ends closed: the client is invalidated by the pool
+		Call<void>("Socket::Close^0", conn.get());
+		for (int i = 0; i < 100
+			&& Call<ags_t>("Socket::get_Valid", client.get()); ++i)
+			m_sleep(10);
+		EXPECT(!Call<ags_t>("Socket::get_Valid", client.get()));
+	}
+
+	{
+		// The remote host never closes: the linger time ends the wait
+		Handle<Socket> client, conn;
+		EXPECT(connect(client, conn));
+		Call<void>("Socket::set_Linger", client.get(), (ags_t) 50);
+		Call<void>("Socket::Close^0", client.get());
+		for (int i = 0; i < 100
+			&& Call<ags_t>("Socket::get_Valid", client.get()); ++i)
+			m_sleep(10);
+		EXPECT(!Call<ags_t>("Socket::get_Valid", client.get()));
+	}
+
+	{
+		// A socket disposed of right after closing is finished by the pool
+		Handle<Socket> conn;
+		{
+			Handle<Socket> client;
+			EXPECT(connect(client, conn));
+			EXPECT(Call<ags_t>("Socket::Send^1", client.get(), message.c_str()));
+			Call<void>("Socket::Close^0", client.get());
+		}
+
+		size_t received = 0;
+		bool ended = false;
+		for (int i = 0; i < 1000 && !ended; ++i)
+		{
+			Handle<const char> data = Call<const char *>("Socket::Recv^0",
+				conn.get());
+			if (!data)
+				m_sleep(10);
+			else if (!data.get()[0])
+				ended = true;
+			else
+				received += strlen(data.get());
+		}
+		EXPECT(ended);
+		EXPECT(received == message.size());
+	}
+
+	Call<void>("Socket::Close^0", server.get());
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test11("connecting with a timeout", []()
+{
+	using namespace AGSMock;
+
+	// A listener that never accepts and has no room for waiting connections;
+	// further connection attempts are left unanswered.
+	Handle<Socket> server = Call<Socket *>("Socket::CreateTCP^0");
+	Handle<SockAddr> serv_addr;
+	{
+		Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateIP^2",
+			"127.0.0.1", (ags_t) 0);
+		EXPECT(Call<ags_t>("Socket::Bind^1", server.get(), addr.get()));
+		EXPECT(Call<ags_t>("Socket::Listen^1", server.get(), (ags_t) 0));
+		serv_addr = Call<SockAddr *>("Socket::get_Local", server.get());
+	}
+
+	Handle<Socket> clients[4];
+	bool timed_out = false;
+	auto start = std::chrono::steady_clock::now();
+	for (Handle<Socket> &client : clients)
+	{
+		client = Call<Socket *>("Socket::CreateTCP^0");
+		if (!Call<ags_t>("Socket::Connect^3", client.get(), serv_addr.get(),
+			(ags_t) 0, (ags_t) 200))
+		{
+			EXPECT(Call<ags_t>("Socket::ErrorValue^0", client.get())
+				== AGSSOCK_NOT_CONNECTED);
+			timed_out = true;
+			break;
+		}
+	}
+	EXPECT(timed_out);
+	EXPECT(std::chrono::steady_clock::now() - start
+		< std::chrono::milliseconds(2000));
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test12("sending files", []()
+{
+	using namespace AGSMock;
+
+	const char *path = "agssock-send.bin";
+
+	string content(4 << 20, '\0');
+	unsigned int seed = 7;
+	for (char &c : content)
+	{
+		seed = seed * 1103515245 + 12345;
+		c = 'a' + (seed >> 16) % 26;
+	}
+	{
+		FILE *file = std::fopen(path, "wb");
+		EXPECT(file);
+		std::fwrite(content.data(), 1, content.size(), file);
+		std::fclose(file);
+	}
+
+	{
+		Handle<Socket> udp = Call<Socket *>("Socket::CreateUDP^0");
+		EXPECT(!Call<ags_t>("Socket::SendFile^3", udp.get(), path, (ags_t) 0,
+			(ags_t) -1));
+		EXPECT(Call<ags_t>("Socket::ErrorValue^0", udp.get())
+			== AGSSOCK_UNSUPPORTED);
+	}
+
+	auto transfer = [&](bool compressed, ags_t offset, ags_t length)
+	{
+		Handle<Socket> client, conn;
+		EXPECT(connected_pair(compressed, client, conn));
+
+		EXPECT(!Call<ags_t>("Socket::SendFile^3", client.get(),
+			"agssock-missing.bin", (ags_t) 0, (ags_t) -1));
+		EXPECT(!Call<ags_t>("Socket::SendFile^3", client.get(), path,
+			(ags_t) content.size() + 1, (ags_t) -1));
+		EXPECT(Call<ags_t>("Socket::ErrorValue^0", client.get())
+			== AGSSOCK_INVALID);
+
+		// Data sent after the file waits until the file is done
+		EXPECT(Call<ags_t>("Socket::SendFile^3", client.get(), path, offset,
+			length));
+		string expected = content.substr(offset, length < 0 ? string::npos
+			: (size_t) length);
+		string trailer = "!";
+		bool trailed = false;
+
+		string received;
+		for (int i = 0; i < 1000 && received.size() < expected.size() + 1; ++i)
+		{
+			if (!trailed && Call<ags_t>("Socket::Send^1", client.get(), "!"))
+				trailed = true;
+			else if (!trailed)
+				EXPECT(Call<ags_t>("Socket::ErrorValue^0", client.get())
+					== AGSSOCK_NO_ERROR);
+
+			Handle<const char> data = Call<const char *>("Socket::Recv^0",
+				conn.get());
+			if (data)
+				received += data.get();
+			else
+				m_sleep(10);
+		}
+		EXPECT(received == expected + trailer);
+		EXPECT(!Call<ags_t>("Socket::get_SendingFile", client.get()));
+		EXPECT(Call<ags_t>("Socket::get_SendFileProgress", client.get())
+			== (ags_t) expected.size());
+
+		Call<void>("Socket::Close^0", client.get());
+		return true;
+	};
+
+	EXPECT(transfer(false, 100, -1));
+	EXPECT(transfer(true, 1000, 300000));
+
+	std::remove(path);
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test13("receiving files", []()
+{
+	using namespace AGSMock;
+
+	const char *path = "agssock-recv.bin";
+
+	auto read_file = [&]()
+	{
+		string content;
+		FILE *file = std::fopen(path, "rb");
+		if (!file)
+			return content;
+		char buffer[4096];
+		size_t count;
+		while ((count = std::fread(buffer, 1, sizeof (buffer), file)) > 0)
+			content.append(buffer, count);
+		std::fclose(file);
+		return content;
+	};
+
+	string message(2 << 20, '\0');
+	unsigned int seed = 3;
+	for (char &c : message)
+	{
+		seed = seed * 1103515245 + 12345;
+		c = 'a' + (seed >> 16) % 26;
+	}
+
+	// Like sending, there is nothing to receive without a connection
+	{
+		Handle<Socket> sock = Call<Socket *>("Socket::CreateTCP^0");
+		std::remove(path);
+		EXPECT(!Call<ags_t>("Socket::RecvToFile^2", sock.get(), path,
+			(ags_t) -1));
+		EXPECT(Call<ags_t>("Socket::ErrorValue^0", sock.get())
+			== AGSSOCK_NOT_CONNECTED);
+		EXPECT(std::remove(path) != 0); // The file was not created
+	}
+
+	auto transfer = [&](bool compressed, ags_t length)
+	{
+		Handle<Socket> client, conn;
+		EXPECT(connected_pair(compressed, client, conn));
+
+		// What arrived before is written to the file as well
+		EXPECT(Call<ags_t>("Socket::Send^1", client.get(), "head:"));
+		m_sleep(100);
+		EXPECT(Call<ags_t>("Socket::RecvToFile^2", conn.get(), path, length));
+
+		for (size_t sent = 0; sent < message.size();)
+		{
+			if (Call<ags_t>("Socket::Send^1", client.get(),
+				message.substr(sent, 65536).c_str()))
+				sent += 65536;
+			else
+				m_sleep(1);
+		}
+		Call<void>("Socket::Close^0", client.get());
+
+		for (int i = 0; i < 1000
+			&& Call<ags_t>("Socket::get_ReceivingFile", conn.get()); ++i)
+			m_sleep(10);
+		EXPECT(!Call<ags_t>("Socket::get_ReceivingFile", conn.get()));
+
+		string expected = "head:" + message;
+		string rest;
+		if (length >= 0)
+		{
+			rest = expected.substr(length);
+			expected.resize(length);
+		}
+		EXPECT(Call<ags_t>("Socket::get_RecvFileProgress", conn.get())
+			== (ags_t) expected.size());
+		EXPECT(read_file() == expected);
+
+		// Data after the file is received as usual, up to the end
+		string received;
+		for (int i = 0; i < 100 && received.size() < rest.size(); ++i)
+		{
+			Handle<const char> data = Call<const char *>("Socket::Recv^0",
+				conn.get());
+			if (data)
+				received += data.get();
+			else
+				m_sleep(10);
+		}
+		EXPECT(received == rest);
+		return true;
+	};
+
+	EXPECT(transfer(false, -1));
+	EXPECT(transfer(true, 100000));
+	EXPECT(transfer(false, 3));
+
+	std::remove(path);
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test14("sending many parts", []()
+{
+	using namespace AGSMock;
+
+	auto transfer = [&](bool compressed)
+	{
+		Handle<Socket> client, conn;
+		EXPECT(connected_pair(compressed, client, conn));
+
+		string body(100000, 'b');
+		Handle<SockData> head = Call<SockData *>("SockData::CreateFromString^1",
+			"head:");
+		Handle<SockData> empty = Call<SockData *>("SockData::CreateEmpty^0");
+		Handle<SockData> middle = Call<SockData *>(
+			"SockData::CreateFromString^1", body.c_str());
+		Handle<SockData> tail = Call<SockData *>("SockData::CreateFromString^1",
+			":tail");
+
+		// Missing and empty parts are skipped
+		SockData *none = nullptr;
+		EXPECT(Call<ags_t>("Socket::SendMany^8", client.get(), head.get(),
+			empty.get(), middle.get(), none, tail.get(), none, none, none));
+
+		string expected = "head:" + body + ":tail";
+		string received;
+		for (int i = 0; i < 500 && received.size() < expected.size(); ++i)
+		{
+			Handle<const char> data = Call<const char *>("Socket::Recv^0",
+				conn.get());
+			if (data)
+				received += data.get();
+			else
+				m_sleep(10);
+		}
+		EXPECT(received == expected);
+
+		Call<void>("Socket::Close^0", client.get());
+		return true;
+	};
+
+	EXPECT(transfer(false));
+	EXPECT(transfer(true));
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test15("batching", []()
+{
+	using namespace AGSMock;
+
+	{
+		Handle<Socket> udp = Call<Socket *>("Socket::CreateUDP^0");
+		EXPECT(!Call<ags_t>("Socket::BeginBatch^1", udp.get(), (ags_t) 0));
+		EXPECT(Call<ags_t>("Socket::ErrorValue^0", udp.get())
+			== AGSSOCK_UNSUPPORTED);
+	}
+
+	auto transfer = [&](bool compressed)
+	{
+		Handle<Socket> client, conn;
+		EXPECT(connected_pair(compressed, client, conn));
+
+		auto receive = [&](size_t size)
+		{
+			string received;
+			for (int i = 0; i < 100 && received.size() < size; ++i)
+			{
+				m_sleep(10);
+				Handle<const char> data = Call<const char *>("Socket::Recv^0",
+					conn.get());
+				if (data)
+					received += data.get();
+			}
+			return received;
+		};
+
+		// Nothing is sent until the batch is flushed
+		EXPECT(Call<ags_t>("Socket::BeginBatch^1", client.get(), (ags_t) 0));
+		EXPECT(Call<ags_t>("Socket::Send^1", client.get(), "one,"));
+		EXPECT(Call<ags_t>("Socket::Send^1", client.get(), "two,"));
+		EXPECT(receive(1).empty());
+		EXPECT(Call<ags_t>("Socket::Flush^0", client.get()));
+		EXPECT(receive(8) == "one,two,");
+
+		// Auto flushing sends the batch at the end of each frame
+		EXPECT(Call<ags_t>("Socket::BeginBatch^1", client.get(), (ags_t) 1));
+		EXPECT(Call<ags_t>("Socket::Send^1", client.get(), "three,"));
+		EXPECT(receive(1).empty());
+		SendEvent(AGSE_FINALSCREENDRAW);
+		EXPECT(receive(6) == "three,");
+		EXPECT(Call<ags_t>("Socket::Send^1", client.get(), "four"));
+		EXPECT(Call<ags_t>("Socket::Flush^0", client.get()));
+		EXPECT(receive(4) == "four");
+
+		// Closing sends what is left
+		EXPECT(Call<ags_t>("Socket::BeginBatch^1", client.get(), (ags_t) 0));
+		EXPECT(Call<ags_t>("Socket::Send^1", client.get(), "five"));
+		Call<void>("Socket::Close^0", client.get());
+		EXPECT(receive(4) == "five");
+		return true;
+	};
+
+	EXPECT(transfer(false));
+	EXPECT(transfer(true));
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test16("segmented datagrams", []()
+{
+	using namespace AGSMock;
+
+	Handle<Socket> server = Call<Socket *>("Socket::CreateUDP^0");
+	Handle<Socket> client = Call<Socket *>("Socket::CreateUDP^0");
+	Handle<SockAddr> serv_addr;
+	{
+		Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateIP^2",
+			"127.0.0.1", (ags_t) 0);
+		EXPECT(Call<ags_t>("Socket::Bind^1", server.get(), addr.get()));
+		serv_addr = Call<SockAddr *>("Socket::get_Local", server.get());
+	}
+
+	// Only available on Linux (since 4.18 and 5.0)
+	if (!Call<ags_t>("Socket::SetOption^3", client.get(),
+		(ags_t) AGSSOCK_LEVEL_UDP, (ags_t) AGSSOCK_OPTION_SEGMENT_SIZE,
+		(ags_t) 100))
+	{
+		EXPECT(Call<ags_t>("Socket::ErrorValue^0", client.get())
+			== AGSSOCK_UNSUPPORTED);
+		cout << "(unsupported) ";
+		return true;
+	}
+	EXPECT(Call<ags_t>("Socket::GetOption^2", client.get(),
+		(ags_t) AGSSOCK_LEVEL_UDP, (ags_t) AGSSOCK_OPTION_SEGMENT_SIZE) == 100);
+	Call<ags_t>("Socket::SetOption^3", server.get(), (ags_t) AGSSOCK_LEVEL_UDP,
+		(ags_t) AGSSOCK_OPTION_COALESCE, (ags_t) 1);
+
+	// One send arrives as separate datagrams of the segment size
+	string message;
+	for (int i = 0; i < 10; ++i)
+		message += string(i < 9 ? 100 : 50, 'a' + i);
+	EXPECT(Call<ags_t>("Socket::SendTo^2", client.get(), serv_addr.get(),
+		message.c_str()));
+
+	Handle<SockAddr> source = Call<SockAddr *>("SockAddr::Create^1",
+		(ags_t) -1);
+	int received = 0;
+	for (int i = 0; i < 100 && received < 10; ++i)
+	{
+		Handle<const char> data = Call<const char *>("Socket::RecvFrom^1",
+			server.get(), source.get());
+		if (!data)
+		{
+			m_sleep(10);
+			continue;
+		}
+		EXPECT(data.get() == message.substr(received * 100, 100));
+		received++;
+	}
+	EXPECT(received == 10);
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test17("broadcast to a group", []()
+{
+	using namespace AGSMock;
+
+	Handle<Socket> server = Call<Socket *>("Socket::CreateTCP^0");
+	Handle<SockAddr> serv_addr;
+	{
+		Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateIP^2",
+			"127.0.0.1", (ags_t) 0);
+		EXPECT(Call<ags_t>("Socket::Bind^1", server.get(), addr.get()));
+		EXPECT(Call<ags_t>("Socket::Listen^1", server.get(), (ags_t) 10));
+		serv_addr = Call<SockAddr *>("Socket::get_Local", server.get());
+	}
+
+	Handle<Socket> clients[2], conns[2];
+	for (int n = 0; n < 2; ++n)
+	{
+		clients[n] = Call<Socket *>("Socket::CreateTCP^0");
+		EXPECT(Call<ags_t>("Socket::Connect^2", clients[n].get(),
+			serv_addr.get(), (ags_t) 0));
+		for (int i = 0; i < 100 && !conns[n]; ++i)
+		{
+			conns[n] = Call<Socket *>("Socket::Accept^0", server.get());
+			if (!conns[n])
+				m_sleep(10);
+		}
+		EXPECT(!!conns[n]);
+	}
+
+	// Never connected, so sending to it fails
+	Handle<Socket> broken = Call<Socket *>("Socket::CreateTCP^0");
+
+	Handle<SocketGroup> group = Call<SocketGroup *>("SocketGroup::Create^0");
+	EXPECT(Call<ags_t>("SocketGroup::Add^1", group.get(), clients[0].get()));
+	EXPECT(Call<ags_t>("SocketGroup::Add^1", group.get(), broken.get()));
+	EXPECT(Call<ags_t>("SocketGroup::Add^1", group.get(), clients[1].get()));
+	EXPECT(!Call<ags_t>("SocketGroup::Add^1", group.get(), clients[1].get()));
+	EXPECT(Call<ags_t>("SocketGroup::get_Count", group.get()) == 3);
+	EXPECT(Call<Socket *>("SocketGroup::geti_Members", group.get(), (ags_t) 1)
+		== broken.get());
+
+	// The broken member does not keep the others from getting the data
+	EXPECT(Call<ags_t>("SocketGroup::Broadcast^1", group.get(), "hello all")
+		== 2);
+	EXPECT(Call<ags_t>("SocketGroup::geti_Errors", group.get(), (ags_t) 0)
+		== AGSSOCK_NO_ERROR);
+	EXPECT(Call<ags_t>("SocketGroup::geti_Errors", group.get(), (ags_t) 1)
+		!= AGSSOCK_NO_ERROR);
+	EXPECT(Call<ags_t>("SocketGroup::geti_Errors", group.get(), (ags_t) 2)
+		== AGSSOCK_NO_ERROR);
+
+	for (int n = 0; n < 2; ++n)
+	{
+		string received;
+		for (int i = 0; i < 100 && received.size() < 9; ++i)
+		{
+			Handle<const char> data = Call<const char *>("Socket::Recv^0",
+				conns[n].get());
+			if (data)
+				received += data.get();
+			else
+				m_sleep(10);
+		}
+		EXPECT(received == "hello all");
+	}
+
+	EXPECT(Call<ags_t>("SocketGroup::Remove^1", group.get(), broken.get()));
+	EXPECT(!Call<ags_t>("SocketGroup::Remove^1", group.get(), broken.get()));
+	EXPECT(Call<ags_t>("SocketGroup::get_Count", group.get()) == 2);
+	EXPECT(Call<ags_t>("SocketGroup::geti_Errors", group.get(), (ags_t) 1)
+		== AGSSOCK_NO_ERROR);
+	Call<void>("SocketGroup::Clear^0", group.get());
+	EXPECT(Call<ags_t>("SocketGroup::get_Count", group.get()) == 0);
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test18("multicast", []()
+{
+	using namespace AGSMock;
+
+	Handle<Socket> server = Call<Socket *>("Socket::CreateUDP^0");
+	Handle<Socket> client = Call<Socket *>("Socket::CreateUDP^0");
+	Handle<SockAddr> group;
+	{
+		Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateIP^2",
+			"0.0.0.0", (ags_t) 0);
+		EXPECT(Call<ags_t>("Socket::Bind^1", server.get(), addr.get()));
+		Handle<SockAddr> local = Call<SockAddr *>("Socket::get_Local",
+			server.get());
+		group = Call<SockAddr *>("SockAddr::CreateIP^2", "239.255.42.99",
+			Call<ags_t>("SockAddr::get_Port", local.get()));
+	}
+
+	EXPECT(Call<ags_t>("Socket::SetOption^3", client.get(),
+		(ags_t) AGSSOCK_LEVEL_SOCKET, (ags_t) AGSSOCK_OPTION_BROADCAST,
+		(ags_t) 1));
+	EXPECT(Call<ags_t>("Socket::GetOption^2", client.get(),
+		(ags_t) AGSSOCK_LEVEL_SOCKET, (ags_t) AGSSOCK_OPTION_BROADCAST) == 1);
+	EXPECT(!Call<ags_t>("Socket::SetOption^3", client.get(),
+		(ags_t) AGSSOCK_LEVEL_SOCKET, (ags_t) AGSSOCK_OPTION_MULTICAST_TTL,
+		(ags_t) 1));
+	EXPECT(Call<ags_t>("Socket::ErrorValue^0", client.get())
+		== AGSSOCK_INVALID);
+	EXPECT(Call<ags_t>("Socket::SetOption^3", client.get(),
+		(ags_t) AGSSOCK_LEVEL_IP, (ags_t) AGSSOCK_OPTION_MULTICAST_TTL,
+		(ags_t) 1));
+	EXPECT(Call<ags_t>("Socket::GetOption^2", client.get(),
+		(ags_t) AGSSOCK_LEVEL_IP, (ags_t) AGSSOCK_OPTION_MULTICAST_TTL) == 1);
+	EXPECT(Call<ags_t>("Socket::SetOption^3", client.get(),
+		(ags_t) AGSSOCK_LEVEL_IP, (ags_t) AGSSOCK_OPTION_MULTICAST_LOOP,
+		(ags_t) 1));
+	EXPECT(Call<ags_t>("Socket::GetOption^2", client.get(),
+		(ags_t) AGSSOCK_LEVEL_IP, (ags_t) AGSSOCK_OPTION_MULTICAST_LOOP) == 1);
+
+	// Hosts without a multicast capable interface cannot join
+	if (!Call<ags_t>("Socket::JoinGroup^1", server.get(), group.get())
+		|| !Call<ags_t>("Socket::SendTo^2", client.get(), group.get(),
+		"discover"))
+	{
+		cout << "(no multicast) ";
+		return true;
+	}
+
+	string received;
+	for (int i = 0; i < 100 && received.empty(); ++i)
+	{
+		Handle<const char> data = Call<const char *>("Socket::RecvFrom^1",
+			server.get(), nullptr);
+		if (data)
+			received = data.get();
+		else
+			m_sleep(10);
+	}
+	EXPECT(received == "discover");
+
+	EXPECT(Call<ags_t>("Socket::LeaveGroup^1", server.get(), group.get()));
+	EXPECT(!Call<ags_t>("Socket::LeaveGroup^1", server.get(), group.get()));
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test19("local sockets", []()
+{
+	using namespace AGSMock;
+
+	auto receive = [](Socket *sock, size_t size)
+	{
+		string received;
+		for (int i = 0; i < 100 && received.size() < size; ++i)
+		{
+			Handle<const char> data = Call<const char *>("Socket::Recv^0", sock);
+			if (data)
+				received += data.get();
+			else
+				m_sleep(10);
+		}
+		return received;
+	};
+
+#ifndef _WIN32
+	// Pairs need no address at all
+	for (ags_t datagram = 0; datagram < 2; ++datagram)
+	{
+		Handle<Socket> first = Call<Socket *>("Socket::CreatePair^1", datagram);
+		EXPECT(Call<ags_t>("Socket::get_Valid", first.get()));
+		Handle<Socket> second = Call<Socket *>("Socket::get_Pair", first.get());
+		EXPECT(!!second);
+		EXPECT(!Call<Socket *>("Socket::get_Pair", second.get()));
+
+		EXPECT(Call<ags_t>("Socket::Send^1", first.get(), "ping"));
+		EXPECT(receive(second.get(), 4) == "ping");
+		EXPECT(Call<ags_t>("Socket::Send^1", second.get(), "pong"));
+		EXPECT(receive(first.get(), 4) == "pong");
+	}
+#endif
+
+	// The path of an address is kept as given
+	{
+		Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateLocal^1",
+			"@agssock");
+		EXPECT(string(Handle<const char>(Call<const char *>(
+			"SockAddr::get_Address", addr.get())).get()) == "@agssock");
+	}
+
+	char path[64];
+	snprintf(path, sizeof (path), "agssock-%d.sock", (int) getpid());
+	unlink(path);
+	Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateLocal^1", path);
+	EXPECT(string(Handle<const char>(Call<const char *>("SockAddr::get_Address",
+		addr.get())).get()) == path);
+
+	Handle<Socket> server = Call<Socket *>("Socket::CreateLocal^1", (ags_t) 0);
+	if (!Call<ags_t>("Socket::get_Valid", server.get()))
+	{
+		cout << "(unsupported) ";
+		return true;
+	}
+	EXPECT(Call<ags_t>("Socket::Bind^1", server.get(), addr.get()));
+	EXPECT(Call<ags_t>("Socket::Listen^1", server.get(), (ags_t) 10));
+	{
+		Handle<SockAddr> local = Call<SockAddr *>("Socket::get_Local",
+			server.get());
+		EXPECT(Call<ags_t>("SockAddr::Equals^1", local.get(), addr.get()));
+	}
+
+	Handle<Socket> client = Call<Socket *>("Socket::CreateLocal^1", (ags_t) 0);
+	EXPECT(Call<ags_t>("Socket::Connect^2", client.get(), addr.get(),
+		(ags_t) 0));
+	Handle<Socket> conn;
+	for (int i = 0; i < 100 && !conn; ++i)
+	{
+		conn = Call<Socket *>("Socket::Accept^0", server.get());
+		if (!conn)
+			m_sleep(10);
+	}
+	EXPECT(!!conn);
+
+	EXPECT(Call<ags_t>("Socket::Send^1", client.get(), "hello"));
+	EXPECT(receive(conn.get(), 5) == "hello");
+	unlink(path);
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test20("shared ring", []()
+{
+	using namespace AGSMock;
+
+	char name[64];
+	snprintf(name, sizeof (name), "agssock-test-%d", (int) getpid());
+
+	Handle<SharedRing> server = Call<SharedRing *>("SharedRing::Create^2", name,
+		(ags_t) 4096);
+	if (!Call<ags_t>("SharedRing::get_Valid", server.get()))
+	{
+		cout << "(unsupported) ";
+		return true;
+	}
+
+	// The name is taken until the creator is gone
+	{
+		Handle<SharedRing> other = Call<SharedRing *>("SharedRing::Create^2",
+			name, (ags_t) 4096);
+		EXPECT(!Call<ags_t>("SharedRing::get_Valid", other.get()));
+	}
+
+	Handle<SharedRing> client = Call<SharedRing *>("SharedRing::Open^1", name);
+	EXPECT(Call<ags_t>("SharedRing::get_Valid", client.get()));
+
+	// Messages keep their boundaries, in both directions
+	EXPECT(!Call<const char *>("SharedRing::Recv^0", client.get()));
+	EXPECT(Call<ags_t>("SharedRing::ErrorValue^0", client.get())
+		== AGSSOCK_NO_ERROR);
+	EXPECT(Call<ags_t>("SharedRing::Send^1", server.get(), "hello"));
+	EXPECT(Call<ags_t>("SharedRing::Send^1", server.get(), "world"));
+	EXPECT(string(Handle<const char>(Call<const char *>("SharedRing::Recv^0",
+		client.get())).get()) == "hello");
+	EXPECT(string(Handle<const char>(Call<const char *>("SharedRing::Recv^0",
+		client.get())).get()) == "world");
+	EXPECT(Call<ags_t>("SharedRing::Send^1", client.get(), "reply"));
+	EXPECT(string(Handle<const char>(Call<const char *>("SharedRing::Recv^0",
+		server.get())).get()) == "reply");
+
+	// A full ring asks to try again, wrapping around the end is invisible
+	auto sample = [](int round)
+	{
+		string message(1000, '\0');
+		for (size_t i = 0; i < message.size(); ++i)
+			message[i] = 'a' + (i + round * 7) % 26;
+		return message;
+	};
+	int sent = 0;
+	while (Call<ags_t>("SharedRing::Send^1", server.get(),
+		sample(sent).c_str()))
+		sent++;
+	EXPECT(sent == 4);
+	EXPECT(Call<ags_t>("SharedRing::ErrorValue^0", server.get())
+		== AGSSOCK_NO_ERROR);
+	for (int round = 0; round < 10; ++round)
+	{
+		Handle<const char> data = Call<const char *>("SharedRing::Recv^0",
+			client.get());
+		EXPECT(data && sample(round) == data.get());
+		EXPECT(Call<ags_t>("SharedRing::Send^1", server.get(),
+			sample(round + 4).c_str()));
+	}
+
+	// Too large to ever fit
+	string huge(5000, 'x');
+	EXPECT(!Call<ags_t>("SharedRing::Send^1", server.get(), huge.c_str()));
+	EXPECT(Call<ags_t>("SharedRing::ErrorValue^0", server.get())
+		== AGSSOCK_INVALID);
+
+	// What was sent before closing still arrives
+	Call<void>("SharedRing::Close^0", server.get());
+	for (int round = 10; round < 14; ++round)
+	{
+		Handle<const char> data = Call<const char *>("SharedRing::Recv^0",
+			client.get());
+		EXPECT(data && sample(round) == data.get());
+	}
+	EXPECT(!Call<const char *>("SharedRing::Recv^0", client.get()));
+	EXPECT(Call<ags_t>("SharedRing::ErrorValue^0", client.get())
+		== AGSSOCK_NOT_CONNECTED);
+	EXPECT(!Call<ags_t>("SharedRing::Send^1", client.get(), "late"));
+
+	// The creator closed so the name is gone
+	Handle<SharedRing> gone = Call<SharedRing *>("SharedRing::Open^1", name);
+	EXPECT(!Call<ags_t>("SharedRing::get_Valid", gone.get()));
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test21("reliable channels", []()
+{
+	using namespace AGSMock;
+
+	Handle<Socket> server = Call<Socket *>("Socket::CreateUDP^0");
+	Handle<SockAddr> serv_addr;
+	{
+		Handle<SockAddr> addr = Call<SockAddr *>("SockAddr::CreateIP^2",
+			"127.0.0.1", (ags_t) 0);
+		EXPECT(Call<ags_t>("Socket::Bind^1", server.get(), addr.get()));
+		serv_addr = Call<SockAddr *>("Socket::get_Local", server.get());
+	}
+
+	Handle<Socket> client = Call<Socket *>("Socket::CreateUDP^0");
+	Call<void>("Socket::set_Reliable", server.get(), (ags_t) 1);
+	Call<void>("Socket::set_Reliable", client.get(), (ags_t) 1);
+	EXPECT(Call<ags_t>("Socket::get_Reliable", server.get()));
+	EXPECT(Call<ags_t>("Socket::Connect^3", client.get(), serv_addr.get(),
+		(ags_t) 0, (ags_t) 1000));
+
+	// Messages arrive without the header of the layer, in order by default
+	for (int i = 0; i < 100; ++i)
+		EXPECT(Call<ags_t>("Socket::Send^1", client.get(),
+			std::to_string(i).c_str()));
+
+	Handle<SockAddr> source = Call<SockAddr *>("SockAddr::Create^1",
+		(ags_t) -1);
+	int received = 0;
+	for (int i = 0; i < 200 && received < 100; ++i)
+	{
+		Handle<const char> data = Call<const char *>("Socket::RecvFrom^1",
+			server.get(), source.get());
+		if (!data)
+		{
+			EXPECT(Call<ags_t>("Socket::ErrorValue^0", server.get())
+				== AGSSOCK_PLEASE_TRY_AGAIN);
+			m_sleep(10);
+			continue;
+		}
+		EXPECT(std::to_string(received) == data.get());
+		received++;
+	}
+	EXPECT(received == 100);
+
+	// Replies go to the source on a channel of their own
+	EXPECT(Call<ags_t>("Socket::SetDelivery^2", server.get(),
+		(ags_t) AGSSOCK_DELIVERY_SEQUENCED, (ags_t) 2));
+	EXPECT(Call<ags_t>("Socket::SendTo^2", server.get(), source.get(),
+		"reply"));
+	Handle<const char> reply;
+	for (int i = 0; i < 100 && !reply; ++i)
+	{
+		reply = Call<const char *>("Socket::Recv^0", client.get());
+		if (!reply)
+			m_sleep(10);
+	}
+	EXPECT(reply && string(reply.get()) == "reply");
+
+	// Only datagram sockets, and only channels that exist
+	EXPECT(!Call<ags_t>("Socket::SetDelivery^2", server.get(),
+		(ags_t) AGSSOCK_DELIVERY_RELIABLE, (ags_t) 16));
+	EXPECT(Call<ags_t>("Socket::ErrorValue^0", server.get())
+		== AGSSOCK_INVALID);
+	Handle<Socket> stream = Call<Socket *>("Socket::CreateTCP^0");
+	Call<void>("Socket::set_Reliable", stream.get(), (ags_t) 1);
+	EXPECT(!Call<ags_t>("Socket::get_Reliable", stream.get()));
+	EXPECT(Call<ags_t>("Socket::ErrorValue^0", stream.get())
+		== AGSSOCK_UNSUPPORTED);
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
+Test test22("sealed data", []()
+{
+	using namespace AGSMock;
+
+	Handle<SockData> key = Call<SockData *>("SockData::FromHex^1",
+		"000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f");
+	Handle<SockSession> client = Call<SockSession *>("SockSession::Create^2",
+		key.get(), (ags_t) 0);
+	Handle<SockSession> server = Call<SockSession *>("SockSession::Create^2",
+		key.get(), (ags_t) 1);
+	EXPECT(Call<ags_t>("SockSession::get_Valid", client.get()));
+
+	// Data comes back as it was, the sealed form is not readable
+	Handle<SockData> data = Call<SockData *>("SockData::CreateFromString^1",
+		"attack at dawn");
+	Handle<SockData> sealed = Call<SockData *>("SockSession::Seal^1",
+		client.get(), data.get());
+	EXPECT(Call<ags_t>("SockData::get_Size", sealed.get()) == 14 + 24);
+	{
+		Handle<const char> str = Call<const char *>("SockData::AsString^0",
+			sealed.get());
+		EXPECT(!strstr(str.get(), "attack"));
+	}
+	{
+		Handle<SockData> opened = Call<SockData *>("SockSession::Open^1",
+			server.get(), sealed.get());
+		EXPECT(opened);
+		Handle<const char> str = Call<const char *>("SockData::AsString^0",
+			opened.get());
+		EXPECT(string(str.get()) == "attack at dawn");
+	}
+
+	// Opened before, or sealed by the same side
+	EXPECT(!Call<SockData *>("SockSession::Open^1", server.get(), sealed.get()));
+	Handle<SockData> reply = Call<SockData *>("SockSession::Seal^1",
+		server.get(), data.get());
+	EXPECT(!Call<SockData *>("SockSession::Open^1", server.get(), reply.get()));
+
+	// Out of order is fine, changed is not
+	Handle<SockData> first = Call<SockData *>("SockSession::Seal^1",
+		client.get(), data.get());
+	Handle<SockData> second = Call<SockData *>("SockSession::Seal^1",
+		client.get(), data.get());
+	Call<void>("SockData::seti_Chars", first.get(), (ags_t) 10,
+		Call<ags_t>("SockData::geti_Chars", first.get(), (ags_t) 10) ^ 1);
+	EXPECT(!Call<SockData *>("SockSession::Open^1", server.get(), first.get()));
+	EXPECT(!!Handle<SockData>(Call<SockData *>("SockSession::Open^1",
+		server.get(), second.get())));
+	Call<void>("SockData::seti_Chars", first.get(), (ags_t) 10,
+		Call<ags_t>("SockData::geti_Chars", first.get(), (ags_t) 10) ^ 1);
+	EXPECT(!!Handle<SockData>(Call<SockData *>("SockSession::Open^1",
+		server.get(), first.get())));
+
+	// Keys must be 32 bytes
+	Handle<SockData> short_key = Call<SockData *>("SockData::FromHex^1",
+		"0001020304050607");
+	EXPECT(!Call<SockSession *>("SockSession::Create^2", short_key.get(),
+		(ags_t) 0));
+
+	return true;
+});
+
+//------------------------------------------------------------------------------
+
 int main(int argc, char const *argv[])
 {
 	AGSMock::Initialize();